@@ -0,0 +1,107 @@
+#!/usr/bin/env python3
+# Turns APA files into a C++ header of constexpr threshold images, for
+# builds pinned to one APA per path length (see include/apa_image.hpp).
+#
+#   python3 gen_apa_image.py -o obj/gen/apa_image_data.hpp ../APA/robust32_1.txt ../APA/robust64_1.txt
+#
+# Thresholds are scaled as in load_apa() (and controller.py): the
+# probability times 2^32, truncated, mod 2^32. For every hop only the
+# band of degrees with a non-zero add or replace threshold is kept; all
+# other degrees are (0, 0) at run time, which the image reproduces.
+
+import argparse
+import os
+import re
+import sys
+
+
+def parse_apa(path):
+    rows = []
+    with open(path, 'r') as f:
+        for line in f:
+            if not line.strip():
+                continue
+            parts = [float(c) for c in line.split(',') if c.strip()]
+            if len(parts) % 2:
+                sys.exit('%s: line %d has odd number of columns: %d' % (path, len(rows), len(parts)))
+            rows.append([(int(parts[2 * d] * 4294967296.0) & 0xFFFFFFFF,
+                          int(parts[2 * d + 1] * 4294967296.0) & 0xFFFFFFFF)
+                         for d in range(len(parts) // 2)])
+    return rows
+
+
+def c_array(ctype, name, values, per_line=8):
+    out = ['    static constexpr std::array<%s, %d> %s = {' % (ctype, len(values), name)]
+    for i in range(0, len(values), per_line):
+        out.append('        ' + ', '.join(str(v) for v in values[i:i + per_line]) + ',')
+    out.append('    };')
+    return out
+
+
+def image(path):
+    rows = parse_apa(path)
+    if not rows or len(rows) > 256:
+        sys.exit('%s: %d hops, expected 1..256' % (path, len(rows)))
+    name = re.sub(r'\W', '_', os.path.splitext(os.path.basename(path))[0])
+
+    lo, hi, off, add, rep = [], [], [], [], []
+    for degrees in rows:
+        used = [d for d, (a, r) in enumerate(degrees) if a or r]
+        off.append(len(add))
+        if used:
+            lo.append(used[0])
+            hi.append(used[-1])
+            for a, r in degrees[used[0]:used[-1] + 1]:
+                add.append(a)
+                rep.append(r)
+        else:
+            lo.append(1)   # empty band: hi < lo
+            hi.append(0)
+    full = sum(len(d) for d in rows)
+
+    out = ['// %s: %d hops, %d of %d thresholds kept' % (os.path.basename(path), len(rows), len(add), full),
+           'struct apa_image_%s {' % name,
+           '    static constexpr const char* name = "%s";' % name,
+           '    static constexpr int hops    = %d;' % len(rows),
+           '    static constexpr int degrees = %d;' % max(len(d) for d in rows)]
+    out += c_array('uint16_t', 'lo', lo, 16)
+    out += c_array('int16_t', 'hi', hi, 16)
+    out += c_array('uint32_t', 'off', off, 16)
+    out += c_array('uint32_t', 'add', add or [0])
+    out += c_array('uint32_t', 'rep', rep or [0])
+    out.append('};')
+    return 'apa_image_' + name, out
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Generate constexpr APA images')
+    parser.add_argument('-o', '--out', required=True, help='header to write')
+    parser.add_argument('apa', nargs='*', help='APA/robust*.txt files, one per path length')
+    args = parser.parse_args()
+
+    lines = ['// Generated by gen_apa_image.py from: %s' % (' '.join(args.apa) or '(none)'),
+             '// Do not edit; rebuild with make APA_IMAGE="...".',
+             '#pragma once',
+             '',
+             '#include <array>',
+             '#include <cstdint>',
+             '']
+    names = []
+    for path in args.apa:
+        name, body = image(path)
+        if name in names:
+            sys.exit('%s: image %s listed twice' % (path, name))
+        names.append(name)
+        lines += body + ['']
+    lines.append('#define APA_IMAGE_LIST %s' % ', '.join(names))
+
+    os.makedirs(os.path.dirname(args.out) or '.', exist_ok=True)
+    tmp = args.out + '.tmp'
+    with open(tmp, 'w') as f:
+        f.write('\n'.join(lines) + '\n')
+    os.replace(tmp, args.out)
+    print('Wrote %s (%d APA images)' % (args.out, len(names)))
+
+
+if __name__ == '__main__':
+    main()
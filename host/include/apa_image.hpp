@@ -0,0 +1,41 @@
+// include/apa_image.hpp
+#pragma once
+
+#include "recipe_decoder.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+// APA images compiled into the binary, for deployments that pin one APA
+// per path length.
+//
+//   make APA_IMAGE="../APA/robust32_1.txt ../APA/robust64_1.txt"
+//
+// runs gen_apa_image.py, which writes each APA as constexpr uint32
+// thresholds with a per-hop band of non-empty degrees (degrees beyond a
+// hop's band are (0, 0) and never stored). apa_image.cpp instantiates a
+// replay per image with the path length as a constant; images of up to
+// 32 hops are fully unrolled, so each hop's band, table offset and bit
+// position are immediates.
+//
+// load_apa() attaches the image whose thresholds match the loaded file
+// exactly, and reconstruct_xor_set() / reconstruct_xor_set_crc() use it
+// from then on. Without APA_IMAGE nothing is embedded and every APA
+// goes through the runtime loader and the generic replay as before.
+struct apa_image_info {
+    const char* name;
+    int    hops;
+    size_t thresholds;        // (add, replace) pairs kept
+    size_t full_thresholds;   // hops * degrees in the file
+
+    bool (*matches)(const apa_t& apa);
+    // xor_set over the first num_hops <= hops hops
+    hop_mask (*replay_v4)(int num_hops, uint32_t pktid);
+    hop_mask (*replay_crc)(int num_hops, uint32_t pkt_term);   // crc_hop_hash::pkt_term()
+};
+
+std::span<const apa_image_info> embedded_apa_images();
+
+// Embedded image identical to apa; nullptr if none is.
+const apa_image_info* find_apa_image(const apa_t& apa);
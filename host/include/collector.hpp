@@ -0,0 +1,207 @@
+// include/collector.hpp
+#pragma once
+
+#include "decode_scheduler.hpp"
+#include "flow_sampler.hpp"
+#include "heavy_hitters.hpp"
+#include "multi_flow_decoder.hpp"
+#include "path_store.hpp"
+#include "recipe_decoder.hpp"
+#include "snapshot.hpp"
+
+#include <sys/types.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Central path-tracing collector. Host agents send batches of equation
+// records over a Unix datagram socket or local UDP; ingest threads shard
+// the records by flow hash (by source address with a shared prefix, so
+// flows of a source meet in one decoder) onto worker threads, each
+// running a multi_flow_decoder for its flows, and decoded paths are
+// published to an in-memory path_store (see path_store.hpp).
+
+// -------------------------------------------------------------------
+// Wire format (local IPC only, so host byte order except for the
+// addresses, which are copied from the IPv4 header as-is)
+// -------------------------------------------------------------------
+
+constexpr uint32_t COLLECTOR_MAGIC     = 0x52435044;  // "RCPD"
+constexpr size_t   COLLECTOR_MAX_BATCH = 1024;        // records per datagram
+constexpr int      SKETCH_FLUSH_MS     = 100;         // traffic sketch staleness
+
+#pragma pack(push, 1)
+
+struct collector_batch_h {
+    uint32_t magic;
+    uint16_t count;
+    uint16_t reserved;
+};
+
+struct equation_record {
+    uint32_t src_addr;
+    uint32_t dst_addr;
+    uint32_t pktid;
+    uint16_t pint;
+    uint16_t num_hops;    // path length the agent reconstructed for
+    uint8_t  protocol;
+    uint8_t  reserved[7];
+    uint64_t xor_set[HOP_MASK_WORDS];
+};
+
+#pragma pack(pop)
+
+constexpr size_t COLLECTOR_MAX_DATAGRAM =
+    sizeof(collector_batch_h) + COLLECTOR_MAX_BATCH * sizeof(equation_record);
+
+inline flow_key record_flow(const equation_record& r) {
+    flow_key k;
+    k.src_addr = r.src_addr;
+    k.dst_addr = r.dst_addr;
+    k.protocol = r.protocol;
+    return k;
+}
+
+inline packet_equation record_equation(const equation_record& r) {
+    packet_equation eq;
+    eq.pktid = r.pktid;
+    eq.pint  = r.pint;
+    for (int k = 0; k < HOP_MASK_WORDS; ++k) eq.xor_set.w[k] = r.xor_set[k];
+    return eq;
+}
+
+// -------------------------------------------------------------------
+// Collector
+// -------------------------------------------------------------------
+
+struct collector_config {
+    int num_hops      = 32;
+    int workers       = 4;
+    int shared_prefix = 0;       // see multi_flow_decoder; > 0 shards by source
+    size_t queue_batches = 1024; // per worker; ingest blocks when full
+    std::string unix_path;       // empty: no Unix socket
+    int udp_port      = 0;       // 0: no UDP socket
+    // Worker i snapshots its decoder to `snapshot_path`.i every
+    // `snapshot_secs` and at stop(), and restores it at start(). The
+    // worker forks and the child serializes its copy-on-write view and
+    // commits, so the worker stalls for the fork only; a generation is
+    // skipped while the previous child is still writing.
+    std::string snapshot_path;   // empty: no snapshots
+    int snapshot_secs = 10;
+    // Decoded flows leave the decoders for the path_store; undecoded
+    // flows without equations for one to two periods of this are dropped
+    int flow_idle_secs = 60;     // 0: never
+    // Fraction of flows decoded; the others are only counted
+    double   sample_rate = 1.0;
+    uint32_t sample_salt = 0;
+    // Per-worker decode_scheduler holding up to this many equations, run
+    // `schedule_budget` equations at a time; 0: decode in arrival order
+    size_t schedule_capacity = 0;
+    size_t schedule_budget   = 4096;
+    double schedule_age_weight = 1.0 / 256;
+    // Top-k traffic sketches (see heavy_hitters.hpp)
+    size_t sketch_k     = 32;
+    int    sketch_depth = 4;
+    int    sketch_width = 4096;
+};
+
+// Sketch keys: path_store::path_fingerprint() for paths, and this for
+// (switch ID, hop).
+inline uint64_t hop_sketch_key(uint16_t switch_id, int hop) {
+    return (static_cast<uint64_t>(hop) << 16) | switch_id;
+}
+
+struct collector_stats {
+    uint64_t received = 0;       // records accepted by ingest
+    uint64_t rejected = 0;       // bad datagrams / wrong path length
+    uint64_t unsampled = 0;      // records of flows not sampled
+    uint64_t shed      = 0;      // dropped by a congested scheduler
+    uint64_t decoded  = 0;       // flows published to the store
+    uint64_t idle     = 0;       // undecoded flows dropped after flow_idle_secs
+};
+
+class collector {
+public:
+    explicit collector(const collector_config& cfg);
+    ~collector();
+
+    // Open the configured sockets and start ingest and worker threads.
+    // On failure nothing stays open or bound.
+    bool start();
+    // Drain the queues and join all threads.
+    void stop();
+
+    // In-process ingest (stand-in agents, benchmarks); thread-safe.
+    void submit(const equation_record* records, size_t count);
+
+    const path_store& store() const { return store_; }
+    collector_stats stats() const;
+    // Backpressure: some worker's scheduler is congested.
+    bool congested() const { return congested_workers_.load(std::memory_order_relaxed) > 0; }
+
+    // Packets of decoded flows by path and by (switch ID, hop), merged
+    // over the workers, up to SKETCH_FLUSH_MS old. Mergeable with other
+    // collectors' sketches.
+    heavy_hitters top_paths() const;
+    heavy_hitters top_hops() const;
+
+private:
+    struct record_queue {
+        std::mutex mu;
+        std::condition_variable not_empty;
+        std::condition_variable not_full;
+        std::deque<std::vector<equation_record>> batches;
+        bool closed = false;
+    };
+
+    struct traffic_sketch {
+        std::mutex mu;
+        heavy_hitters paths;
+        heavy_hitters hops;
+        traffic_sketch(size_t k, int depth, int width)
+            : paths(k, depth, width), hops(k, depth, width) {}
+    };
+
+    void close_sockets();
+    void ingest_loop(int fd);
+    void worker_loop(int id);
+    void count_traffic(int id,
+                       std::unordered_map<const std::vector<uint16_t>*, uint64_t>& traffic);
+    void restore_worker(int id, multi_flow_decoder& dec);
+    bool snapshot_worker(int id, const multi_flow_decoder& dec, uint64_t generation);
+    pid_t fork_snapshot(int id, const multi_flow_decoder& dec, uint64_t generation);
+    void push(int worker, std::vector<equation_record>&& batch);
+    int  shard(const flow_key& key) const;
+
+    collector_config cfg_;
+    flow_sampler sampler_;
+    path_store store_;
+    std::vector<std::unique_ptr<record_queue>> queues_;
+    std::vector<std::unique_ptr<traffic_sketch>> sketches_;   // per worker
+    std::vector<std::thread> workers_;
+    std::vector<std::thread> ingest_;
+    std::vector<int> fds_;
+    std::atomic<bool> running_{false};
+    std::atomic<uint64_t> received_{0};
+    std::atomic<uint64_t> rejected_{0};
+    std::atomic<uint64_t> unsampled_{0};
+    std::atomic<uint64_t> shed_{0};
+    std::atomic<int> congested_workers_{0};
+    std::atomic<uint64_t> decoded_{0};
+    std::atomic<uint64_t> idle_{0};
+};
+
+// Agent side: open a datagram socket connected to the collector, either
+// a Unix socket path or 127.0.0.1:udp_port. Returns -1 on failure.
+int open_collector_socket(const std::string& unix_path, int udp_port);
+
+bool send_records(int fd, const equation_record* records, size_t count);
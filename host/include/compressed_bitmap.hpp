@@ -0,0 +1,56 @@
+// include/compressed_bitmap.hpp
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Roaring-style bitmap of 32-bit ids. Ids are grouped by their high 16
+// bits; each group is a sorted uint16 array while small and switches to
+// a 65536-bit bitset once it holds more than BITMAP_ARRAY_MAX ids.
+constexpr size_t BITMAP_ARRAY_MAX   = 4096;
+constexpr size_t BITMAP_CHUNK_WORDS = 65536 / 64;
+
+class compressed_bitmap {
+public:
+    void add(uint32_t v);
+    void remove(uint32_t v);
+    bool contains(uint32_t v) const;
+    size_t cardinality() const;
+    bool empty() const { return chunks_.empty(); }
+
+    // Calls f(id) in increasing order.
+    template <typename F>
+    void for_each(F f) const {
+        for (const auto& c : chunks_) {
+            uint32_t hi = static_cast<uint32_t>(c.key) << 16;
+            if (c.bits.empty()) {
+                for (uint16_t lo : c.array) f(hi | lo);
+                continue;
+            }
+            for (size_t w = 0; w < BITMAP_CHUNK_WORDS; ++w) {
+                for (uint64_t b = c.bits[w]; b; b &= b - 1) {
+                    f(hi | static_cast<uint32_t>(w * 64 + __builtin_ctzll(b)));
+                }
+            }
+        }
+    }
+
+    static compressed_bitmap intersect(const compressed_bitmap& a,
+                                       const compressed_bitmap& b);
+
+    size_t memory_bytes() const;
+
+private:
+    struct chunk {
+        uint16_t key = 0;
+        uint32_t card = 0;
+        std::vector<uint16_t> array;   // sorted, used while bits is empty
+        std::vector<uint64_t> bits;    // BITMAP_CHUNK_WORDS words when dense
+    };
+
+    chunk* find(uint16_t key);
+    const chunk* find(uint16_t key) const;
+
+    std::vector<chunk> chunks_;        // sorted by key
+};
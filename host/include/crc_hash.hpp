@@ -0,0 +1,115 @@
+// include/crc_hash.hpp
+#pragma once
+
+#include "apa_image.hpp"
+#include "recipe_decoder.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Hashes of the CRC variant (tofino/recipe.p4). Both are Tofino CRC32
+// (the reflected 0x04C11DB7 CRC of zlib and Ethernet) over the listed
+// header fields, concatenated in network byte order:
+//
+//   pkt_id  = pkt_hash_v4.get({src_addr, dst_addr, protocol, identification})
+//   hash_id = hash_all.get({pkt_id, hop_count})
+//
+// hop_count is 255 - TTL on arrival, i.e. the hop index.
+//
+// Everything here is constexpr: the tables are generated by the compiler
+// into .rodata, so short-lived tools pay no start-up cost for them, and
+// crc_hash.cpp checks known vectors with static_assert.
+
+using crc32_tables = std::array<std::array<uint32_t, 256>, 4>;
+
+// Slicing-by-4: t[0] is the byte-at-a-time table, t[k][i] the CRC of
+// byte i followed by k zero bytes.
+constexpr crc32_tables make_crc32_tables() {
+    crc32_tables t{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        t[0][i] = c;
+    }
+    for (size_t k = 1; k < 4; ++k) {
+        for (size_t i = 0; i < 256; ++i) t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xff];
+    }
+    return t;
+}
+
+inline constexpr crc32_tables CRC32_TABLES = make_crc32_tables();
+
+constexpr uint32_t crc32(const uint8_t* data, size_t len) {
+    const auto& t = CRC32_TABLES;
+    uint32_t c = 0xFFFFFFFFu;
+    for (; len >= 4; data += 4, len -= 4) {
+        c ^= static_cast<uint32_t>(data[0]) | static_cast<uint32_t>(data[1]) << 8 |
+             static_cast<uint32_t>(data[2]) << 16 | static_cast<uint32_t>(data[3]) << 24;
+        c = t[3][c & 0xff] ^ t[2][(c >> 8) & 0xff] ^ t[1][(c >> 16) & 0xff] ^ t[0][c >> 24];
+    }
+    for (; len > 0; ++data, --len) c = t[0][(c ^ *data) & 0xff] ^ (c >> 8);
+    return c ^ 0xFFFFFFFFu;
+}
+
+constexpr uint32_t tofino_pkt_id(uint32_t src_addr, uint32_t dst_addr, uint8_t protocol,
+                                 uint16_t identification) {
+    const uint8_t b[11] = {
+        static_cast<uint8_t>(src_addr >> 24), static_cast<uint8_t>(src_addr >> 16),
+        static_cast<uint8_t>(src_addr >> 8),  static_cast<uint8_t>(src_addr),
+        static_cast<uint8_t>(dst_addr >> 24), static_cast<uint8_t>(dst_addr >> 16),
+        static_cast<uint8_t>(dst_addr >> 8),  static_cast<uint8_t>(dst_addr),
+        protocol,
+        static_cast<uint8_t>(identification >> 8), static_cast<uint8_t>(identification),
+    };
+    return crc32(b, sizeof(b));
+}
+
+// hash_all, one CRC over the 5 bytes per (pkt_id, hop)
+constexpr uint32_t tofino_hop_hash(uint32_t pkt_id, uint8_t hop_count) {
+    const uint8_t b[5] = {
+        static_cast<uint8_t>(pkt_id >> 24), static_cast<uint8_t>(pkt_id >> 16),
+        static_cast<uint8_t>(pkt_id >> 8),  static_cast<uint8_t>(pkt_id),
+        hop_count,
+    };
+    return crc32(b, sizeof(b));
+}
+
+// hash_all by CRC linearity. For messages of equal length a CRC is
+// affine over GF(2): crc(a ^ b ^ c) = crc(a) ^ crc(b) ^ crc(c). Splitting
+// {pkt_id, hop} = {pkt_id, 0} ^ {0, hop} ^ {0, 0} gives
+//
+//   hash_id = crc({pkt_id, 0}) ^ hop_term[hop],
+//   hop_term[hop] = crc({0, hop}) ^ crc({0, 0})
+//
+// so one CRC per packet and a single XOR per hop replace a 5-byte CRC
+// per (pkt_id, hop).
+constexpr std::array<uint32_t, 256> make_crc_hop_terms() {
+    std::array<uint32_t, 256> t{};
+    uint32_t zero = tofino_hop_hash(0, 0);
+    for (int hop = 0; hop < 256; ++hop) {
+        t[hop] = tofino_hop_hash(0, static_cast<uint8_t>(hop)) ^ zero;
+    }
+    return t;
+}
+
+inline constexpr std::array<uint32_t, 256> CRC_HOP_TERMS = make_crc_hop_terms();
+
+class crc_hop_hash {
+public:
+    // crc({pkt_id, 0}), once per packet
+    constexpr uint32_t pkt_term(uint32_t pkt_id) const { return tofino_hop_hash(pkt_id, 0); }
+
+    constexpr uint32_t operator()(uint32_t pkt_term, int hop) const {
+        return pkt_term ^ CRC_HOP_TERMS[hop & 0xff];
+    }
+};
+
+// reconstruct_xor_set() for the CRC variant: pkt_id is the 32-bit
+// pkt_hash_v4 value carried in meta.pkt_id.
+inline hop_mask reconstruct_xor_set_crc(const apa_t& apa, int num_hops, uint32_t pkt_id,
+                                        const crc_hop_hash& hash = {}) {
+    uint32_t term = hash.pkt_term(pkt_id);
+    if (apa.image && num_hops <= apa.image->hops) return apa.image->replay_crc(num_hops, term);
+    return replay_xor_set(apa, num_hops, [&hash, term](int hop) { return hash(term, hop); });
+}
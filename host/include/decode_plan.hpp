@@ -0,0 +1,202 @@
+// include/decode_plan.hpp
+#pragma once
+
+#include "recipe_decoder.hpp"
+#include "xor_codebook.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// Precompiled elimination for one set of pkt_ids (fixed-hash variant).
+//
+// With a fixed hash, two flows that received the same pkt_ids have the
+// same coefficient matrix; only their pints differ. A plan runs the
+// elimination once on the xor_sets and records it as a straight-line
+// program over a num_hops-slot work vector, which ends up holding the
+// switch IDs:
+//
+//   loads:  s[c] = pint[i]   (equation i is the basis row of column c)
+//   ops:    s[d] ^= s[s']    (forward reduction, then back-substitution)
+//
+// apply() costs O(loads + ops) XORs of 16-bit values, no bit tests.
+// Equations that do not raise the rank are left out of the program, so
+// (as with rank_monitor) a plan does not check redundant pints.
+class decode_plan {
+public:
+    // xor_sets[i] belongs to pktids[i]; pktids are kept for cache lookups.
+    decode_plan(const std::vector<uint32_t>& pktids,
+                const std::vector<hop_mask>& xor_sets, int num_hops);
+
+    struct load { uint16_t slot, input; };
+    struct op   { uint16_t dst, src; };
+
+    int  num_hops()  const { return num_hops_; }
+    int  rank()      const { return static_cast<int>(loads_.size()); }
+    bool full_rank() const { return rank() == num_hops_; }
+    size_t length()  const { return loads_.size() + ops_.size(); }
+
+    const std::vector<uint32_t>& pktids() const { return pktids_; }
+    const std::vector<load>& loads() const { return loads_; }
+    const std::vector<op>&   ops()   const { return ops_; }
+
+    // pints[i] belongs to pktids()[i]; switch_ids needs num_hops slots.
+    // False unless the plan has full rank.
+    bool apply(const uint16_t* pints, uint16_t* switch_ids) const {
+        if (!full_rank()) return false;
+        for (const load& l : loads_) switch_ids[l.slot] = pints[l.input];
+        for (const op& o : ops_) switch_ids[o.dst] ^= switch_ids[o.src];
+        return true;
+    }
+
+private:
+    friend class decode_plan_builder;
+    explicit decode_plan(int num_hops) : num_hops_(num_hops) {}
+
+    int num_hops_;
+    std::vector<uint32_t> pktids_;
+    std::vector<load> loads_;
+    std::vector<op> ops_;
+};
+
+// Incremental form of the plan above: add() is one row reduction and
+// appends the equation's load and forward ops; finish() appends the
+// back-substitution once the rank is full.
+class decode_plan_builder {
+public:
+    explicit decode_plan_builder(int num_hops);
+
+    // True if the equation raised the rank (no-op once it is full).
+    bool add(uint32_t pktid, const hop_mask& xor_set);
+
+    int    rank()      const { return static_cast<int>(plan_.loads_.size()); }
+    bool   full_rank() const { return rank() == plan_.num_hops_; }
+    size_t inputs()    const { return plan_.pktids_.size(); }
+
+    // Plan over every equation added so far; ops are empty below full rank.
+    decode_plan finish() const;
+
+private:
+    decode_plan plan_;             // loads and forward ops so far
+    std::vector<hop_mask> rows_;   // rows_[c] has lowest set bit c
+    hop_mask pivots_;
+    std::vector<uint16_t> by_;
+};
+
+// Prefix-incremental plans for flows whose pkt_ids count up from `first`
+// (the IPv4 identification counter). Extending the prefix by one pkt_id
+// is one row reduction, so the chain records the rank after every
+// prefix length k, and the first k at which it is full. Every prefix at
+// least that long decodes with the same plan, as later pkt_ids cannot
+// change a full-rank basis. A receiver then knows in O(1) from a flow's
+// highest contiguous pkt_id whether the flow is decodable.
+class prefix_plan_chain {
+public:
+    prefix_plan_chain(int num_hops, uint32_t first);
+
+    // Extends the chain until full rank or the end of the codebook; the
+    // chain keeps no reference to it.
+    void build(const xor_codebook& book);
+
+    uint32_t first()    const { return first_; }
+    int  rank_at(size_t k) const;   // after pkt_ids first .. first + k - 1
+    // First full-rank prefix length; 0 if the codebook never gets there.
+    size_t full_rank_k() const { return full_rank_k_; }
+
+    // O(1): are pkt_ids first .. highest, all received, enough to decode?
+    bool decodable(uint32_t highest_contiguous) const {
+        return full_rank_k_ > 0 && highest_contiguous >= first_ &&
+               highest_contiguous - first_ + 1 >= full_rank_k_;
+    }
+
+    // Plan for every prefix of at least full_rank_k() pkt_ids (it reads
+    // the first full_rank_k() pints only); nullptr below full rank.
+    std::shared_ptr<const decode_plan> plan() const { return plan_; }
+
+private:
+    uint32_t first_;
+    decode_plan_builder builder_;
+    std::vector<uint16_t> rank_at_;   // rank_at_[k - 1]
+    size_t full_rank_k_ = 0;
+    std::shared_ptr<const decode_plan> plan_;
+};
+
+// Runs one plan for up to PLAN_LANES flows that received the same
+// pkt_ids. The work vector is kept structure-of-arrays: slot s holds
+// switch ID s of every flow side by side, one flow per 16-bit SIMD lane,
+// so each op of the plan is a single 64-byte vector XOR for the whole
+// batch. Built with GCC vector extensions; run() is cloned for AVX-512,
+// AVX2 and baseline x86-64 and picks one at load time.
+constexpr size_t PLAN_LANES = 32;
+
+class plan_batch_executor {
+public:
+    explicit plan_batch_executor(int num_hops) : slots_(static_cast<size_t>(num_hops)) {}
+
+    // pints[f] and switch_ids[f] are flow f's arrays as in apply(), for
+    // f < flows <= PLAN_LANES. False unless the plan has full rank.
+    bool run(const decode_plan& plan, const uint16_t* const* pints,
+             uint16_t* const* switch_ids, size_t flows);
+
+private:
+    typedef uint16_t lanes __attribute__((vector_size(2 * PLAN_LANES)));
+    // Wrapped because std::vector drops attributes on lanes, and aligned
+    // by hand because without AVX-512 GCC only aligns lanes to 16 bytes,
+    // while the AVX-512 clone of run() uses aligned 64-byte moves
+    struct alignas(64) slot { lanes v; };
+
+    std::vector<slot> slots_;
+};
+
+// Plans keyed by a fingerprint of (num_hops, sorted pkt_id set), LRU
+// evicted beyond `capacity`. The pkt_id list is compared on every hit,
+// so a fingerprint collision never returns the wrong plan. Not thread
+// safe: one cache per decoding thread, or external locking.
+class decode_plan_cache {
+public:
+    explicit decode_plan_cache(size_t capacity = 4096) : capacity_(capacity) {}
+
+    // Plan for these pkt_ids, built from the codebook on a miss. pktids
+    // are sorted and deduplicated in place, which is the order apply()
+    // expects the pints in. nullptr if a pkt_id is outside the codebook.
+    std::shared_ptr<const decode_plan> get(const xor_codebook& book,
+                                           std::vector<uint32_t>& pktids);
+
+    // Prefix chain of pkt_ids counting up from `first` in this codebook,
+    // built on first use and kept for the cache's lifetime (one per
+    // first pkt_id, so usually one per (APA, path length)). Chains are
+    // matched on the codebook's APA fingerprint, path length and pkt_id
+    // range as well as `first`, so a codebook rebuilt over another range
+    // gets its own chain.
+    const prefix_plan_chain& prefix(const xor_codebook& book, uint32_t first);
+
+    size_t size()      const { return lru_.size(); }
+    size_t hits()      const { return hits_; }
+    size_t misses()    const { return misses_; }
+    size_t evictions() const { return evictions_; }
+
+    void clear();
+
+private:
+    using entry = std::pair<uint64_t, std::shared_ptr<const decode_plan>>;
+
+    size_t capacity_;
+    std::list<entry> lru_;    // most recently used first
+    std::unordered_multimap<uint64_t, std::list<entry>::iterator> index_;
+    struct chain_entry {
+        uint64_t apa_fingerprint;
+        int      num_hops;
+        uint32_t first, first_pktid, count;
+        std::unique_ptr<prefix_plan_chain> chain;
+    };
+    std::unordered_multimap<uint64_t, chain_entry> chains_;   // by hash of the above
+    size_t hits_      = 0;
+    size_t misses_    = 0;
+    size_t evictions_ = 0;
+};
+
+// Fingerprint of a sorted pkt_id set at a path length.
+uint64_t pktid_set_fingerprint(const std::vector<uint32_t>& sorted_pktids, int num_hops);
@@ -0,0 +1,88 @@
+// include/decode_scheduler.hpp
+#pragma once
+
+#include "multi_flow_decoder.hpp"
+#include "recipe_decoder.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+// Orders decoding work across flows when equations arrive faster than
+// they can be eliminated. Arriving equations are queued per flow behind
+// a rank_monitor, which is far cheaper than the decoder: equations that
+// do not raise the flow's rank are dropped at once, and the monitor's
+// rank tells how close the queued work brings the flow to a path.
+//
+// Flows run lowest score first, score = rank deficit + age_weight *
+// arrival of the flow's first equation. The arrival term makes old flows
+// win eventually (no starvation), keeps a flow that is partly in the
+// decoder ahead of newer ones, and, unlike a decaying age bonus, never
+// changes while a flow waits, so the order is a plain set.
+// The queue holds at most `capacity` equations; when full, the queued
+// equations of the flow with the worst score are shed (or the arrival is
+// rejected if it is the worst). A shed flow falls back to the rank it
+// has in the decoder, so work already fed is not written off.
+// congested() is the backpressure signal for the receive stage, with
+// hysteresis between 1/2 and 7/8 of capacity.
+class decode_scheduler {
+public:
+    decode_scheduler(int num_hops, size_t capacity, double age_weight = 1.0 / 256);
+
+    // False if the equation was rejected because the queue is full.
+    bool push(const flow_key& key, const packet_equation& eq);
+
+    // Feed up to about `budget` queued equations, best flows first, into
+    // `dec`; whole flows are run at a time. Returns equations fed.
+    size_t run(multi_flow_decoder& dec, size_t budget);
+
+    // Drop a flow's state, e.g. once it decoded by other means.
+    void forget(const flow_key& key);
+
+    size_t pending()   const { return pending_; }
+    bool   congested() const { return congested_; }
+    size_t redundant() const { return redundant_; }   // dropped by the monitor
+    size_t shed()      const { return shed_; }        // queued, then shed
+    size_t rejected()  const { return rejected_; }    // refused at push
+
+private:
+    struct flow_work {
+        explicit flow_work(int num_hops) : mon(num_hops), fed(num_hops) {}
+
+        rank_monitor mon;          // decoder + queued equations
+        rank_monitor fed;          // decoder only, as of the last run
+        std::vector<packet_equation> eqs;
+        uint64_t first = 0;        // arrival of the flow's first equation
+        double score   = 0;
+        bool queued    = false;    // in order_
+    };
+
+    struct by_score {
+        bool operator()(const std::pair<double, flow_key>& a,
+                        const std::pair<double, flow_key>& b) const {
+            return std::tie(a.first, a.second.src_addr, a.second.dst_addr, a.second.protocol) <
+                   std::tie(b.first, b.second.src_addr, b.second.dst_addr, b.second.protocol);
+        }
+    };
+
+    double score_of(const flow_work& w) const {
+        return (num_hops_ - w.mon.rank()) + age_weight_ * static_cast<double>(w.first);
+    }
+    void dequeue(const flow_key& key, flow_work& w);
+    void update_congestion();
+
+    int num_hops_;
+    size_t capacity_;
+    double age_weight_;
+    uint64_t clock_   = 0;         // equations pushed so far
+    size_t pending_   = 0;
+    bool congested_   = false;
+    size_t redundant_ = 0;
+    size_t shed_      = 0;
+    size_t rejected_  = 0;
+    std::unordered_map<flow_key, flow_work, flow_key_hash> flows_;
+    std::set<std::pair<double, flow_key>, by_score> order_;
+};
@@ -0,0 +1,62 @@
+// include/epoch.hpp
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Epoch-based reclamation for RCU-style structures.
+//
+// Readers wrap every access in an epoch_domain::guard, which announces
+// the global epoch in a per-thread slot; they never block. Writers swap
+// in a new version with an atomic pointer store and then retire() the
+// old one; it is freed once every reader that could still see it has
+// left its critical section.
+constexpr int EPOCH_MAX_READERS = 128;
+
+class epoch_domain {
+public:
+    class guard {
+    public:
+        explicit guard(epoch_domain& d);
+        ~guard();
+        guard(const guard&) = delete;
+        guard& operator=(const guard&) = delete;
+
+    private:
+        epoch_domain& dom_;
+        int slot_;
+    };
+
+    epoch_domain() = default;
+    ~epoch_domain();
+    epoch_domain(const epoch_domain&) = delete;
+    epoch_domain& operator=(const epoch_domain&) = delete;
+
+    // Call after the old version is unreachable from the shared root.
+    void retire(std::function<void()> deleter);
+
+    // Free retired versions no active reader can see; returns how many.
+    size_t reclaim();
+
+    size_t pending() const;
+
+private:
+    int  acquire_slot();
+    void release_slot(int slot);
+
+    struct alignas(64) reader_slot {
+        std::atomic<uint64_t> epoch{0};   // 0: not in a critical section
+        std::atomic<bool> owned{false};
+    };
+
+    std::atomic<uint64_t> global_{1};
+    reader_slot slots_[EPOCH_MAX_READERS];
+
+    mutable std::mutex retire_mu_;
+    std::vector<std::pair<uint64_t, std::function<void()>>> retired_;
+};
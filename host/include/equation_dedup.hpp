@@ -0,0 +1,54 @@
+// include/equation_dedup.hpp
+#pragma once
+
+#include "recipe_decoder.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Per-flow filter in front of the decoder. Many RECIPE equations repeat
+// an earlier xor_set exactly (degree-1 equations for the same hop,
+// replace actions at the last hops); they carry no new information and
+// are dropped here. A repeat whose pint differs from the first copy can
+// only come from corruption, and is reported as a conflict. It is not a
+// win in front of the elimination decoders, which reduce a duplicate as
+// cheaply and see the conflict anyway; multi_flow_decoder leaves it off
+// unless asked (set_dedup()).
+enum class dedup_result {
+    fresh,      // first time this xor_set is seen, pass to the decoder
+    duplicate,  // same xor_set and pint as before, drop
+    conflict,   // same xor_set, different pint: corrupted equation
+};
+
+class equation_dedup {
+public:
+    dedup_result check(const packet_equation& eq);
+
+    size_t unique()     const { return entries_.size(); }
+    size_t duplicates() const { return duplicates_; }
+    size_t conflicts()  const { return conflicts_; }
+
+    void clear();
+
+    // The table is stored as is, so load() does no rehashing.
+    void save(std::vector<uint8_t>& out) const;
+    bool load(snapshot_cursor& in);
+
+private:
+    struct entry {
+        hop_mask xor_set;
+        uint16_t pint;
+    };
+
+    void grow();
+
+    // Open-addressing table of fingerprints (0 = empty slot) with the
+    // matching index into entries_. The stored mask is compared on every
+    // hit, so a fingerprint collision never drops a fresh equation.
+    std::vector<uint64_t> fps_;
+    std::vector<uint32_t> slot_entry_;
+    std::vector<entry> entries_;
+    size_t duplicates_ = 0;
+    size_t conflicts_  = 0;
+};
@@ -0,0 +1,33 @@
+// include/flow_sampler.hpp
+#pragma once
+
+#include "multi_flow_decoder.hpp"
+
+#include <cstdint>
+
+// Consistent hash-based flow sampling. The decision is a pure function
+// of the flow's (src, dst, protocol) -- the fields the switch hashes --
+// and a salt, so every packet of a flow gets the same answer on every
+// worker and across restarts: a sampled flow keeps all of its equations
+// and still converges, an unsampled one is only counted.
+class flow_sampler {
+public:
+    explicit flow_sampler(double rate = 1.0, uint32_t salt = 0) : salt_(salt) {
+        if (rate >= 1.0)      threshold_ = UINT64_C(1) << 32;
+        else if (rate <= 0.0) threshold_ = 0;
+        else threshold_ = static_cast<uint64_t>(rate * 4294967296.0);
+    }
+
+    bool sampled(const flow_key& key) const {
+        // Re-mixed with the salt so the choice is independent of the
+        // flow_key_hash() based worker sharding
+        uint32_t h = mix32(static_cast<uint32_t>(flow_key_hash()(key)) ^ salt_ ^ 0x5A17C0DEu);
+        return h < threshold_;
+    }
+
+    double rate() const { return static_cast<double>(threshold_) / 4294967296.0; }
+
+private:
+    uint64_t threshold_;
+    uint32_t salt_;
+};
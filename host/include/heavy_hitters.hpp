@@ -0,0 +1,77 @@
+// include/heavy_hitters.hpp
+#pragma once
+
+#include "snapshot.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Approximate traffic counters with bounded memory.
+//
+// count_min never underestimates; with width w and depth d the
+// overestimate is at most 2N/w with probability 1 - 2^-d, N being the
+// total count. All d row indices come from one 64-bit hash of the key
+// (h1 + i*h2), so an update costs one hash and d increments. Sketches
+// with the same shape merge by adding cells, across workers or hosts.
+class count_min {
+public:
+    count_min(int depth = 4, int width = 4096);   // width: power of two
+
+    // Returns the key's estimate after the update.
+    uint64_t add(uint64_t key, uint64_t n = 1);
+    uint64_t estimate(uint64_t key) const;
+    uint64_t total() const { return total_; }
+
+    bool merge(const count_min& o);   // false on a shape mismatch
+    size_t memory_bytes() const { return cells_.size() * sizeof(uint64_t); }
+
+    void save(std::vector<uint8_t>& out) const;
+    bool load(snapshot_cursor& in);
+
+private:
+    int depth_;
+    uint64_t mask_;
+    uint64_t total_ = 0;
+    std::vector<uint64_t> cells_;   // [row][col]
+};
+
+// count_min plus the k keys with the largest estimates, kept in an
+// indexed min-heap so an update is O(log k) on top of the sketch.
+class heavy_hitters {
+public:
+    explicit heavy_hitters(size_t k = 64, int depth = 4, int width = 4096);
+
+    void add(uint64_t key, uint64_t n = 1);
+
+    // Largest first.
+    std::vector<std::pair<uint64_t, uint64_t>> top() const;
+    uint64_t estimate(uint64_t key) const { return cm_.estimate(key); }
+    uint64_t total() const { return cm_.total(); }
+
+    // Sketches add up; the candidate sets are re-ranked against the
+    // merged sketch and cut back to k.
+    bool merge(const heavy_hitters& o);
+    size_t memory_bytes() const;
+
+    void save(std::vector<uint8_t>& out) const;
+    bool load(snapshot_cursor& in);
+
+private:
+    struct entry {
+        uint64_t key;
+        uint64_t count;
+    };
+
+    void offer(uint64_t key, uint64_t est);
+    void sift_up(size_t i);
+    void sift_down(size_t i);
+    void place(size_t i, const entry& e);
+
+    size_t k_;
+    count_min cm_;
+    std::vector<entry> heap_;                   // min-heap on count
+    std::unordered_map<uint64_t, size_t> pos_;  // key -> heap index
+};
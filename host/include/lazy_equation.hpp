@@ -0,0 +1,127 @@
+// include/lazy_equation.hpp
+#pragma once
+
+#include "recipe_decoder.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+// Equations whose xor_set is rebuilt only when the decoder asks for it.
+//
+// A received packet only carries (pktid, path length, pint); its xor_set
+// is a replay of the APA over the whole path. Replaying every packet up
+// front is wasted once the flow decodes early. A lazy_equation keeps the
+// three received fields, and xor_set_cache materializes xor_sets on
+// demand, keeping the most recent ones. A pktid's xor_set depends only
+// on the APA and the path length, so with the fixed-hash variant flows
+// also share the cached sets.
+struct lazy_equation {
+    uint32_t pktid    = 0;
+    uint16_t num_hops = 0;
+    uint16_t pint     = 0;
+};
+
+// LRU of materialized xor_sets for one APA, keyed by (pktid, path
+// length). Not thread safe: one cache per decoding thread.
+class xor_set_cache {
+public:
+    explicit xor_set_cache(const apa_t& apa, size_t capacity = 4096)
+        : apa_(apa), capacity_(capacity) {}
+
+    // reconstruct_xor_set() on a miss.
+    hop_mask get(uint32_t pktid, int num_hops);
+    hop_mask get(const lazy_equation& eq) { return get(eq.pktid, eq.num_hops); }
+    // Cached xor_set without touching the LRU order; nullptr on a miss.
+    const hop_mask* peek(uint32_t pktid, int num_hops) const {
+        auto it = index_.find(key(pktid, num_hops));
+        return it == index_.end() ? nullptr : &it->second->second;
+    }
+
+    packet_equation materialize(const lazy_equation& eq) {
+        return packet_equation{eq.pktid, eq.pint, get(eq)};
+    }
+
+    size_t size()            const { return lru_.size(); }
+    size_t hits()            const { return hits_; }
+    size_t reconstructions() const { return reconstructions_; }
+
+    void clear();
+
+private:
+    static uint64_t key(uint32_t pktid, int num_hops) {
+        return static_cast<uint64_t>(num_hops) << 32 | pktid;
+    }
+
+    using entry = std::pair<uint64_t, hop_mask>;
+
+    const apa_t& apa_;
+    size_t capacity_;
+    std::list<entry> lru_;   // most recently used first
+    std::unordered_map<uint64_t, std::list<entry>::iterator> index_;
+    size_t hits_            = 0;
+    size_t reconstructions_ = 0;
+};
+
+// LT peeling decoder over lazy equations.
+//
+// add() only queues the equation. decode() pulls queued equations one at
+// a time and peels them. Equations whose xor_set is already cached come
+// first, lowest degree first, as they cost nothing; the degree of the
+// others is unknown until they are reconstructed.
+//
+// A degree-1 equation resolves its hop, which is substituted into every
+// equation holding it, lowering their degree; equations that drop to
+// degree 1 join the ripple and are resolved next. The pulled equations
+// also feed an online_decoder, so pulling stops as soon as either
+// peeling has resolved every hop or the rank is full, in which case the
+// hops come from its back-substitution. Equations still queued then are never
+// reconstructed. decode() may be called again after more add()s.
+class peeling_decoder {
+public:
+    peeling_decoder(int num_hops, xor_set_cache& cache);
+
+    void add(const lazy_equation& eq) { pending_.push_back(eq); ++received_; }
+
+    // False (with the state kept) until the queued equations suffice.
+    bool decode(std::vector<uint16_t>& switch_ids);
+
+    int    num_hops()     const { return num_hops_; }
+    int    peeled()       const { return peeled_; }   // hops resolved by peeling
+    int    rank()         const { return elim_.rank(); }
+    bool   eliminated()   const { return eliminated_; }
+    size_t received()     const { return received_; }
+    size_t materialized() const { return materialized_; }
+    // Equations received but never reconstructed
+    size_t avoided()      const { return received_ - materialized_; }
+
+    void reset();
+
+private:
+    void pull(const lazy_equation& eq);
+    void resolve(int hop, uint16_t value);
+    void peel();
+
+    struct residual {
+        hop_mask xor_set;   // unresolved hops only
+        uint16_t pint;
+        int degree;
+    };
+
+    int num_hops_;
+    xor_set_cache& cache_;
+    online_decoder elim_;
+    std::vector<lazy_equation> pending_;
+    size_t next_ = 0;                // pending_[next_..] not pulled yet
+
+    std::vector<residual> eqs_;
+    std::vector<uint32_t> ripple_;   // equations at degree 1
+    hop_mask resolved_;
+    std::vector<uint16_t> values_;
+    int peeled_ = 0;
+    bool eliminated_ = false;
+    size_t received_     = 0;
+    size_t materialized_ = 0;
+};
@@ -0,0 +1,81 @@
+// include/markowitz_solver.hpp
+#pragma once
+
+#include "recipe_decoder.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Batch solver for solve_switch_ids() with Markowitz pivoting.
+//
+// Column-order elimination (online_decoder) pivots on the lowest column
+// of whatever row comes next, so the pivot rows fill in with late hops
+// and every row that meets them pays for it, once more in the
+// back-substitution. Here the pivot (r, c) is chosen to minimize the
+// Markowitz count (deg(r) - 1) * (count(c) - 1), the bound on the fill
+// one pivot can cause: singleton rows are peeled at no cost, and sparse
+// rows are spent on columns few other rows hold.
+//
+// Rows are hop_masks throughout; at MAX_HOPS columns a row XOR is four
+// words, so what changes is the bookkeeping. While the active matrix is
+// sparse, column counts are kept up to date and each pivot is searched
+// for. Once the density of what is left exceeds `dense_fill`, the
+// remaining core is eliminated in plain column order, without counts.
+// Rows are only eliminated below their pivot (LU form), and the hops are
+// read back in reverse pivot order.
+//
+// On the robust APAs this saves 20-35% of the row operations and 60-80%
+// of the back-substitution, but the search and the column counts cost
+// more than four-word XORs do, and column order is still 2-4x faster
+// (decoder_bench pivot). solve_switch_ids() therefore keeps it.
+enum class pivot_order {
+    column,      // online_decoder's order, the whole matrix dense
+    markowitz,   // sparse Markowitz phase, then a dense core
+};
+
+struct elimination_stats {
+    size_t rows          = 0;   // equations given
+    size_t row_xors      = 0;   // row operations before back-substitution
+    size_t back_xors     = 0;   // 16-bit XORs in back-substitution
+    int    sparse_pivots = 0;
+    int    dense_pivots  = 0;
+    int    max_degree    = 0;   // widest row seen, i.e. the worst fill
+};
+
+class markowitz_solver {
+public:
+    explicit markowitz_solver(int num_hops, pivot_order order = pivot_order::markowitz,
+                              double dense_fill = 0.2);
+
+    // Same contract as solve_switch_ids(): false unless the equations
+    // have full rank and agree with each other.
+    bool solve(const std::vector<packet_equation>& eqs, std::vector<uint16_t>& switch_ids);
+
+    const elimination_stats& stats() const { return stats_; }
+
+private:
+    void load(const std::vector<packet_equation>& eqs);
+    bool sparse_phase();
+    bool dense_phase();
+    bool drop_if_empty(uint32_t r);
+    void widen(int degree) { if (degree > stats_.max_degree) stats_.max_degree = degree; }
+
+    int num_hops_;
+    pivot_order order_;
+    double dense_fill_;
+
+    std::vector<hop_mask> rows_;
+    std::vector<uint16_t> rhs_;
+    std::vector<int> degree_;
+    std::vector<uint32_t> active_;   // rows not pivoted or dropped
+    std::vector<int> count_;         // active rows holding each column
+    hop_mask open_;                  // columns without a pivot
+    size_t nonzeros_ = 0;            // set bits over the active rows
+
+    struct pivot { uint32_t row; int col; };
+    std::vector<pivot> pivots_;      // in elimination order
+    bool inconsistent_ = false;
+
+    elimination_stats stats_;
+};
@@ -0,0 +1,196 @@
+// include/multi_flow_decoder.hpp
+#pragma once
+
+#include "equation_dedup.hpp"
+#include "partial_path.hpp"
+#include "readiness_model.hpp"
+#include "recipe_decoder.hpp"
+#include "snapshot.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// Flow identity: the same (src, dst, protocol) fields the switch hashes.
+struct flow_key {
+    uint32_t src_addr = 0;
+    uint32_t dst_addr = 0;
+    uint8_t  protocol = 0;
+
+    bool operator==(const flow_key& o) const {
+        return src_addr == o.src_addr && dst_addr == o.dst_addr &&
+               protocol == o.protocol;
+    }
+};
+
+struct flow_key_hash {
+    size_t operator()(const flow_key& k) const {
+        return static_cast<size_t>(mix32(k.src_addr ^ mix32(k.dst_addr ^ k.protocol)));
+    }
+};
+
+// Decodes many flows at once. Flows from the same source share their
+// first `shared_prefix` hops (ToR, aggregation) in a fat tree, so once
+// one flow of a source is decoded its prefix IDs are substituted into
+// the other flows of that source as known values.
+//
+// The substituted prefix is trusted: an assisted flow is published as
+// soon as it reaches full rank. With ECMP, flows of one source may leave
+// through different uplinks, so the path stays provisional. Every later
+// equation of the flow is checked against the published switch IDs, and
+// a partial_path_decoder over the flow's own equations watches the
+// prefix hops. A mismatch retracts the path and rebuilds the flow from
+// its own equations; once they determine the prefix and agree with it,
+// the path is final. A wrong prefix that the system already contradicts
+// (0 = pint) is dropped before anything is published.
+// Equations that contradict each other (0 = pint without a substituted
+// prefix) mark the flow as suspect of corruption.
+class multi_flow_decoder {
+public:
+    multi_flow_decoder(int num_hops, int shared_prefix);
+
+    // Returns true when this equation completed the flow's path.
+    bool add_equation(const flow_key& key, const packet_equation& eq);
+
+    // Move the keys of flows decoded since the last call into `out`
+    // (including flows completed by a substituted prefix). A retracted
+    // flow comes out again once it decodes from its own equations.
+    void drain_decoded(std::vector<flow_key>& out);
+
+    // Decoded path of a flow, or nullptr if not decoded yet (or evicted,
+    // or retracted). Lookups are not const: they may bring a flow in
+    // from a restored snapshot (see load()).
+    const std::vector<uint16_t>* path(const flow_key& key);
+    // True while a published path rests on an unconfirmed prefix.
+    bool provisional(const flow_key& key);
+    // True while the decoder holds state for the flow.
+    bool has_flow(const flow_key& key) { return find_flow(key) != nullptr; }
+
+    // Nothing is dropped on its own. evict_decoded() frees the state of
+    // flows already handed out by drain_decoded(), except provisional
+    // ones; a later equation of such a flow starts it afresh, so callers
+    // keeping the paths (the collector's path_store) check there first.
+    // evict_idle() drops undecoded flows that received no equation since
+    // the previous evict_idle(), appending their keys, and makes silent
+    // provisional paths final; called once per idle period, a flow goes
+    // after one to two periods of silence.
+    size_t evict_decoded();
+    void evict_idle(std::vector<flow_key>& evicted);
+
+    // True once the flow's own equations contradict each other (or,
+    // with dedup, a duplicate xor_set arrived with a different pint).
+    bool suspect(const flow_key& key);
+
+    // Off by default: an equation_dedup in front of each flow. It buys
+    // nothing here: elimination already catches every conflicting
+    // duplicate, and dropping one hides the contradiction, so corrupted
+    // flows can decode to a wrong path. It is not faster either; even at
+    // 256 hops, where 54% of the equations before decoding repeat an
+    // xor_set, it costs ~15% (decoder_bench dedup).
+    void set_dedup(bool on) { dedup_ = on; }
+
+    // Expected further packets before the flow decodes (0 once decoded),
+    // or -1 without a readiness model or for an unknown flow.
+    void set_readiness_model(const readiness_model* model) { model_ = model; }
+    double expected_remaining(const flow_key& key);
+
+    // Whole decoder state as the SNAP_DECODER section (see snapshot.hpp):
+    // a head block with the counters, decoded keys and known prefixes,
+    // an open-addressed flow index and one checksummed record per flow.
+    // load() replaces the current state and fails unless num_hops and
+    // shared_prefix match. It reads the head block only; the index is
+    // probed in place and a flow's record is parsed (and checked) the
+    // first time the flow is touched, so `snap` is kept open until every
+    // restored flow was touched or evicted. Decoded flows are queued for
+    // drain_decoded() again so consumers can rebuild what they derived
+    // from them.
+    void save(std::vector<uint8_t>& out) const;
+    bool load(std::shared_ptr<const snapshot_reader> snap);
+
+    size_t num_flows()      const { return flows_.size() + restored_.left; }
+    size_t decoded_flows()  const { return decoded_; }
+    size_t assisted_flows() const { return assisted_; }
+    // Provisional paths, and published paths an equation contradicted.
+    size_t provisional_flows() const;
+    // Flows of a restored snapshot not touched yet.
+    size_t restored_flows() const { return restored_.left; }
+    size_t retractions()       const { return retractions_; }
+    // Substituted prefixes dropped, before or after publishing.
+    size_t assist_failures() const { return assist_failures_; }
+    size_t duplicates_dropped() const { return duplicates_; }
+    size_t dedup_conflicts()    const { return conflicts_; }
+    size_t idle_evictions()     const { return idle_evicted_; }
+
+private:
+    struct flow_state {
+        explicit flow_state(int num_hops) : dec(num_hops), ready(num_hops) {}
+
+        online_decoder dec;
+        equation_dedup dedup;
+        readiness_tracker ready;
+        std::vector<packet_equation> log;  // own equations, for rebuilds
+        // Own equations only, while the path is provisional
+        std::unique_ptr<partial_path_decoder> own;
+        std::vector<uint16_t> switch_ids;
+        bool decoded        = false;
+        bool provisional    = false;       // decoded on an unconfirmed prefix
+        bool assisted       = false;       // prefix substituted
+        bool assist_refused = false;       // prefix proved wrong once
+        bool suspect        = false;       // contradicting equations
+        uint32_t sweep      = 0;           // evict_idle() round of the last equation
+    };
+
+    // Flows of the last load() still in the snapshot mapping
+    struct restored_index {
+        std::shared_ptr<const snapshot_reader> file;   // keeps the mapping
+        const uint8_t* base = nullptr;                 // the decoder section
+        size_t bytes = 0;
+        size_t index = 0;                              // offset of the slots
+        size_t slots = 0;                              // power of two
+        std::vector<uint8_t> taken;                    // by slot
+        size_t left        = 0;                        // untaken records
+        size_t provisional = 0;                        // of them
+        uint32_t sweep     = 0;                        // sweep_ at load
+    };
+
+    struct source_group {
+        bool prefix_known = false;
+        std::vector<uint16_t> prefix;
+        std::vector<flow_key> pending;     // undecoded flows of this source
+    };
+
+    flow_state* find_flow(const flow_key& key);
+    long restored_slot(const flow_key& key) const;
+    bool restored_flags(size_t slot, uint32_t& flags) const;
+    flow_state* materialize(const flow_key& key, size_t slot);
+    void drop_restored(size_t slot);
+    void evict_restored(std::vector<flow_key>& evicted);
+
+    bool try_finish(const flow_key& key, flow_state& fs);
+    int  prefix_verdict(const flow_key& key, const flow_state& fs) const;
+    void check_provisional(const flow_key& key, flow_state& fs, const packet_equation& eq);
+    void finalize(flow_state& fs);
+    void substitute_prefix(flow_state& fs, const source_group& grp);
+    void rebuild_unassisted(flow_state& fs);
+    void publish_prefix(const flow_key& key, const flow_state& fs);
+
+    int num_hops_;
+    int shared_prefix_;
+    const readiness_model* model_ = nullptr;
+    bool dedup_ = false;
+    std::unordered_map<flow_key, flow_state, flow_key_hash> flows_;
+    std::unordered_map<uint32_t, source_group> groups_;
+    std::vector<flow_key> newly_decoded_;
+    std::vector<flow_key> drained_;        // decoded and handed out, not evicted
+    restored_index restored_;
+    uint32_t sweep_         = 0;
+    size_t decoded_         = 0;
+    size_t assisted_        = 0;
+    size_t assist_failures_ = 0;
+    size_t retractions_     = 0;
+    size_t duplicates_      = 0;
+    size_t conflicts_       = 0;
+    size_t idle_evicted_    = 0;
+};
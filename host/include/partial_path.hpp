@@ -0,0 +1,75 @@
+// include/partial_path.hpp
+#pragma once
+
+#include "recipe_decoder.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// Partial-path decoding: hops are reported as soon as their switch ID is
+// uniquely determined, long before the system reaches full rank. An
+// operator after the ToR or the spine only needs the first or last hops.
+//
+// The basis is kept in reduced row echelon form: every pivot column
+// appears in its own row only. A hop is determined exactly when its row
+// has shrunk to its pivot bit, i.e. it depends on no free column. Such a
+// row never changes again, so each hop is reported once, in resolution
+// order, with the equation count and the time it resolved at.
+
+struct resolved_hop {
+    int      hop;
+    uint16_t switch_id;
+    uint32_t equations;                              // received when it resolved
+    std::chrono::steady_clock::time_point at;
+};
+
+class partial_path_decoder {
+public:
+    using clock = std::chrono::steady_clock;
+
+    explicit partial_path_decoder(int num_hops);
+
+    // Returns the number of hops this equation resolved; they are
+    // appended to resolved(). `at` is the arrival time to stamp them with.
+    int add_equation(const hop_mask& xor_set, uint16_t pint, clock::time_point at = clock::now());
+    int add_equation(const packet_equation& eq, clock::time_point at = clock::now()) {
+        return add_equation(eq.xor_set, eq.pint, at);
+    }
+
+    int  num_hops()   const { return num_hops_; }
+    int  rank()       const { return rank_; }
+    bool solved()     const { return known_count() == num_hops_; }
+    // False once a redundant equation disagreed with the basis (0 = pint).
+    bool consistent() const { return !inconsistent_; }
+    size_t equations() const { return equations_; }
+
+    bool            known(int hop) const { return known_.test(hop); }
+    const hop_mask& known_hops()   const { return known_; }
+    int             known_count()  const { return static_cast<int>(resolved_.size()); }
+    // Only meaningful for known hops.
+    uint16_t switch_id(int hop) const { return rhs_[static_cast<size_t>(hop)]; }
+    const std::vector<resolved_hop>& resolved() const { return resolved_; }
+
+    // Known hops from the source end (ToR first) and from the far end.
+    int known_prefix() const;
+    int known_suffix() const;
+
+    // All hops; fails until every hop is known.
+    bool solve(std::vector<uint16_t>& switch_ids) const;
+
+    void reset();
+
+private:
+    void settle(int col, clock::time_point at);
+
+    int num_hops_;
+    int rank_          = 0;
+    bool inconsistent_ = false;
+    size_t equations_  = 0;
+    hop_mask pivots_;              // columns that own a basis row
+    hop_mask known_;               // pivot rows reduced to their pivot bit
+    std::vector<hop_mask> rows_;   // rows_[c] holds pivot column c only
+    std::vector<uint16_t> rhs_;
+    std::vector<resolved_hop> resolved_;
+};
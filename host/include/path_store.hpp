@@ -0,0 +1,126 @@
+// include/path_store.hpp
+#pragma once
+
+#include "compressed_bitmap.hpp"
+#include "epoch.hpp"
+#include "multi_flow_decoder.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Decoded paths. Identical paths are interned once and referenced by a
+// dense path id; flows map to path ids, and an inverted index maps every
+// (switch ID, hop) to the compressed bitmap of path ids that traverse it,
+// so "which flows cross switch X at hop Y" is one bitmap walk.
+//
+// The flow -> path table is read without locks: it is split into small
+// open-addressing shards behind one root pointer, and writers publish a batch
+// by copying the touched shards and the root, then swapping the root
+// (RCU). Old versions are reclaimed through an epoch_domain. Interned
+// paths are append-only, so path ids stay valid for readers forever.
+// Writers and the inverted-index queries serialize on a mutex.
+constexpr size_t FLOW_TABLE_SHARDS = 4096;
+constexpr size_t PATH_CHUNK_SIZE   = 4096;
+constexpr size_t PATH_MAX_CHUNKS   = 65536;
+
+class path_store {
+public:
+    using update = std::pair<flow_key, std::vector<uint16_t>>;
+
+    path_store();
+    ~path_store();
+    path_store(const path_store&) = delete;
+    path_store& operator=(const path_store&) = delete;
+
+    // Returns the path id the flow now maps to.
+    uint32_t publish(const flow_key& key, const std::vector<uint16_t>& path);
+    // One root swap for the whole batch; the cheap way to publish.
+    void publish_batch(const std::vector<update>& updates);
+
+    // Lock-free readers.
+    bool lookup(const flow_key& key, std::vector<uint16_t>& path) const;
+    bool path_id(const flow_key& key, uint32_t& id) const;
+    std::vector<uint16_t> path(uint32_t id) const;
+    // Interned path of the flow, or nullptr; it stays valid for the
+    // store's lifetime, even after the flow moves to another path.
+    const std::vector<uint16_t>* find(const flow_key& key) const;
+    size_t size() const { return num_flows_.load(std::memory_order_relaxed); }
+    size_t num_paths() const { return num_paths_.load(std::memory_order_acquire); }
+
+    // Path ids through `switch_id` at `hop`, and the flows on them.
+    compressed_bitmap paths_through(uint16_t switch_id, int hop) const;
+    void flows_through(uint16_t switch_id, int hop,
+                       std::vector<flow_key>& out) const;
+    // Flows whose path matches every (switch_id, hop) pair given.
+    void flows_through_all(const std::vector<std::pair<uint16_t, int>>& hops,
+                           std::vector<flow_key>& out) const;
+    // Every flow with its current path id (snapshots); lock-free.
+    void all_flows(std::vector<std::pair<flow_key, uint32_t>>& out) const;
+
+    // Stable across stores and hosts, unlike path ids.
+    static uint64_t path_fingerprint(const std::vector<uint16_t>& path);
+    bool path_by_fingerprint(uint64_t fp, uint32_t& id) const;
+
+    size_t index_bytes() const;  // inverted index footprint
+    size_t retired_versions() const { return epoch_.pending(); }
+
+private:
+    struct flow_entry {
+        flow_key key;
+        uint32_t path_id;
+        const std::vector<uint16_t>* path;   // nullptr: empty slot
+    };
+    // Header of one allocation; `mask + 1` entries follow it, so a lookup
+    // touches the root, one shard line and the path.
+    struct flow_shard {
+        uint32_t count;
+        uint32_t mask;
+        flow_entry* slots() { return reinterpret_cast<flow_entry*>(this + 1); }
+        const flow_entry* slots() const {
+            return reinterpret_cast<const flow_entry*>(this + 1);
+        }
+        static flow_shard* make(uint32_t count);
+        static void destroy(const flow_shard* s);
+    };
+    struct flow_root {
+        const flow_shard* shards[FLOW_TABLE_SHARDS] = {};
+    };
+
+    static uint32_t index_key(uint16_t switch_id, int hop) {
+        return (static_cast<uint32_t>(hop) << 16) | switch_id;
+    }
+    static size_t shard_of(const flow_key& key) {
+        return flow_key_hash()(key) % FLOW_TABLE_SHARDS;
+    }
+    static uint32_t slot_of(const flow_key& key) {
+        return mix32(static_cast<uint32_t>(flow_key_hash()(key)) ^ 0x27D4EB2Fu);
+    }
+
+    const std::vector<uint16_t>& stored_path(uint32_t id) const {
+        return path_chunks_[id / PATH_CHUNK_SIZE].load(std::memory_order_acquire)
+            [id % PATH_CHUNK_SIZE];
+    }
+    static const flow_entry* find_entry(const flow_shard* shard, const flow_key& key);
+    // Slot holding `key`, or the empty slot it would go into.
+    static flow_entry* probe(flow_shard* shard, const flow_key& key);
+    uint32_t intern(const std::vector<uint16_t>& path);
+    void append_flows(const compressed_bitmap& ids, std::vector<flow_key>& out) const;
+
+    mutable epoch_domain epoch_;
+    std::atomic<flow_root*> root_;
+    std::atomic<size_t> num_flows_{0};
+
+    std::unique_ptr<std::atomic<std::vector<uint16_t>*>[]> path_chunks_;
+    std::atomic<uint32_t> num_paths_{0};
+
+    mutable std::mutex mu_;                                      // writers, index
+    std::vector<std::vector<flow_key>> flows_by_path_;           // by path id
+    std::unordered_map<uint64_t, std::vector<uint32_t>> by_fp_;  // fingerprint -> ids
+    std::unordered_map<uint32_t, compressed_bitmap> index_;      // (hop, switch) -> ids
+};
@@ -0,0 +1,247 @@
+// include/reactor.hpp
+#pragma once
+
+#include <sys/socket.h>
+#include <sys/types.h>
+
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Single-threaded coroutine runtime for the host tools: an epoll reactor
+// with timers, and awaitables for non-blocking recv/sendto/sleep. One
+// thread can then serve many sockets and flows, each written as a plain
+// loop, without blocking syscalls or usleep pacing.
+//
+//   task echo(reactor& r, int fd) {
+//       for (;;) {
+//           ssize_t n = co_await async_recv(r, fd, buf, sizeof(buf));
+//           co_await r.sleep_for(std::chrono::milliseconds(1));
+//       }
+//   }
+//   reactor r;
+//   r.spawn(echo(r, fd));
+//   r.run();
+//
+// Sockets are registered edge-triggered on first use. Every awaitable
+// tries its syscall first and waits only on EAGAIN, so no edge is lost.
+// At most one coroutine may wait to read and one to write per socket.
+//
+// A coroutine whose socket always has data would never suspend, so each
+// resume gets `inline_ops` (default REACTOR_INLINE_OPS) immediate
+// completions; the next awaitable goes through the ready list instead,
+// behind socket events and due timers, and retries its syscall there.
+constexpr int REACTOR_INLINE_OPS = 64;
+
+class reactor;
+
+// Coroutine return type. A task starts suspended and runs once spawned
+// on a reactor (detached: it frees itself when done) or co_awaited by
+// another task (which resumes when it finishes).
+class task {
+public:
+    struct promise_type {
+        std::coroutine_handle<> continuation;
+
+        task get_return_object() {
+            return task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        auto final_suspend() noexcept {
+            struct final_awaiter {
+                bool await_ready() noexcept { return false; }
+                std::coroutine_handle<> await_suspend(
+                    std::coroutine_handle<promise_type> h) noexcept {
+                    std::coroutine_handle<> next = h.promise().continuation;
+                    if (next) return next;
+                    h.destroy();   // detached
+                    return std::noop_coroutine();
+                }
+                void await_resume() noexcept {}
+            };
+            return final_awaiter{};
+        }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    task(task&& o) noexcept : h_(std::exchange(o.h_, {})) {}
+    task& operator=(task&&) = delete;
+    ~task() {
+        if (h_) h_.destroy();
+    }
+
+    auto operator co_await() && noexcept {
+        struct awaiter {
+            std::coroutine_handle<promise_type> h;
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept {
+                h.promise().continuation = caller;
+                return h;
+            }
+            void await_resume() noexcept {}
+        };
+        return awaiter{h_};
+    }
+
+private:
+    friend class reactor;
+    explicit task(std::coroutine_handle<promise_type> h) : h_(h) {}
+
+    std::coroutine_handle<promise_type> h_;
+};
+
+// A pending socket operation; the reactor calls attempt() when the
+// socket becomes ready and resumes the waiter once it returns true.
+struct io_waiter {
+    virtual bool attempt() = 0;
+    std::coroutine_handle<> waiter;
+
+protected:
+    ~io_waiter() = default;
+};
+
+class reactor {
+public:
+    using clock = std::chrono::steady_clock;
+
+    explicit reactor(int inline_ops = REACTOR_INLINE_OPS);
+    ~reactor();
+    reactor(const reactor&) = delete;
+    reactor& operator=(const reactor&) = delete;
+
+    bool ok() const { return epfd_ >= 0; }
+
+    // Runs the task up to its first suspension, then leaves it to run().
+    void spawn(task t);
+
+    // Dispatches socket readiness and timers until stop() is called or
+    // nothing is left to wait for. Tasks still suspended at stop() are
+    // not resumed again (nor freed).
+    void run();
+    void stop() { stopped_ = true; }
+
+    // Drop a socket's registration before closing it.
+    void forget(int fd);
+
+    auto sleep_until(clock::time_point t) {
+        struct awaiter {
+            reactor& r;
+            clock::time_point t;
+            bool await_ready() const { return clock::now() >= t; }
+            void await_suspend(std::coroutine_handle<> h) { r.add_timer(t, h); }
+            void await_resume() const {}
+        };
+        return awaiter{*this, t};
+    }
+    auto sleep_for(clock::duration d) { return sleep_until(clock::now() + d); }
+
+    // Used by the socket awaitables below: false once this resume used
+    // up its inline completions, after which the awaitable calls defer()
+    // rather than wait().
+    bool inline_op() { return ++inline_ops_ <= inline_limit_; }
+    void wait(int fd, bool for_write, io_waiter* w);
+    void defer(int fd, bool for_write, io_waiter* w);
+
+private:
+    struct fd_waiters {
+        io_waiter* reader = nullptr;
+        io_waiter* writer = nullptr;
+    };
+    struct deferred {
+        int fd;
+        bool for_write;
+        io_waiter* w;
+    };
+    struct timer {
+        clock::time_point when;
+        uint64_t seq;   // FIFO among equal deadlines
+        std::coroutine_handle<> h;
+        bool operator>(const timer& o) const {
+            return when != o.when ? when > o.when : seq > o.seq;
+        }
+    };
+
+    void add_timer(clock::time_point t, std::coroutine_handle<> h);
+    void dispatch(int fd, uint32_t events);
+    void fire_timers();
+    void run_ready();
+    void resume(std::coroutine_handle<> h) {
+        inline_ops_ = 0;
+        h.resume();
+    }
+
+    int epfd_ = -1;
+    bool stopped_ = false;
+    size_t io_waiting_ = 0;
+    uint64_t timer_seq_ = 0;
+    int inline_limit_;
+    int inline_ops_ = 0;
+    std::unordered_map<int, fd_waiters> fds_;
+    std::deque<deferred> ready_;
+    std::priority_queue<timer, std::vector<timer>, std::greater<timer>> timers_;
+};
+
+// co_await async_recv(...) / async_sendto(...): bytes transferred, or
+// -errno on failure.
+class async_recv : public io_waiter {
+public:
+    async_recv(reactor& r, int fd, void* buf, size_t len)
+        : r_(r), fd_(fd), buf_(buf), len_(len) {}
+
+    bool attempt() override;
+    bool await_ready() {
+        deferred_ = !r_.inline_op();
+        return !deferred_ && attempt();
+    }
+    void await_suspend(std::coroutine_handle<> h) {
+        waiter = h;
+        if (deferred_) r_.defer(fd_, false, this);
+        else           r_.wait(fd_, false, this);
+    }
+    ssize_t await_resume() const { return result_; }
+
+private:
+    reactor& r_;
+    int fd_;
+    void* buf_;
+    size_t len_;
+    ssize_t result_ = 0;
+    bool deferred_  = false;
+};
+
+class async_sendto : public io_waiter {
+public:
+    async_sendto(reactor& r, int fd, const void* buf, size_t len,
+                 const struct sockaddr* addr, socklen_t addrlen)
+        : r_(r), fd_(fd), buf_(buf), len_(len), addr_(addr), addrlen_(addrlen) {}
+
+    bool attempt() override;
+    bool await_ready() {
+        deferred_ = !r_.inline_op();
+        return !deferred_ && attempt();
+    }
+    void await_suspend(std::coroutine_handle<> h) {
+        waiter = h;
+        if (deferred_) r_.defer(fd_, true, this);
+        else           r_.wait(fd_, true, this);
+    }
+    ssize_t await_resume() const { return result_; }
+
+private:
+    reactor& r_;
+    int fd_;
+    const void* buf_;
+    size_t len_;
+    const struct sockaddr* addr_;
+    socklen_t addrlen_;
+    ssize_t result_ = 0;
+    bool deferred_  = false;
+};
@@ -0,0 +1,83 @@
+// include/readiness_model.hpp
+#pragma once
+
+#include "recipe_decoder.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Expected number of further packets a flow needs before it decodes.
+//
+// The model is built once per (APA, path length) by running the encoder
+// and decoder on simulated flows, and tabulating the mean number of
+// packets still needed given the flow's current rank and how many hops
+// no equation has touched yet. Uncovered hops stand in for the degree
+// distribution of the outstanding unknowns: each one still needs the
+// APA to hit it, which for late hops can take many packets even when
+// the rank is close to full. Lookup is O(1). Against a rank-only table
+// it mostly pays off late in a flow, where the rank alone cannot tell a
+// flow waiting on one rarely hit hop from one that is nearly done.
+//
+// Building the table simulates thousands of flows (seconds at 256 hops),
+// so it is not done on a decoder's first use: shared() hands out one
+// model per APA and path length for the whole process, and loads it from
+// a table file saved by an earlier build when there is one.
+constexpr int      READINESS_TRIALS      = 2000;
+constexpr long     READINESS_MAX_PACKETS = 50000;
+constexpr uint32_t READINESS_SEED        = 0xC0FFEE;
+
+class readiness_model {
+public:
+    // Simulate `trials` flows; returns false if none decoded within
+    // max_packets (e.g. APA shorter than num_hops).
+    bool build(const apa_t& apa, int num_hops, int trials,
+               long max_packets, uint32_t seed);
+
+    // Table file (a snapshot with one SNAP_READINESS section). load()
+    // fails if the file is missing, corrupt or built for another APA.
+    bool save(const std::string& path) const;
+    bool load(const std::string& path, const apa_t& apa, int num_hops);
+
+    // The process-wide model of (APA, num_hops): loaded from `table` if
+    // it holds one, else built with the defaults above and saved there
+    // (when `table` is not empty). Later calls for the same APA return
+    // the same model. nullptr if it cannot be built.
+    static std::shared_ptr<const readiness_model> shared(const apa_t& apa, int num_hops,
+                                                         const std::string& table = "");
+
+    // Mean remaining packets at (rank, uncovered); falls back to the
+    // rank-only estimate when the cell was seen too rarely.
+    double expected_remaining(int rank, int uncovered) const;
+    double expected_remaining(int rank) const;
+
+    int num_hops() const { return num_hops_; }
+
+private:
+    size_t cell(int rank, int uncovered) const {
+        return static_cast<size_t>(rank) * (num_hops_ + 1) + uncovered;
+    }
+
+    int num_hops_ = 0;
+    uint64_t fingerprint_ = 0;      // apa_fingerprint(apa, num_hops_)
+    std::vector<double> by_rank_;   // [rank]
+    std::vector<double> by_cell_;   // [rank][uncovered], < 0 if unknown
+};
+
+// Per-flow state that the model needs besides the decoder rank.
+// observe() is O(1) (a fixed number of mask words).
+struct readiness_tracker {
+    hop_mask covered;
+    int uncovered = 0;
+
+    explicit readiness_tracker(int num_hops = 0) : uncovered(num_hops) {}
+
+    void observe(const hop_mask& xor_set) {
+        for (int k = 0; k < HOP_MASK_WORDS; ++k) {
+            uint64_t fresh = xor_set.w[k] & ~covered.w[k];
+            uncovered -= __builtin_popcountll(fresh);
+            covered.w[k] |= fresh;
+        }
+    }
+};
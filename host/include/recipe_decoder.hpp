@@ -0,0 +1,241 @@
+// include/recipe_decoder.hpp
+#pragma once
+
+#include "snapshot.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// C++ port of the RECIPE encoder/decoder in decoding_murmur.py.
+// Switch IDs (and PINT values) are 16 bits wide; paths are at most
+// MAX_HOPS long, matching the 256-entry base_idx table on the switch.
+
+constexpr int MAX_HOPS           = 256;
+constexpr int MAX_DEGREE_DEFAULT = 32;
+constexpr int HOP_MASK_WORDS     = MAX_HOPS / 64;
+
+// xor_set of an equation as a MAX_HOPS-bit mask (bit i <=> hop i).
+struct hop_mask {
+    uint64_t w[HOP_MASK_WORDS] = {};
+
+    void set(int i)        { w[i >> 6] |=  (uint64_t{1} << (i & 63)); }
+    void clear(int i)      { w[i >> 6] &= ~(uint64_t{1} << (i & 63)); }
+    bool test(int i) const { return (w[i >> 6] >> (i & 63)) & 1; }
+
+    bool empty() const {
+        for (int k = 0; k < HOP_MASK_WORDS; ++k) {
+            if (w[k]) return false;
+        }
+        return true;
+    }
+
+    // Lowest hop in the set, or -1 if empty.
+    int lowest() const {
+        for (int k = 0; k < HOP_MASK_WORDS; ++k) {
+            if (w[k]) return k * 64 + __builtin_ctzll(w[k]);
+        }
+        return -1;
+    }
+
+    int count() const {
+        int c = 0;
+        for (int k = 0; k < HOP_MASK_WORDS; ++k) c += __builtin_popcountll(w[k]);
+        return c;
+    }
+
+    hop_mask& operator^=(const hop_mask& o) {
+        for (int k = 0; k < HOP_MASK_WORDS; ++k) w[k] ^= o.w[k];
+        return *this;
+    }
+
+    bool operator==(const hop_mask& o) const {
+        for (int k = 0; k < HOP_MASK_WORDS; ++k) {
+            if (w[k] != o.w[k]) return false;
+        }
+        return true;
+    }
+    bool operator!=(const hop_mask& o) const { return !(*this == o); }
+
+    // 64-bit fingerprint (splitmix64 finalizer folded over the words).
+    uint64_t fingerprint() const {
+        uint64_t h = 0x9E3779B97F4A7C15ull;
+        for (int k = 0; k < HOP_MASK_WORDS; ++k) {
+            h ^= w[k] + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2);
+            h ^= h >> 30;
+            h *= 0xBF58476D1CE4E5B9ull;
+            h ^= h >> 27;
+            h *= 0x94D049BB133111EBull;
+            h ^= h >> 31;
+        }
+        return h;
+    }
+
+    static hop_mask single(int i) {
+        hop_mask m;
+        m.set(i);
+        return m;
+    }
+};
+
+// -------------------------------------------------------------------
+// Hashing (same constants as decoding_murmur.py / table_generation.py)
+// -------------------------------------------------------------------
+
+// constexpr, so tables and checks built from them cost nothing at run
+// time (recipe_decoder.cpp static_asserts vectors from recipe_hash.csv).
+constexpr uint32_t mix32(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7FEB352Du;
+    x ^= x >> 15;
+    x *= 0x846CA68Bu;
+    x ^= x >> 16;
+    return x;
+}
+
+constexpr uint32_t recipe_hash_v4(uint32_t pktid, uint32_t hopid) {
+    uint32_t pid      = mix32(pktid);
+    uint32_t combined = pid ^ (hopid * 0x9E3779B9u) ^ 0xA5A5A5A5u;
+    return mix32(combined);
+}
+
+// -------------------------------------------------------------------
+// APA (Action Probability Array)
+// Per line (hop): t_add_deg0, t_rep_deg0, t_add_deg1, t_rep_deg1, ...
+// Probabilities are scaled to 32-bit thresholds.
+// -------------------------------------------------------------------
+
+struct apa_image_info;
+
+struct apa_t {
+    int max_hops   = 0;
+    int max_degree = MAX_DEGREE_DEFAULT;
+    std::vector<uint32_t> add_thresh;      // idx = hop * max_degree + degree
+    std::vector<uint32_t> replace_thresh;  // idx = hop * max_degree + degree
+    // Compiled-in copy of these thresholds, set by load_apa() (see
+    // apa_image.hpp); reset it after editing the thresholds by hand.
+    const apa_image_info* image = nullptr;
+};
+
+bool load_apa(const std::string& path, apa_t& apa,
+              int max_degree = MAX_DEGREE_DEFAULT);
+
+// -------------------------------------------------------------------
+// Packet equations: XOR_{i in xor_set} switch_id[i] = pint
+// -------------------------------------------------------------------
+
+struct packet_equation {
+    uint32_t pktid = 0;
+    uint16_t pint  = 0;
+    hop_mask xor_set;
+};
+
+// Replay the switch's add/replace/skip decisions for one packet over
+// num_hops hops and return the resulting xor_set. Only (pktid, hop) and
+// the APA drive the decisions, so the receiver can rebuild it exactly.
+hop_mask reconstruct_xor_set(const apa_t& apa, int num_hops, uint32_t pktid);
+
+// The same replay for any per-hop hash: hash_of_hop(hop) is the packet's
+// 32-bit hash_id at that hop (see crc_hash.hpp for the CRC variant).
+template <typename HopHash>
+hop_mask replay_xor_set(const apa_t& apa, int num_hops, HopHash&& hash_of_hop) {
+    hop_mask xor_set;
+    int xor_degree = 0;
+    for (int hop = 0; hop < num_hops; ++hop) {
+        size_t idx = static_cast<size_t>(hop) * apa.max_degree + xor_degree;
+        if (idx >= apa.add_thresh.size()) break;
+
+        uint32_t hash_id = hash_of_hop(hop);
+        if (hash_id < apa.add_thresh[idx]) {
+            // ADD: include this hop in the XOR set
+            xor_set.set(hop);
+            ++xor_degree;
+        } else if (hash_id > apa.replace_thresh[idx]) {
+            // REPLACE: reset to just this hop
+            xor_set = hop_mask::single(hop);
+            xor_degree = 1;
+        }
+        // otherwise SKIP
+    }
+    return xor_set;
+}
+
+// Encode one packet over a path with the given per-hop switch IDs.
+packet_equation encode_packet(const apa_t& apa, uint32_t pktid,
+                              const std::vector<uint16_t>& switch_ids);
+
+// -------------------------------------------------------------------
+// Online decoder: Gaussian elimination over GF(2), one equation at a
+// time. The coefficient matrix is shared by all 16 bit planes of the
+// switch IDs, so rows carry the whole 16-bit pint as their RHS and the
+// elimination runs once for every bit (bit-sliced).
+// -------------------------------------------------------------------
+
+class online_decoder {
+public:
+    explicit online_decoder(int num_hops);
+
+    // Returns true if the equation increased the rank.
+    bool add_equation(const hop_mask& xor_set, uint16_t pint);
+    bool add_equation(const packet_equation& eq) {
+        return add_equation(eq.xor_set, eq.pint);
+    }
+
+    int  num_hops()   const { return num_hops_; }
+    int  rank()       const { return rank_; }
+    bool solved()     const { return rank_ == num_hops_; }
+    // False once a redundant equation disagreed with the basis (0 = pint).
+    bool consistent() const { return !inconsistent_; }
+
+    // Back-substitution; fails unless the system has full rank.
+    bool solve(std::vector<uint16_t>& switch_ids) const;
+
+    void reset();
+
+    // Basis rows only; load() fails on a different num_hops.
+    void save(std::vector<uint8_t>& out) const;
+    bool load(snapshot_cursor& in);
+
+private:
+    int num_hops_;
+    int rank_         = 0;
+    bool inconsistent_ = false;
+    hop_mask pivots_;              // columns that own a basis row
+    std::vector<hop_mask> rows_;   // rows_[c] has lowest set bit c
+    std::vector<uint16_t> rhs_;
+};
+
+// -------------------------------------------------------------------
+// Rank monitor: tracks only whether a flow has become decodable. The
+// basis keeps coefficient rows without RHS, and only the equations that
+// raised the rank are kept (at most num_hops), so solve() can replay
+// them through an online_decoder on demand. Redundant equations are
+// dropped unchecked, i.e. the monitor does not detect inconsistency.
+// -------------------------------------------------------------------
+
+class rank_monitor {
+public:
+    explicit rank_monitor(int num_hops);
+
+    // Returns true if the equation increased the rank.
+    bool add_equation(const packet_equation& eq);
+
+    int  num_hops() const { return num_hops_; }
+    int  rank()     const { return static_cast<int>(basis_eqs_.size()); }
+    bool solved()   const { return rank() == num_hops_; }
+
+    // Full back-substitution over the retained equations.
+    bool solve(std::vector<uint16_t>& switch_ids) const;
+
+    void reset();
+
+private:
+    int num_hops_;
+    hop_mask pivots_;
+    std::vector<hop_mask> rows_;                // rows_[c] has lowest set bit c
+    std::vector<packet_equation> basis_eqs_;    // rank-raising equations
+};
+
+// Decode a batch of equations (equivalent of solve_switch_ids()).
+bool solve_switch_ids(const std::vector<packet_equation>& eqs, int num_hops,
+                      std::vector<uint16_t>& switch_ids);
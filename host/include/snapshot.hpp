@@ -0,0 +1,127 @@
+// include/snapshot.hpp
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Crash-safe state snapshots in one memory-mapped file.
+//
+// A snapshot is a header, a section table and the raw sections, in a
+// fixed binary layout. open() maps the file and checks the header and
+// the section table only; each section carries its own checksum, which
+// find() verifies when the section is asked for. A section that is used
+// in place straight from the mapping (the multi_flow_decoder's flow
+// index) skips that and checks its records as it touches them, so a
+// restore costs the pages it reads. A live snapshot is never modified.
+// commit() fills a fresh file through a shared mapping, syncs it,
+// renames it over the previous one and syncs the directory, so a crash
+// at any point leaves either the old or the new snapshot intact.
+//
+// Values are written field by field (snapshot_put), never as structs
+// with padding, so no uninitialized byte reaches the file.
+constexpr uint32_t SNAPSHOT_MAGIC   = 0x50534352;  // "RCSP"
+constexpr uint32_t SNAPSHOT_VERSION = 2;
+
+enum snapshot_section : uint32_t {
+    SNAP_DECODER   = 1,   // multi_flow_decoder
+    SNAP_COLLECTOR = 2,   // collector worker identity
+    SNAP_RECEIVER  = 3,   // host_receive progress
+    SNAP_PATHS     = 4,   // collector worker flows evicted into the path_store
+    SNAP_READINESS = 5,   // readiness_model tables
+};
+
+#pragma pack(push, 1)
+struct snapshot_h {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t num_sections;
+    uint32_t reserved;
+    uint64_t generation;
+    uint64_t bytes;        // whole file
+    uint64_t checksum;     // the section table
+};
+
+struct snapshot_section_h {
+    uint32_t id;
+    uint32_t reserved;
+    uint64_t offset;       // from the start of the file, 8-byte aligned
+    uint64_t bytes;
+    uint64_t checksum;     // the section's bytes
+};
+#pragma pack(pop)
+
+uint64_t snapshot_checksum(const uint8_t* p, size_t n);
+
+// Append `n` values to a section buffer. T must have no padding, or
+// its uninitialized bytes would be written out (and checksummed).
+template <typename T>
+inline void snapshot_put(std::vector<uint8_t>& out, const T* v, size_t n = 1) {
+    static_assert(std::has_unique_object_representations_v<T>,
+                  "snapshot_put: type has padding, write its fields instead");
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(v);
+    out.insert(out.end(), p, p + n * sizeof(T));
+}
+
+// Bounds-checked reader over one section.
+class snapshot_cursor {
+public:
+    snapshot_cursor() = default;
+    snapshot_cursor(const uint8_t* data, size_t bytes)
+        : p_(data), end_(data + bytes) {}
+
+    template <typename T>
+    bool get(T* v, size_t n = 1) {
+        size_t len = n * sizeof(T);
+        if (static_cast<size_t>(end_ - p_) < len) return false;
+        std::memcpy(v, p_, len);
+        p_ += len;
+        return true;
+    }
+
+    bool done() const { return p_ == end_; }
+    const uint8_t* pos() const { return p_; }
+    size_t left() const { return static_cast<size_t>(end_ - p_); }
+
+private:
+    const uint8_t* p_   = nullptr;
+    const uint8_t* end_ = nullptr;
+};
+
+class snapshot_writer {
+public:
+    // New, empty section buffer; valid until commit().
+    std::vector<uint8_t>& section(uint32_t id);
+
+    // Write all sections to `path` (via `path`.tmp and rename).
+    bool commit(const std::string& path, uint64_t generation);
+
+private:
+    std::vector<std::pair<uint32_t, std::vector<uint8_t>>> sections_;
+};
+
+class snapshot_reader {
+public:
+    snapshot_reader() = default;
+    ~snapshot_reader() { close(); }
+    snapshot_reader(const snapshot_reader&) = delete;
+    snapshot_reader& operator=(const snapshot_reader&) = delete;
+
+    // False if the file is missing, truncated, or its header or section
+    // table fails the checksum. Sections are not read yet.
+    bool open(const std::string& path);
+    void close();
+
+    // False if there is no such section, or (with `verify`) it fails its
+    // checksum. Without `verify` the caller checks what it reads.
+    bool find(uint32_t id, snapshot_cursor& cur, bool verify = true) const;
+    uint64_t generation() const;
+
+private:
+    const uint8_t* base_ = nullptr;
+    size_t bytes_        = 0;
+};
@@ -1,14 +1,64 @@
 // include/socket_utils.hpp
 #pragma once
+#include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
-int open_raw_socket(const std::string& ifname, int& ifindex_out);
+// protocol: ethertype to capture, ETH_P_ALL (3) for every frame
+int open_raw_socket(const std::string& ifname, int& ifindex_out,
+                    uint16_t protocol = 0x0003);
 
 bool send_frame(int sockfd,
                 const std::vector<uint8_t>& frame,
                 int ifindex,
                 const uint8_t dst_mac[6]);
 
-bool recv_frame(int sockfd, std::vector<uint8_t>& buffer);
\ No newline at end of file
+bool recv_frame(int sockfd, std::vector<uint8_t>& buffer);
+
+// -------------------------------------------------------------------
+// Batched frame I/O on one raw socket, with interchangeable backends:
+//   socket  recv/sendto, one syscall per frame (as above)
+//   mmsg    recvmmsg/sendmmsg, one syscall per batch
+//   uring   io_uring: one multishot recv feeding a provided-buffer ring,
+//           one SQE per sent frame submitted per batch, optional SQPOLL
+// -------------------------------------------------------------------
+
+struct frame_view {
+    uint8_t* data;
+    size_t   len;
+};
+
+class frame_transport {
+public:
+    virtual ~frame_transport() = default;
+
+    // Up to `max` received frames appended to `out`, waiting up to
+    // timeout_ms for the first (-1: forever, 0: never). The views stay
+    // valid until the next recv_batch(). Returns frames received, or -1.
+    virtual int recv_batch(std::vector<frame_view>& out, size_t max, int timeout_ms) = 0;
+
+    // Sends the frames (Ethernet header included) out of the interface
+    // and returns how many were sent; the data may be reused on return.
+    virtual int send_batch(const std::vector<frame_view>& frames) = 0;
+
+    virtual const char* name() const = 0;
+};
+
+struct transport_options {
+    size_t frame_size = 2048;   // receive buffer per frame
+    size_t frames     = 1024;   // receive buffers (uring: power of two)
+    bool   sqpoll     = false;  // uring: kernel thread polls the SQ
+};
+
+// kind: "socket", "mmsg" or "uring"; nullptr (with a message) if the
+// kind is unknown or the kernel refuses it. The socket stays owned by
+// the caller.
+std::unique_ptr<frame_transport> make_transport(const std::string& kind, int sockfd,
+                                                int ifindex,
+                                                const transport_options& opt = {});
+
+// Defined in uring_transport.cpp
+std::unique_ptr<frame_transport> make_uring_transport(int sockfd, int ifindex,
+                                                      const transport_options& opt);
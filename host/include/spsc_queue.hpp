@@ -0,0 +1,68 @@
+// include/spsc_queue.hpp
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Bounded lock-free queue for exactly one producer and one consumer
+// thread. Items move in batches: one acquire load of the other side's
+// index and one release store per batch, not per item. head_ and tail_
+// sit on separate cache lines so the two threads do not bounce a line
+// on every push/pop. Items should be small descriptors (copied in and
+// out), not the data they describe.
+template <typename T>
+class spsc_queue {
+public:
+    explicit spsc_queue(size_t capacity = 1024) {
+        size_t cap = 2;
+        while (cap < capacity) cap <<= 1;
+        mask_ = cap - 1;
+        slots_.resize(cap);
+    }
+
+    spsc_queue(const spsc_queue&) = delete;
+    spsc_queue& operator=(const spsc_queue&) = delete;
+
+    // Producer: enqueue up to n items, returns how many fit.
+    size_t push(const T* items, size_t n) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t room = capacity() - (tail - head_.load(std::memory_order_acquire));
+        if (n > room) n = room;
+        for (size_t i = 0; i < n; ++i) slots_[(tail + i) & mask_] = items[i];
+        tail_.store(tail + n, std::memory_order_release);
+        size_t depth = capacity() - room + n;
+        if (depth > high_water_.load(std::memory_order_relaxed)) {
+            high_water_.store(depth, std::memory_order_relaxed);
+        }
+        return n;
+    }
+
+    // Consumer: dequeue up to max items into out, returns how many.
+    size_t pop(T* out, size_t max) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t n    = tail_.load(std::memory_order_acquire) - head;
+        if (n > max) n = max;
+        for (size_t i = 0; i < n; ++i) out[i] = slots_[(head + i) & mask_];
+        head_.store(head + n, std::memory_order_release);
+        return n;
+    }
+
+    // Approximate from any other thread.
+    size_t size() const {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+    size_t capacity() const { return mask_ + 1; }
+
+    // Deepest the queue has been since the last call (producer-side
+    // samples, so exact only up to a race with the sampler).
+    size_t take_high_water() { return high_water_.exchange(size()); }
+
+private:
+    size_t mask_ = 0;
+    std::vector<T> slots_;
+    alignas(64) std::atomic<size_t> head_{0};          // consumer
+    alignas(64) std::atomic<size_t> tail_{0};          // producer
+    alignas(64) std::atomic<size_t> high_water_{0};
+};
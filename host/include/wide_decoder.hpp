@@ -0,0 +1,104 @@
+// include/wide_decoder.hpp
+#pragma once
+
+#include "recipe_decoder.hpp"
+
+#include <cstdint>
+#include <vector>
+
+// Wide switch IDs (32 or 64 bits) over the 16-bit pint. Each packet
+// carries one 16-bit fragment of every ID on its xor_set; which fragment
+// is chosen per packet by a hash of pktid, so every switch agrees on it
+// without extra header bits. Fragment f of all hops forms its own 16-bit
+// system, decoded with the same bit-sliced online_decoder.
+
+template <int Fragments>
+struct wide_id_traits {
+    static_assert(Fragments >= 1 && Fragments <= 4,
+                  "wide IDs are limited to 64 bits (4 fragments)");
+    static constexpr int id_bits = 16 * Fragments;
+};
+
+// Fragment index carried by a packet. Salted so it is independent of the
+// per-hop recipe_hash_v4 decisions for the same pktid.
+template <int Fragments>
+inline int wide_fragment_index(uint32_t pktid) {
+    return static_cast<int>(mix32(pktid ^ 0x5BD1E995u) % Fragments);
+}
+
+inline uint16_t wide_fragment(uint64_t id, int fragment) {
+    return static_cast<uint16_t>(id >> (16 * fragment));
+}
+
+struct wide_equation {
+    uint32_t pktid    = 0;
+    int      fragment = 0;
+    uint16_t pint     = 0;
+    hop_mask xor_set;
+};
+
+template <int Fragments>
+wide_equation encode_wide_packet(const apa_t& apa, uint32_t pktid,
+                                 const std::vector<uint64_t>& switch_ids) {
+    wide_equation eq;
+    eq.pktid    = pktid;
+    eq.fragment = wide_fragment_index<Fragments>(pktid);
+    eq.xor_set  = reconstruct_xor_set(apa, static_cast<int>(switch_ids.size()), pktid);
+    for (int hop = 0; hop < static_cast<int>(switch_ids.size()); ++hop) {
+        if (eq.xor_set.test(hop)) eq.pint ^= wide_fragment(switch_ids[hop], eq.fragment);
+    }
+    return eq;
+}
+
+template <int Fragments>
+class wide_decoder {
+public:
+    static constexpr int id_bits = wide_id_traits<Fragments>::id_bits;
+
+    explicit wide_decoder(int num_hops)
+        : parts_(Fragments, online_decoder(num_hops)) {}
+
+    // Returns true if the equation increased the rank of its fragment.
+    bool add_equation(const wide_equation& eq) {
+        return parts_[eq.fragment].add_equation(eq.xor_set, eq.pint);
+    }
+
+    // Sum of the fragment ranks; full rank is Fragments * num_hops.
+    int rank() const {
+        int r = 0;
+        for (const auto& p : parts_) r += p.rank();
+        return r;
+    }
+
+    bool solved() const {
+        for (const auto& p : parts_) {
+            if (!p.solved()) return false;
+        }
+        return true;
+    }
+
+    bool consistent() const {
+        for (const auto& p : parts_) {
+            if (!p.consistent()) return false;
+        }
+        return true;
+    }
+
+    bool solve(std::vector<uint64_t>& switch_ids) const {
+        if (!solved()) return false;
+        std::vector<uint16_t> frag;
+        switch_ids.assign(static_cast<size_t>(parts_[0].num_hops()), 0);
+        for (int f = 0; f < Fragments; ++f) {
+            if (!parts_[f].solve(frag)) return false;
+            for (size_t h = 0; h < frag.size(); ++h) {
+                switch_ids[h] |= static_cast<uint64_t>(frag[h]) << (16 * f);
+            }
+        }
+        return true;
+    }
+
+    const online_decoder& fragment(int f) const { return parts_[f]; }
+
+private:
+    std::vector<online_decoder> parts_;  // one 16-bit system per fragment
+};
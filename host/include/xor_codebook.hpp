@@ -0,0 +1,92 @@
+// include/xor_codebook.hpp
+#pragma once
+
+#include "recipe_decoder.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Precomputed xor_sets for the fixed-hash variant (tofino_fixed_hash).
+//
+// There the switch looks hash_id up by (pkt_id, hop_count) in find_hash,
+// with pkt_id the IPv4 identification, so a packet's xor_set depends only
+// on the APA, the path length and its pkt_id, never on the flow. The
+// codebook replays reconstruct_xor_set() once for a contiguous pkt_id
+// range and stores one fixed-stride bitmask per pkt_id. The file is
+// mapped read-only and shared, so every flow and every process on the
+// host reads the same pages, and a lookup is one indexed load.
+constexpr uint32_t CODEBOOK_MAGIC   = 0x42435258;  // "XRCB"
+constexpr uint32_t CODEBOOK_VERSION = 1;
+
+#pragma pack(push, 1)
+struct codebook_h {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t num_hops;
+    uint32_t words;          // uint64_t per xor_set: ceil(num_hops / 64)
+    uint32_t first_pktid;
+    uint32_t count;
+    uint64_t apa_fingerprint;
+    uint64_t bytes;          // whole file
+};
+#pragma pack(pop)
+
+// Identifies (APA, num_hops): the thresholds of the first num_hops hops.
+uint64_t apa_fingerprint(const apa_t& apa, int num_hops);
+
+class xor_codebook {
+public:
+    xor_codebook() = default;
+    ~xor_codebook() { close(); }
+    xor_codebook(const xor_codebook&) = delete;
+    xor_codebook& operator=(const xor_codebook&) = delete;
+
+    // Replay pkt_ids [first_pktid, first_pktid + count) into memory.
+    bool build(const apa_t& apa, int num_hops, uint32_t first_pktid, uint32_t count);
+
+    bool save(const std::string& path) const;
+
+    // Map a saved codebook; false if it is missing, truncated or corrupt.
+    bool open(const std::string& path);
+    void close();
+
+    // True if this codebook was built for the APA at num_hops.
+    bool matches(const apa_t& apa, int num_hops) const {
+        return masks_ && static_cast<uint32_t>(num_hops) == hdr_.num_hops &&
+               apa_fingerprint(apa, num_hops) == hdr_.apa_fingerprint;
+    }
+
+    bool contains(uint32_t pktid) const {
+        return masks_ && pktid - hdr_.first_pktid < hdr_.count;
+    }
+
+    // xor_set of pktid; false outside the range.
+    bool lookup(uint32_t pktid, hop_mask& xor_set) const {
+        if (!contains(pktid)) return false;
+        const uint64_t* m = masks_ + static_cast<size_t>(pktid - hdr_.first_pktid) * hdr_.words;
+        xor_set = hop_mask{};
+        for (uint32_t k = 0; k < hdr_.words; ++k) xor_set.w[k] = m[k];
+        return true;
+    }
+
+    int      num_hops()    const { return static_cast<int>(hdr_.num_hops); }
+    uint32_t first_pktid() const { return hdr_.first_pktid; }
+    uint32_t count()       const { return hdr_.count; }
+    size_t   bytes()       const { return static_cast<size_t>(hdr_.bytes); }
+    uint64_t fingerprint() const { return hdr_.apa_fingerprint; }
+    bool     mapped()      const { return map_ != nullptr; }
+
+private:
+    codebook_h hdr_{};
+    const uint64_t* masks_ = nullptr;   // into owned_ or map_
+    std::vector<uint64_t> owned_;
+    void* map_       = nullptr;
+    size_t map_bytes_ = 0;
+};
+
+// encode_packet() with the xor_set taken from the codebook; pktid must
+// be in its range.
+packet_equation encode_packet(const xor_codebook& book, uint32_t pktid,
+                              const std::vector<uint16_t>& switch_ids);
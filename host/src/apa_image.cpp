@@ -0,0 +1,137 @@
+// src/apa_image.cpp
+#include "apa_image.hpp"
+#include "crc_hash.hpp"
+
+#include <utility>
+
+#ifdef RECIPE_APA_IMAGE
+#include "apa_image_data.hpp"   // generated into obj/gen by the Makefile
+#endif
+
+// -------------------------------------------------------------------
+// Replay specialized on one image
+// -------------------------------------------------------------------
+
+template <typename Image>
+struct apa_image_replay {
+    // One hop of replay_xor_set() on the image. With a constant hop
+    // (the unrolled replay below) the band, table offset and bit position
+    // fold into immediates, and a REPLACE only clears the words up to the
+    // hop. The branches stay: on long paths most hops SKIP, and the
+    // branchless form measured up to 2.5x slower there.
+    template <typename HopHash>
+    [[gnu::always_inline]] static void step(int hop, hop_mask& xor_set, int& degree,
+                                            HopHash& hash_of_hop) {
+        int lo = Image::lo[hop];
+        bool in_band     = degree >= lo && degree <= Image::hi[hop];
+        uint32_t i       = in_band ? Image::off[hop] + static_cast<uint32_t>(degree - lo) : 0;
+        uint32_t add     = in_band ? Image::add[i] : 0;   // outside the band
+        uint32_t replace = in_band ? Image::rep[i] : 0;   // thresholds are 0
+
+        uint32_t hash_id = hash_of_hop(hop);
+        if (hash_id < add) {
+            xor_set.w[hop / 64] |= uint64_t{1} << (hop % 64);
+            ++degree;
+        } else if (hash_id > replace) {
+            for (int k = 0; k < hop / 64; ++k) xor_set.w[k] = 0;   // words past hop are 0
+            xor_set.w[hop / 64] = uint64_t{1} << (hop % 64);
+            degree = 1;
+        }
+    }
+
+    // Fully unrolled up to UNROLL_HOPS hops. Longer images loop over the
+    // constant-bound bands instead: unrolled, robust256 is ~50 KB of code
+    // per hash, and robust64 already ran slower unrolled than looped.
+    static constexpr int UNROLL_HOPS = 32;
+
+    template <typename HopHash>
+    static hop_mask replay(int num_hops, HopHash&& hash_of_hop) {
+        hop_mask xor_set;
+        int degree = 0;
+        if constexpr (Image::hops <= UNROLL_HOPS) {
+            [&]<int... H>(std::integer_sequence<int, H...>) {
+                // stops at the first hop past num_hops
+                ((H < num_hops ? (step(H, xor_set, degree, hash_of_hop), true) : false) && ...);
+            }(std::make_integer_sequence<int, Image::hops>{});
+        } else {
+            int n = num_hops < Image::hops ? num_hops : Image::hops;
+#pragma GCC unroll 4
+            for (int hop = 0; hop < n; ++hop) step(hop, xor_set, degree, hash_of_hop);
+        }
+        return xor_set;
+    }
+
+    // recipe_hash_v4() with mix32(pktid) taken once per packet; the
+    // hop's multiply then folds into a constant. The hashes are forced
+    // inline, as GCC gives up on them in the larger unrolled replays.
+    static hop_mask replay_v4(int num_hops, uint32_t pktid) {
+        uint32_t pid = mix32(pktid);
+        return replay(num_hops, [pid](int hop) __attribute__((always_inline)) {
+            return mix32(pid ^ (static_cast<uint32_t>(hop) * 0x9E3779B9u) ^ 0xA5A5A5A5u);
+        });
+    }
+
+    static hop_mask replay_crc(int num_hops, uint32_t pkt_term) {
+        return replay(num_hops, [pkt_term](int hop) __attribute__((always_inline)) {
+            return crc_hop_hash{}(pkt_term, hop);
+        });
+    }
+
+    // The loaded APA must agree on every threshold the generic replay can
+    // read. A degree entering hop h is at most h, so with max_degree >=
+    // hops no index runs into the next hop's row.
+    static bool matches(const apa_t& apa) {
+        if (apa.max_hops != Image::hops || apa.max_degree < Image::hops) return false;
+        for (int h = 0; h < Image::hops; ++h) {
+            for (int d = 0; d < apa.max_degree; ++d) {
+                size_t idx = static_cast<size_t>(h) * apa.max_degree + d;
+                uint32_t add = 0, replace = 0;
+                if (d >= Image::lo[h] && d <= Image::hi[h]) {
+                    add     = Image::add[Image::off[h] + static_cast<uint32_t>(d - Image::lo[h])];
+                    replace = Image::rep[Image::off[h] + static_cast<uint32_t>(d - Image::lo[h])];
+                }
+                if (apa.add_thresh[idx] != add || apa.replace_thresh[idx] != replace) return false;
+            }
+        }
+        return true;
+    }
+
+    static apa_image_info info() {
+        size_t kept = 0;
+        for (int h = 0; h < Image::hops; ++h) {
+            if (Image::hi[h] >= Image::lo[h]) kept += static_cast<size_t>(Image::hi[h] - Image::lo[h] + 1);
+        }
+        return apa_image_info{Image::name, Image::hops, kept,
+                              static_cast<size_t>(Image::hops) * Image::degrees,
+                              matches, replay_v4, replay_crc};
+    }
+};
+
+// -------------------------------------------------------------------
+// Registry
+// -------------------------------------------------------------------
+
+template <typename... Images>
+static std::span<const apa_image_info> make_registry() {
+    if constexpr (sizeof...(Images) == 0) {
+        return {};
+    } else {
+        static const apa_image_info images[] = {apa_image_replay<Images>::info()...};
+        return images;
+    }
+}
+
+std::span<const apa_image_info> embedded_apa_images() {
+#ifdef RECIPE_APA_IMAGE
+    return make_registry<APA_IMAGE_LIST>();
+#else
+    return make_registry<>();
+#endif
+}
+
+const apa_image_info* find_apa_image(const apa_t& apa) {
+    for (const apa_image_info& image : embedded_apa_images()) {
+        if (image.matches(apa)) return &image;
+    }
+    return nullptr;
+}
@@ -0,0 +1,511 @@
+// src/collector.cpp
+#include "collector.hpp"
+
+#ifndef __linux__
+#error "collector.cpp requires Linux."
+#endif
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+// -------------------------------------------------------------------
+// Sockets
+// -------------------------------------------------------------------
+
+static int open_unix_dgram(const std::string& path, bool bind_it) {
+    int fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        perror("[collector] socket AF_UNIX");
+        return -1;
+    }
+    struct sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    int rc;
+    if (bind_it) {
+        unlink(path.c_str());
+        rc = bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+    } else {
+        rc = connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+    }
+    if (rc < 0) {
+        perror(bind_it ? "[collector] bind unix" : "[collector] connect unix");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int open_udp_local(int port, bool bind_it) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        perror("[collector] socket AF_INET");
+        return -1;
+    }
+    struct sockaddr_in addr{};
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons(static_cast<uint16_t>(port));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int rc;
+    if (bind_it) {
+        rc = bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+    } else {
+        rc = connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+    }
+    if (rc < 0) {
+        perror(bind_it ? "[collector] bind udp" : "[collector] connect udp");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int open_collector_socket(const std::string& unix_path, int udp_port) {
+    if (!unix_path.empty()) return open_unix_dgram(unix_path, false);
+    return open_udp_local(udp_port, false);
+}
+
+bool send_records(int fd, const equation_record* records, size_t count) {
+    static thread_local std::vector<uint8_t> buf(COLLECTOR_MAX_DATAGRAM);
+    while (count > 0) {
+        size_t n = count < COLLECTOR_MAX_BATCH ? count : COLLECTOR_MAX_BATCH;
+        collector_batch_h hdr{COLLECTOR_MAGIC, static_cast<uint16_t>(n), 0};
+        std::memcpy(buf.data(), &hdr, sizeof(hdr));
+        std::memcpy(buf.data() + sizeof(hdr), records, n * sizeof(equation_record));
+        if (send(fd, buf.data(), sizeof(hdr) + n * sizeof(equation_record), 0) < 0) {
+            perror("[agent] send");
+            return false;
+        }
+        records += n;
+        count   -= n;
+    }
+    return true;
+}
+
+// -------------------------------------------------------------------
+// collector
+// -------------------------------------------------------------------
+
+collector::collector(const collector_config& cfg)
+    : cfg_(cfg), sampler_(cfg.sample_rate, cfg.sample_salt) {
+    if (cfg_.workers < 1) cfg_.workers = 1;
+    for (int i = 0; i < cfg_.workers; ++i) {
+        queues_.push_back(std::make_unique<record_queue>());
+        sketches_.push_back(std::make_unique<traffic_sketch>(
+            cfg_.sketch_k, cfg_.sketch_depth, cfg_.sketch_width));
+    }
+}
+
+collector::~collector() { stop(); }
+
+bool collector::start() {
+    if (running_) return true;
+    if (!cfg_.unix_path.empty()) {
+        int fd = open_unix_dgram(cfg_.unix_path, true);
+        if (fd < 0) return false;
+        fds_.push_back(fd);
+    }
+    if (cfg_.udp_port > 0) {
+        int fd = open_udp_local(cfg_.udp_port, true);
+        if (fd < 0) {
+            close_sockets();   // stop() does nothing before running_ is set
+            return false;
+        }
+        fds_.push_back(fd);
+    }
+    for (int fd : fds_) {
+        // Agents send in bursts; give the kernel room to queue them
+        int rcvbuf = 64 * 1024 * 1024;
+        if (setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf)) < 0) {
+            perror("[collector] setsockopt SO_RCVBUF");
+        }
+    }
+
+    running_ = true;
+    for (int i = 0; i < cfg_.workers; ++i) {
+        workers_.emplace_back(&collector::worker_loop, this, i);
+    }
+    for (int fd : fds_) {
+        ingest_.emplace_back(&collector::ingest_loop, this, fd);
+    }
+    return true;
+}
+
+// Also unlinks the Unix socket path, which start() bound
+void collector::close_sockets() {
+    bool bound_unix = !cfg_.unix_path.empty() && !fds_.empty();
+    for (int fd : fds_) close(fd);
+    fds_.clear();
+    if (bound_unix) unlink(cfg_.unix_path.c_str());
+}
+
+void collector::stop() {
+    if (!running_.exchange(false)) return;
+
+    for (auto& t : ingest_) t.join();
+    ingest_.clear();
+    close_sockets();
+
+    for (auto& q : queues_) {
+        std::lock_guard<std::mutex> lock(q->mu);
+        q->closed = true;
+        q->not_empty.notify_all();
+    }
+    for (auto& t : workers_) t.join();   // each commits a final snapshot
+    workers_.clear();
+}
+
+collector_stats collector::stats() const {
+    collector_stats s;
+    s.received = received_.load(std::memory_order_relaxed);
+    s.rejected = rejected_.load(std::memory_order_relaxed);
+    s.unsampled = unsampled_.load(std::memory_order_relaxed);
+    s.shed      = shed_.load(std::memory_order_relaxed);
+    s.decoded  = decoded_.load(std::memory_order_relaxed);
+    s.idle     = idle_.load(std::memory_order_relaxed);
+    return s;
+}
+
+heavy_hitters collector::top_paths() const {
+    heavy_hitters all(cfg_.sketch_k, cfg_.sketch_depth, cfg_.sketch_width);
+    for (const auto& sk : sketches_) {
+        std::lock_guard<std::mutex> lock(sk->mu);
+        all.merge(sk->paths);
+    }
+    return all;
+}
+
+heavy_hitters collector::top_hops() const {
+    heavy_hitters all(cfg_.sketch_k, cfg_.sketch_depth, cfg_.sketch_width);
+    for (const auto& sk : sketches_) {
+        std::lock_guard<std::mutex> lock(sk->mu);
+        all.merge(sk->hops);
+    }
+    return all;
+}
+
+// Prefix substitution only works between flows of one source in one
+// multi_flow_decoder, so with a shared prefix whole sources go to one
+// worker (at the cost of balance when one source dominates).
+int collector::shard(const flow_key& key) const {
+    size_t h = cfg_.shared_prefix > 0 ? mix32(key.src_addr) : flow_key_hash()(key);
+    return static_cast<int>(h % queues_.size());
+}
+
+void collector::push(int worker, std::vector<equation_record>&& batch) {
+    record_queue& q = *queues_[worker];
+    std::unique_lock<std::mutex> lock(q.mu);
+    q.not_full.wait(lock, [&] { return q.batches.size() < cfg_.queue_batches; });
+    q.batches.push_back(std::move(batch));
+    q.not_empty.notify_one();
+}
+
+void collector::submit(const equation_record* records, size_t count) {
+    std::vector<std::vector<equation_record>> parts(queues_.size());
+    uint64_t bad = 0, skipped = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (records[i].num_hops != cfg_.num_hops) {
+            ++bad;
+            continue;
+        }
+        if (!sampler_.sampled(record_flow(records[i]))) {
+            ++skipped;
+            continue;
+        }
+        parts[shard(record_flow(records[i]))].push_back(records[i]);
+    }
+    received_.fetch_add(count - bad - skipped, std::memory_order_relaxed);
+    rejected_.fetch_add(bad, std::memory_order_relaxed);
+    unsampled_.fetch_add(skipped, std::memory_order_relaxed);
+    for (size_t w = 0; w < parts.size(); ++w) {
+        if (!parts[w].empty()) push(static_cast<int>(w), std::move(parts[w]));
+    }
+}
+
+void collector::ingest_loop(int fd) {
+    std::vector<uint8_t> buf(COLLECTOR_MAX_DATAGRAM);
+    struct pollfd pfd{fd, POLLIN, 0};
+
+    while (running_) {
+        // Let the socket buffer absorb bursts while workers catch up
+        if (congested()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        // Wake up regularly to notice stop()
+        if (poll(&pfd, 1, 100) <= 0) continue;
+
+        ssize_t n = recv(fd, buf.data(), buf.size(), 0);
+        if (n < 0) {
+            perror("[collector] recv");
+            continue;
+        }
+
+        collector_batch_h hdr;
+        if (static_cast<size_t>(n) < sizeof(hdr)) {
+            rejected_.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        std::memcpy(&hdr, buf.data(), sizeof(hdr));
+        if (hdr.magic != COLLECTOR_MAGIC ||
+            static_cast<size_t>(n) != sizeof(hdr) + hdr.count * sizeof(equation_record)) {
+            rejected_.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        submit(reinterpret_cast<const equation_record*>(buf.data() + sizeof(hdr)),
+               hdr.count);
+    }
+}
+
+// False while the snapshot child is still writing; `wait` blocks instead
+static bool reap_snapshot(pid_t& child, bool wait) {
+    if (child <= 0) return true;
+    int status = 0;
+    pid_t r = waitpid(child, &status, wait ? 0 : WNOHANG);
+    if (r == 0) return false;
+    if (r < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        std::cerr << "[collector] snapshot child " << child << " failed\n";
+    }
+    child = -1;
+    return true;
+}
+
+void collector::worker_loop(int id) {
+    record_queue& q = *queues_[id];
+    multi_flow_decoder dec(cfg_.num_hops, cfg_.shared_prefix);
+    std::vector<flow_key> done;
+    std::vector<path_store::update> updates;
+    // Packets per decoded path since the last flush into the sketches
+    // (interned paths of the store), and per flow decoded in this batch,
+    // which is only in the store once published
+    std::unordered_map<const std::vector<uint16_t>*, uint64_t> traffic;
+    std::unordered_map<flow_key, uint64_t, flow_key_hash> fresh;
+    auto last_flush = std::chrono::steady_clock::now();
+
+    // One root swap per batch keeps readers' copy cost amortized. The
+    // decoder then lets go of the flows; the store answers for them.
+    uint64_t counted = 0;   // dec.decoded_flows() added to decoded_
+    auto publish_decoded = [&] {
+        dec.drain_decoded(done);
+        for (const auto& key : done) updates.emplace_back(key, *dec.path(key));
+        store_.publish_batch(updates);
+        // The decoder's count drops again when a path is retracted (see
+        // multi_flow_decoder); unsigned wrap-around keeps the sum right
+        decoded_.fetch_add(static_cast<uint64_t>(dec.decoded_flows()) - counted,
+                           std::memory_order_relaxed);
+        counted = dec.decoded_flows();
+        dec.evict_decoded();
+        // A flow retracted within the batch is not in the store (yet)
+        for (const auto& kv : fresh) {
+            if (const std::vector<uint16_t>* path = store_.find(kv.first)) traffic[path] += kv.second;
+        }
+        fresh.clear();
+        done.clear();
+        updates.clear();
+    };
+
+    bool snapshots = !cfg_.snapshot_path.empty();
+    if (snapshots) {
+        restore_worker(id, dec);
+        publish_decoded();   // restored paths go back into the store
+    }
+    uint64_t generation = 0;
+    pid_t child         = -1;   // snapshot being written
+    auto last_snapshot  = std::chrono::steady_clock::now();
+    auto last_sweep     = last_snapshot;
+    std::vector<flow_key> idle;
+    bool timed = snapshots || cfg_.flow_idle_secs > 0;
+
+    std::unique_ptr<decode_scheduler> sched;
+    if (cfg_.schedule_capacity > 0) {
+        sched = std::make_unique<decode_scheduler>(cfg_.num_hops, cfg_.schedule_capacity,
+                                                   cfg_.schedule_age_weight);
+    }
+    bool congested = false;
+    auto run_scheduled = [&](size_t budget) {
+        sched->run(dec, budget);
+        if (sched->congested() != congested) {
+            congested = sched->congested();
+            congested_workers_.fetch_add(congested ? 1 : -1, std::memory_order_relaxed);
+        }
+    };
+
+    for (;;) {
+        std::vector<equation_record> batch;
+        bool closed = false;
+        {
+            std::unique_lock<std::mutex> lock(q.mu);
+            // With scheduled work pending, only take what is already queued;
+            // with sweeps or snapshots enabled, wake up once a second anyway
+            if (!sched || sched->pending() == 0) {
+                auto ready = [&] { return q.closed || !q.batches.empty(); };
+                if (timed) q.not_empty.wait_for(lock, std::chrono::seconds(1), ready);
+                else       q.not_empty.wait(lock, ready);
+            }
+            if (!q.batches.empty()) {
+                batch = std::move(q.batches.front());
+                q.batches.pop_front();
+                q.not_full.notify_one();
+            }
+            closed = q.closed && q.batches.empty();
+        }
+        if (batch.empty() && closed && (!sched || sched->pending() == 0)) break;
+
+        uint64_t refused = 0;
+        size_t shed_before = sched ? sched->shed() : 0;
+        for (const auto& r : batch) {
+            flow_key key = record_flow(r);
+            if (!dec.has_flow(key)) {
+                if (const std::vector<uint16_t>* path = store_.find(key)) {
+                    ++traffic[path];   // decoded earlier and evicted
+                    continue;
+                }
+            }
+            if (sched && !dec.path(key)) {
+                refused += !sched->push(key, record_equation(r));
+                continue;
+            }
+            dec.add_equation(key, record_equation(r));
+            if (dec.path(key)) {
+                ++fresh[key];
+                if (sched) sched->forget(key);
+            }
+        }
+        if (sched) {
+            run_scheduled(closed ? SIZE_MAX : cfg_.schedule_budget);
+            shed_.fetch_add(refused + sched->shed() - shed_before, std::memory_order_relaxed);
+        }
+        publish_decoded();
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_flush >= std::chrono::milliseconds(SKETCH_FLUSH_MS)) {
+            count_traffic(id, traffic);
+            last_flush = now;
+        }
+        if (cfg_.flow_idle_secs > 0 && now - last_sweep >= std::chrono::seconds(cfg_.flow_idle_secs)) {
+            dec.evict_idle(idle);
+            if (sched) {
+                for (const auto& key : idle) sched->forget(key);
+            }
+            idle_.fetch_add(idle.size(), std::memory_order_relaxed);
+            idle.clear();
+            last_sweep = now;
+        }
+        if (snapshots && now - last_snapshot >= std::chrono::seconds(cfg_.snapshot_secs)) {
+            if (reap_snapshot(child, false)) child = fork_snapshot(id, dec, ++generation);
+            last_snapshot = now;
+        }
+    }
+    if (congested) congested_workers_.fetch_sub(1, std::memory_order_relaxed);
+    count_traffic(id, traffic);
+    if (snapshots) {
+        // The last one in-process, after any child still writing
+        reap_snapshot(child, true);
+        snapshot_worker(id, dec, ++generation);
+    }
+}
+
+// One sketch update per path and hop per flush, not per packet
+void collector::count_traffic(
+    int id, std::unordered_map<const std::vector<uint16_t>*, uint64_t>& traffic) {
+    if (traffic.empty()) return;
+    traffic_sketch& sk = *sketches_[id];
+    std::lock_guard<std::mutex> lock(sk.mu);
+    for (const auto& kv : traffic) {
+        const std::vector<uint16_t>& path = *kv.first;
+        sk.paths.add(path_store::path_fingerprint(path), kv.second);
+        for (size_t hop = 0; hop < path.size(); ++hop) {
+            sk.hops.add(hop_sketch_key(path[hop], static_cast<int>(hop)), kv.second);
+        }
+    }
+    traffic.clear();
+}
+
+// -------------------------------------------------------------------
+// Snapshots: one file per worker, valid only for the same sharding
+// -------------------------------------------------------------------
+
+void collector::restore_worker(int id, multi_flow_decoder& dec) {
+    std::string path = cfg_.snapshot_path + "." + std::to_string(id);
+    auto snap = std::make_shared<snapshot_reader>();
+    if (!snap->open(path)) return;
+
+    snapshot_cursor who;
+    int32_t layout[3];
+    if (!snap->find(SNAP_COLLECTOR, who) || !who.get(layout, 3) ||
+        layout[0] != cfg_.workers || layout[1] != id || layout[2] != (cfg_.shared_prefix > 0)) {
+        std::cerr << "[collector] " << path << " is from another worker layout, ignoring\n";
+        return;
+    }
+    if (!dec.load(snap)) {
+        std::cerr << "[collector] " << path << " does not match --hops/--prefix, ignoring\n";
+        return;
+    }
+
+    // Flows decoded before the snapshot and evicted from the decoder
+    snapshot_cursor paths;
+    std::vector<path_store::update> updates;
+    uint64_t n = 0;
+    if (snap->find(SNAP_PATHS, paths) && paths.get(&n)) {
+        for (uint64_t i = 0; i < n; ++i) {
+            uint32_t key[3];
+            std::vector<uint16_t> ids(static_cast<size_t>(cfg_.num_hops));
+            if (!paths.get(key, 3) || key[2] > 0xFF || !paths.get(ids.data(), ids.size())) break;
+            flow_key k;
+            k.src_addr = key[0];
+            k.dst_addr = key[1];
+            k.protocol = static_cast<uint8_t>(key[2]);
+            updates.emplace_back(k, std::move(ids));
+        }
+        store_.publish_batch(updates);
+    }
+    printf("[collector] worker %d restored %zu flows (%zu decoded) and %zu paths from %s\n",
+           id, dec.num_flows(), dec.decoded_flows(), updates.size(), path.c_str());
+}
+
+// Writes the worker's decoder and its share of the path_store and
+// commits. Runs in a forked child, or in-process at stop().
+bool collector::snapshot_worker(int id, const multi_flow_decoder& dec, uint64_t generation) {
+    snapshot_writer snap;
+    int32_t layout[3] = {cfg_.workers, id, cfg_.shared_prefix > 0};   // by source?
+    snapshot_put(snap.section(SNAP_COLLECTOR), layout, 3);
+    dec.save(snap.section(SNAP_DECODER));
+
+    // Decoded flows live in the store only; keep this worker's share
+    std::vector<std::pair<flow_key, uint32_t>> flows;
+    store_.all_flows(flows);
+    std::vector<uint8_t>& out = snap.section(SNAP_PATHS);
+    uint64_t n = 0;
+    for (const auto& kv : flows) n += shard(kv.first) == id;
+    snapshot_put(out, &n);
+    for (const auto& kv : flows) {
+        if (shard(kv.first) != id) continue;
+        uint32_t key[3] = {kv.first.src_addr, kv.first.dst_addr, kv.first.protocol};
+        std::vector<uint16_t> ids = store_.path(kv.second);
+        snapshot_put(out, key, 3);
+        snapshot_put(out, ids.data(), ids.size());
+    }
+    return snap.commit(cfg_.snapshot_path + "." + std::to_string(id), generation);
+}
+
+// The child sees the worker's state as of the fork, copy-on-write, and
+// touches nothing another thread may have held locked: the decoder is
+// the worker's own and path_store::all_flows() takes no lock.
+pid_t collector::fork_snapshot(int id, const multi_flow_decoder& dec, uint64_t generation) {
+    pid_t pid = fork();
+    if (pid == 0) _exit(snapshot_worker(id, dec, generation) ? 0 : 1);
+    if (pid < 0) perror("[collector] fork");
+    return pid;
+}
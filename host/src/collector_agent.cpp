@@ -0,0 +1,119 @@
+// src/collector_agent.cpp
+//
+// Stand-in host agent: simulates RECIPE flows with the given APA and
+// streams their equation records to a running collector.
+//
+//   ./bin/collector_agent --unix /tmp/recipe_collector.sock --apa ../APA/robust32_1.txt
+//                         [--hops 32] [--flows 1000] [--packets 64] [--agent 1]
+//                         [--codebook /tmp/recipe_codebook.bin]
+//
+// With --codebook the agent emulates the fixed-hash variant: pkt_id is the
+// flow's IPv4 identification counter and xor_sets come from the codebook.
+#include "collector.hpp"
+#include "recipe_decoder.hpp"
+#include "xor_codebook.hpp"
+
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv) {
+    std::string unix_path, apa_path = "../APA/robust32_1.txt", codebook_path;
+    int udp_port = 0, num_hops = 0, flows = 1000, agent = 1;
+    long packets = 64;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string k = argv[i];
+        const char* v = argv[i + 1];
+        if      (k == "--unix")    unix_path = v;
+        else if (k == "--udp")     udp_port  = std::atoi(v);
+        else if (k == "--apa")     apa_path  = v;
+        else if (k == "--hops")    num_hops  = std::atoi(v);
+        else if (k == "--flows")   flows     = std::atoi(v);
+        else if (k == "--packets") packets   = std::atol(v);
+        else if (k == "--agent")   agent     = std::atoi(v);
+        else if (k == "--codebook") codebook_path = v;
+        else {
+            std::cerr << "[agent] Unknown option " << k << "\n";
+            return 1;
+        }
+    }
+    if (unix_path.empty() && udp_port == 0) unix_path = "/tmp/recipe_collector.sock";
+
+    apa_t apa;
+    if (!load_apa(apa_path, apa, MAX_HOPS)) return 1;
+    if (num_hops <= 0 || num_hops > apa.max_hops) num_hops = apa.max_hops;
+
+    xor_codebook book;
+    if (!codebook_path.empty()) {
+        if (!book.open(codebook_path)) return 1;
+        if (!book.matches(apa, num_hops)) {
+            std::cerr << "[agent] " << codebook_path << " was not built for " << apa_path
+                      << " at " << num_hops << " hops\n";
+            return 1;
+        }
+    }
+
+    int fd = open_collector_socket(unix_path, udp_port);
+    if (fd < 0) return 1;
+
+    // Each agent is one source host; flows go to distinct destinations
+    std::mt19937 rng(static_cast<uint32_t>(agent) * 0x9E3779B9u);
+    std::vector<std::vector<uint16_t>> paths(static_cast<size_t>(flows));
+    std::vector<uint32_t> salts(static_cast<size_t>(flows));
+    for (int f = 0; f < flows; ++f) {
+        paths[f].resize(static_cast<size_t>(num_hops));
+        for (auto& id : paths[f]) id = static_cast<uint16_t>(rng());
+        salts[f] = static_cast<uint32_t>(rng());
+    }
+
+    // Interleave flows packet by packet, as a busy host would
+    std::vector<equation_record> batch;
+    batch.reserve(COLLECTOR_MAX_BATCH);
+    long sent = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (long n = 1; n <= packets; ++n) {
+        for (int f = 0; f < flows; ++f) {
+            packet_equation eq;
+            if (book.mapped()) {
+                uint32_t pktid = book.first_pktid() +
+                                 static_cast<uint32_t>((n - 1) % book.count());
+                eq = encode_packet(book, pktid, paths[f]);
+            } else {
+                uint32_t pktid = mix32(salts[f] ^ mix32(static_cast<uint32_t>(n)));
+                eq = encode_packet(apa, pktid, paths[f]);
+            }
+
+            equation_record r{};
+            r.src_addr = htonl(0x0a000000u + static_cast<uint32_t>(agent));
+            r.dst_addr = htonl(0x14000000u + static_cast<uint32_t>(f));
+            r.protocol = 146;
+            r.num_hops = static_cast<uint16_t>(num_hops);
+            r.pint     = eq.pint;
+            r.pktid    = eq.pktid;
+            for (int k = 0; k < HOP_MASK_WORDS; ++k) r.xor_set[k] = eq.xor_set.w[k];
+            batch.push_back(r);
+
+            if (batch.size() == COLLECTOR_MAX_BATCH) {
+                if (!send_records(fd, batch.data(), batch.size())) return 1;
+                sent += static_cast<long>(batch.size());
+                batch.clear();
+            }
+        }
+    }
+    if (!batch.empty() && send_records(fd, batch.data(), batch.size())) {
+        sent += static_cast<long>(batch.size());
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    printf("[agent %d] Sent %ld equations for %d flows in %.2fs\n",
+           agent, sent, flows, secs);
+    close(fd);
+    return 0;
+}
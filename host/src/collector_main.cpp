@@ -0,0 +1,106 @@
+// src/collector_main.cpp
+//
+// Path-tracing collector daemon.
+//
+//   ./bin/collector --unix /tmp/recipe_collector.sock [--udp 9146]
+//                   [--hops 32] [--workers 4] [--prefix 0]
+//                   [--snapshot /var/tmp/recipe_collector.snap] [--snapshot-every 10]
+//                   [--sample 1.0] [--sample-salt 0] [--schedule 0] [--idle-secs 60]
+#include "collector.hpp"
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+
+static volatile std::sig_atomic_t g_stop = 0;
+
+static void handle_signal(int) { g_stop = 1; }
+
+int main(int argc, char** argv) {
+    collector_config cfg;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string k = argv[i];
+        const char* v = argv[i + 1];
+        if      (k == "--unix")    cfg.unix_path     = v;
+        else if (k == "--udp")     cfg.udp_port      = std::atoi(v);
+        else if (k == "--hops")    cfg.num_hops      = std::atoi(v);
+        else if (k == "--workers") cfg.workers       = std::atoi(v);
+        else if (k == "--prefix")  cfg.shared_prefix = std::atoi(v);
+        else if (k == "--snapshot")       cfg.snapshot_path = v;
+        else if (k == "--snapshot-every") cfg.snapshot_secs = std::atoi(v);
+        else if (k == "--idle-secs")      cfg.flow_idle_secs = std::atoi(v);
+        else if (k == "--sample")      cfg.sample_rate = std::atof(v);
+        else if (k == "--schedule")    cfg.schedule_capacity = std::strtoul(v, nullptr, 10);
+        else if (k == "--sample-salt") cfg.sample_salt = static_cast<uint32_t>(std::strtoul(v, nullptr, 0));
+        else {
+            std::cerr << "[collector] Unknown option " << k << "\n";
+            return 1;
+        }
+    }
+    if (cfg.unix_path.empty() && cfg.udp_port == 0) {
+        cfg.unix_path = "/tmp/recipe_collector.sock";
+    }
+    if (cfg.sample_rate <= 0.0 || cfg.sample_rate > 1.0) {
+        std::cerr << "[collector] --sample must be in (0, 1]\n";
+        return 1;
+    }
+    if (cfg.num_hops < 1 || cfg.num_hops > MAX_HOPS) {
+        std::cerr << "[collector] --hops must be in 1.." << MAX_HOPS << "\n";
+        return 1;
+    }
+
+    std::signal(SIGINT, handle_signal);
+    std::signal(SIGTERM, handle_signal);
+
+    collector col(cfg);
+    if (!col.start()) return 1;
+    printf("[collector] Listening on %s%s%s, hops=%d, workers=%d\n",
+           cfg.unix_path.empty() ? "" : cfg.unix_path.c_str(),
+           (!cfg.unix_path.empty() && cfg.udp_port) ? " and " : "",
+           cfg.udp_port ? ("udp 127.0.0.1:" + std::to_string(cfg.udp_port)).c_str() : "",
+           cfg.num_hops, cfg.workers);
+
+    collector_stats prev{};
+    while (!g_stop) {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        collector_stats s = col.stats();
+        printf("[collector] %lu eq/s, %lu rejected, %lu unsampled, %lu shed%s, "
+               "%lu paths decoded, %lu idle flows dropped\n",
+               static_cast<unsigned long>(s.received - prev.received),
+               static_cast<unsigned long>(s.rejected),
+               static_cast<unsigned long>(s.unsampled),
+               static_cast<unsigned long>(s.shed), col.congested() ? " (congested)" : "",
+               static_cast<unsigned long>(s.decoded),
+               static_cast<unsigned long>(s.idle));
+        prev = s;
+    }
+
+    col.stop();
+    printf("[collector] Stopped, %zu paths in store\n", col.store().size());
+
+    heavy_hitters paths = col.top_paths(), hops = col.top_hops();
+    auto top_paths = paths.top();
+    for (size_t i = 0; i < top_paths.size() && i < 5; ++i) {
+        uint32_t id;
+        std::string ids;
+        if (col.store().path_by_fingerprint(top_paths[i].first, id)) {
+            for (uint16_t sw : col.store().path(id)) {
+                ids += (ids.empty() ? "" : "-") + std::to_string(sw);
+            }
+        }
+        printf("[collector] top path %zu: ~%lu packets %s\n", i + 1,
+               static_cast<unsigned long>(top_paths[i].second), ids.c_str());
+    }
+    auto top_hops = hops.top();
+    for (size_t i = 0; i < top_hops.size() && i < 5; ++i) {
+        printf("[collector] top switch %zu: ~%lu packets, switch %lu at hop %lu\n", i + 1,
+               static_cast<unsigned long>(top_hops[i].second),
+               static_cast<unsigned long>(top_hops[i].first & 0xFFFF),
+               static_cast<unsigned long>(top_hops[i].first >> 16));
+    }
+    return 0;
+}
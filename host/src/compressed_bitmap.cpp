@@ -0,0 +1,151 @@
+// src/compressed_bitmap.cpp
+#include "compressed_bitmap.hpp"
+
+#include <algorithm>
+
+compressed_bitmap::chunk* compressed_bitmap::find(uint16_t key) {
+    auto it = std::lower_bound(chunks_.begin(), chunks_.end(), key,
+                               [](const chunk& c, uint16_t k) { return c.key < k; });
+    return (it != chunks_.end() && it->key == key) ? &*it : nullptr;
+}
+
+const compressed_bitmap::chunk* compressed_bitmap::find(uint16_t key) const {
+    return const_cast<compressed_bitmap*>(this)->find(key);
+}
+
+void compressed_bitmap::add(uint32_t v) {
+    uint16_t hi = static_cast<uint16_t>(v >> 16);
+    uint16_t lo = static_cast<uint16_t>(v);
+
+    auto it = std::lower_bound(chunks_.begin(), chunks_.end(), hi,
+                               [](const chunk& c, uint16_t k) { return c.key < k; });
+    if (it == chunks_.end() || it->key != hi) {
+        chunk c;
+        c.key = hi;
+        it = chunks_.insert(it, std::move(c));
+    }
+    chunk& c = *it;
+
+    if (!c.bits.empty()) {
+        uint64_t m = uint64_t{1} << (lo & 63);
+        if (!(c.bits[lo >> 6] & m)) {
+            c.bits[lo >> 6] |= m;
+            ++c.card;
+        }
+        return;
+    }
+
+    auto pos = std::lower_bound(c.array.begin(), c.array.end(), lo);
+    if (pos != c.array.end() && *pos == lo) return;
+    c.array.insert(pos, lo);
+    ++c.card;
+
+    if (c.array.size() > BITMAP_ARRAY_MAX) {
+        c.bits.assign(BITMAP_CHUNK_WORDS, 0);
+        for (uint16_t x : c.array) c.bits[x >> 6] |= uint64_t{1} << (x & 63);
+        c.array.clear();
+        c.array.shrink_to_fit();
+    }
+}
+
+void compressed_bitmap::remove(uint32_t v) {
+    chunk* c = find(static_cast<uint16_t>(v >> 16));
+    if (!c) return;
+    uint16_t lo = static_cast<uint16_t>(v);
+
+    if (!c->bits.empty()) {
+        uint64_t m = uint64_t{1} << (lo & 63);
+        if (!(c->bits[lo >> 6] & m)) return;
+        c->bits[lo >> 6] &= ~m;
+        --c->card;
+        // Keep bitset form until the chunk is empty; removals are rare
+    } else {
+        auto pos = std::lower_bound(c->array.begin(), c->array.end(), lo);
+        if (pos == c->array.end() || *pos != lo) return;
+        c->array.erase(pos);
+        --c->card;
+    }
+
+    if (c->card == 0) {
+        chunks_.erase(chunks_.begin() + (c - chunks_.data()));
+    }
+}
+
+bool compressed_bitmap::contains(uint32_t v) const {
+    const chunk* c = find(static_cast<uint16_t>(v >> 16));
+    if (!c) return false;
+    uint16_t lo = static_cast<uint16_t>(v);
+    if (!c->bits.empty()) return (c->bits[lo >> 6] >> (lo & 63)) & 1;
+    return std::binary_search(c->array.begin(), c->array.end(), lo);
+}
+
+size_t compressed_bitmap::cardinality() const {
+    size_t n = 0;
+    for (const auto& c : chunks_) n += c.card;
+    return n;
+}
+
+size_t compressed_bitmap::memory_bytes() const {
+    size_t n = sizeof(*this) + chunks_.capacity() * sizeof(chunk);
+    for (const auto& c : chunks_) {
+        n += c.array.capacity() * sizeof(uint16_t) + c.bits.capacity() * sizeof(uint64_t);
+    }
+    return n;
+}
+
+compressed_bitmap compressed_bitmap::intersect(const compressed_bitmap& a,
+                                               const compressed_bitmap& b) {
+    compressed_bitmap out;
+    size_t i = 0, j = 0;
+    while (i < a.chunks_.size() && j < b.chunks_.size()) {
+        const chunk& ca = a.chunks_[i];
+        const chunk& cb = b.chunks_[j];
+        if (ca.key < cb.key) { ++i; continue; }
+        if (cb.key < ca.key) { ++j; continue; }
+
+        chunk c;
+        c.key = ca.key;
+        if (!ca.bits.empty() && !cb.bits.empty()) {
+            c.bits.resize(BITMAP_CHUNK_WORDS);
+            for (size_t w = 0; w < BITMAP_CHUNK_WORDS; ++w) {
+                c.bits[w] = ca.bits[w] & cb.bits[w];
+                c.card += static_cast<uint32_t>(__builtin_popcountll(c.bits[w]));
+            }
+            if (c.card <= BITMAP_ARRAY_MAX) {
+                for (size_t w = 0; w < BITMAP_CHUNK_WORDS; ++w) {
+                    for (uint64_t bw = c.bits[w]; bw; bw &= bw - 1) {
+                        c.array.push_back(static_cast<uint16_t>(w * 64 + __builtin_ctzll(bw)));
+                    }
+                }
+                c.bits.clear();
+            }
+        } else if (ca.bits.empty() && cb.bits.empty()) {
+            // Branch-free merge: random ids make std::set_intersection's
+            // comparisons unpredictable
+            const uint16_t* x = ca.array.data();
+            const uint16_t* y = cb.array.data();
+            size_t nx = ca.array.size(), ny = cb.array.size(), p = 0, q = 0, n = 0;
+            c.array.resize(std::min(nx, ny));
+            while (p < nx && q < ny) {
+                uint16_t u = x[p], v = y[q];
+                c.array[n] = u;
+                n += u == v;
+                p += u <= v;
+                q += v <= u;
+            }
+            c.array.resize(n);
+            c.card = static_cast<uint32_t>(n);
+        } else {
+            const chunk& arr = ca.bits.empty() ? ca : cb;
+            const chunk& bit = ca.bits.empty() ? cb : ca;
+            for (uint16_t x : arr.array) {
+                if ((bit.bits[x >> 6] >> (x & 63)) & 1) c.array.push_back(x);
+            }
+            c.card = static_cast<uint32_t>(c.array.size());
+        }
+        if (c.card > 0) out.chunks_.push_back(std::move(c));
+        ++i;
+        ++j;
+    }
+    return out;
+}
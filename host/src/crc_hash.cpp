@@ -0,0 +1,22 @@
+// src/crc_hash.cpp
+//
+// Compile-time checks of the CRC variant's hashes; all code is constexpr
+// in crc_hash.hpp.
+#include "crc_hash.hpp"
+
+// Standard CRC-32 table entries and check value ("123456789")
+static_assert(CRC32_TABLES[0][1]   == 0x77073096u);
+static_assert(CRC32_TABLES[0][255] == 0x2D02EF8Du);
+
+static constexpr uint8_t CRC32_CHECK[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+static_assert(crc32(CRC32_CHECK, sizeof(CRC32_CHECK)) == 0xCBF43926u);
+
+// zlib.crc32(struct.pack('>IIBH', 0x0a000001, 0x14000000, 146, 1)) and
+// zlib.crc32(struct.pack('>IB', that, 7))
+static_assert(tofino_pkt_id(0x0a000001u, 0x14000000u, 146, 1) == 1602424099u);
+static_assert(tofino_hop_hash(1602424099u, 7) == 2878916419u);
+
+// Linearity: the one-XOR form agrees with the byte-wise CRC
+static_assert(crc_hop_hash{}(crc_hop_hash{}.pkt_term(1602424099u), 7) == 2878916419u);
+static_assert(crc_hop_hash{}(crc_hop_hash{}.pkt_term(0xDEADBEEFu), 255) ==
+              tofino_hop_hash(0xDEADBEEFu, 255));
@@ -0,0 +1,212 @@
+// src/decode_plan.cpp
+#include "decode_plan.hpp"
+
+#include <algorithm>
+
+// -------------------------------------------------------------------
+// decode_plan
+// -------------------------------------------------------------------
+
+decode_plan::decode_plan(const std::vector<uint32_t>& pktids,
+                         const std::vector<hop_mask>& xor_sets, int num_hops)
+    : num_hops_(num_hops) {
+    decode_plan_builder b(num_hops);
+    for (size_t i = 0; i < xor_sets.size(); ++i) b.add(pktids[i], xor_sets[i]);
+    *this = b.finish();
+}
+
+// -------------------------------------------------------------------
+// decode_plan_builder
+// -------------------------------------------------------------------
+
+decode_plan_builder::decode_plan_builder(int num_hops)
+    : plan_(num_hops), rows_(static_cast<size_t>(num_hops)) {}
+
+bool decode_plan_builder::add(uint32_t pktid, const hop_mask& xor_set) {
+    // Same elimination as online_decoder, on masks only; the new basis
+    // row remembers which pivots it was reduced by.
+    uint16_t input = static_cast<uint16_t>(plan_.pktids_.size());
+    plan_.pktids_.push_back(pktid);
+    if (full_rank()) return false;
+
+    hop_mask row = xor_set;
+    by_.clear();
+    for (int col = row.lowest(); col >= 0 && col < plan_.num_hops_; col = row.lowest()) {
+        if (!pivots_.test(col)) {
+            rows_[col] = row;
+            pivots_.set(col);
+            plan_.loads_.push_back(decode_plan::load{static_cast<uint16_t>(col), input});
+            for (uint16_t src : by_) {
+                plan_.ops_.push_back(decode_plan::op{static_cast<uint16_t>(col), src});
+            }
+            return true;
+        }
+        row ^= rows_[col];
+        by_.push_back(static_cast<uint16_t>(col));
+    }
+    return false;
+}
+
+decode_plan decode_plan_builder::finish() const {
+    decode_plan plan = plan_;
+    if (!full_rank()) {
+        plan.ops_.clear();
+        return plan;
+    }
+    // Back-substitution from the last hop: rows are upper triangular
+    int n = plan.num_hops_;
+    for (int col = n - 1; col >= 0; --col) {
+        const hop_mask& row = rows_[col];
+        for (int j = col + 1; j < n; ++j) {
+            if (row.test(j)) {
+                plan.ops_.push_back(decode_plan::op{static_cast<uint16_t>(col),
+                                                    static_cast<uint16_t>(j)});
+            }
+        }
+    }
+    return plan;
+}
+
+// -------------------------------------------------------------------
+// prefix_plan_chain
+// -------------------------------------------------------------------
+
+prefix_plan_chain::prefix_plan_chain(int num_hops, uint32_t first)
+    : first_(first), builder_(num_hops) {}
+
+void prefix_plan_chain::build(const xor_codebook& book) {
+    hop_mask m;
+    while (!builder_.full_rank() && book.lookup(first_ + static_cast<uint32_t>(rank_at_.size()), m)) {
+        builder_.add(first_ + static_cast<uint32_t>(rank_at_.size()), m);
+        rank_at_.push_back(static_cast<uint16_t>(builder_.rank()));
+    }
+    if (builder_.full_rank() && !plan_) {
+        full_rank_k_ = rank_at_.size();
+        plan_ = std::make_shared<const decode_plan>(builder_.finish());
+    }
+}
+
+int prefix_plan_chain::rank_at(size_t k) const {
+    if (k == 0) return 0;
+    if (k > rank_at_.size()) return rank_at_.empty() ? 0 : rank_at_.back();
+    return rank_at_[k - 1];
+}
+
+// -------------------------------------------------------------------
+// plan_batch_executor
+// -------------------------------------------------------------------
+
+#if defined(__x86_64__)
+#define PLAN_CLONES __attribute__((target_clones("arch=skylake-avx512", "avx2", "default")))
+#else
+#define PLAN_CLONES
+#endif
+
+PLAN_CLONES
+bool plan_batch_executor::run(const decode_plan& plan, const uint16_t* const* pints,
+                              uint16_t* const* switch_ids, size_t flows) {
+    if (!plan.full_rank() || flows > PLAN_LANES) return false;
+    if (slots_.size() < static_cast<size_t>(plan.num_hops())) {
+        slots_.resize(static_cast<size_t>(plan.num_hops()));
+    }
+    slot* s = slots_.data();
+
+    // Transpose in: unused lanes stay 0 and are never read back
+    for (const decode_plan::load& l : plan.loads()) {
+        lanes v = {};
+        for (size_t f = 0; f < flows; ++f) v[f] = pints[f][l.input];
+        s[l.slot].v = v;
+    }
+    for (const decode_plan::op& o : plan.ops()) s[o.dst].v ^= s[o.src].v;
+
+    for (int h = 0; h < plan.num_hops(); ++h) {
+        const lanes v = s[h].v;
+        for (size_t f = 0; f < flows; ++f) switch_ids[f][h] = v[f];
+    }
+    return true;
+}
+
+// -------------------------------------------------------------------
+// decode_plan_cache
+// -------------------------------------------------------------------
+
+uint64_t pktid_set_fingerprint(const std::vector<uint32_t>& sorted_pktids, int num_hops) {
+    uint64_t h = 0x9E3779B97F4A7C15ull ^ static_cast<uint64_t>(num_hops);
+    for (uint32_t id : sorted_pktids) {
+        h ^= id + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2);
+        h *= 0xBF58476D1CE4E5B9ull;
+        h ^= h >> 31;
+    }
+    return h;
+}
+
+std::shared_ptr<const decode_plan> decode_plan_cache::get(const xor_codebook& book,
+                                                          std::vector<uint32_t>& pktids) {
+    std::sort(pktids.begin(), pktids.end());
+    pktids.erase(std::unique(pktids.begin(), pktids.end()), pktids.end());
+    uint64_t fp = pktid_set_fingerprint(pktids, book.num_hops());
+
+    auto range = index_.equal_range(fp);
+    for (auto it = range.first; it != range.second; ++it) {
+        const std::shared_ptr<const decode_plan>& plan = it->second->second;
+        if (plan->pktids() != pktids) continue;
+        ++hits_;
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return plan;
+    }
+
+    std::vector<hop_mask> xor_sets(pktids.size());
+    for (size_t i = 0; i < pktids.size(); ++i) {
+        if (!book.lookup(pktids[i], xor_sets[i])) return nullptr;
+    }
+    ++misses_;
+    auto plan = std::make_shared<const decode_plan>(pktids, xor_sets, book.num_hops());
+    lru_.emplace_front(fp, plan);
+    index_.emplace(fp, lru_.begin());
+
+    while (lru_.size() > capacity_) {
+        auto last = std::prev(lru_.end());
+        auto r = index_.equal_range(last->first);
+        for (auto it = r.first; it != r.second; ++it) {
+            if (it->second == last) {
+                index_.erase(it);
+                break;
+            }
+        }
+        lru_.pop_back();
+        ++evictions_;
+    }
+    return plan;
+}
+
+const prefix_plan_chain& decode_plan_cache::prefix(const xor_codebook& book, uint32_t first) {
+    uint64_t h = book.fingerprint();
+    for (uint64_t v : {static_cast<uint64_t>(book.num_hops()), static_cast<uint64_t>(first),
+                       static_cast<uint64_t>(book.first_pktid()),
+                       static_cast<uint64_t>(book.count())}) {
+        h = (h ^ v) * 0xBF58476D1CE4E5B9ull;
+        h ^= h >> 31;
+    }
+
+    // Like get(): the hash only narrows the search, the fields decide
+    auto range = chains_.equal_range(h);
+    for (auto it = range.first; it != range.second; ++it) {
+        const chain_entry& e = it->second;
+        if (e.apa_fingerprint == book.fingerprint() && e.num_hops == book.num_hops() &&
+            e.first == first && e.first_pktid == book.first_pktid() &&
+            e.count == book.count()) {
+            return *e.chain;
+        }
+    }
+    auto chain = std::make_unique<prefix_plan_chain>(book.num_hops(), first);
+    chain->build(book);
+    auto it = chains_.emplace(h, chain_entry{book.fingerprint(), book.num_hops(), first,
+                                             book.first_pktid(), book.count(), std::move(chain)});
+    return *it->second.chain;
+}
+
+void decode_plan_cache::clear() {
+    lru_.clear();
+    index_.clear();
+    chains_.clear();
+}
@@ -0,0 +1,93 @@
+// src/decode_scheduler.cpp
+#include "decode_scheduler.hpp"
+
+decode_scheduler::decode_scheduler(int num_hops, size_t capacity, double age_weight)
+    : num_hops_(num_hops), capacity_(capacity < 1 ? 1 : capacity),
+      age_weight_(age_weight) {}
+
+void decode_scheduler::dequeue(const flow_key& key, flow_work& w) {
+    if (w.queued) order_.erase({w.score, key});
+    w.queued = false;
+}
+
+void decode_scheduler::update_congestion() {
+    if (pending_ * 8 >= capacity_ * 7) congested_ = true;
+    else if (pending_ * 2 <= capacity_) congested_ = false;
+}
+
+bool decode_scheduler::push(const flow_key& key, const packet_equation& eq) {
+    ++clock_;
+    auto it = flows_.find(key);
+
+    if (pending_ >= capacity_) {
+        // Shed the worst queued flow unless the arrival would be worse
+        double mine = it != flows_.end()
+                          ? score_of(it->second)
+                          : num_hops_ + age_weight_ * static_cast<double>(clock_);
+        auto worst = std::prev(order_.end());
+        if (worst->first <= mine) {
+            ++rejected_;
+            return false;
+        }
+        flow_key victim = worst->second;
+        auto v = flows_.find(victim);
+        pending_ -= v->second.eqs.size();
+        shed_    += v->second.eqs.size();
+        order_.erase(worst);
+        v->second.eqs.clear();
+        v->second.queued = false;
+        if (v->second.fed.rank() > 0) v->second.mon = v->second.fed;
+        else flows_.erase(v);
+    }
+
+    if (it == flows_.end()) {
+        it = flows_.emplace(key, flow_work(num_hops_)).first;
+        it->second.first = clock_;
+    }
+    flow_work& w = it->second;
+    if (!w.mon.add_equation(eq)) {
+        ++redundant_;
+        return true;
+    }
+
+    w.eqs.push_back(eq);
+    ++pending_;
+    dequeue(key, w);
+    w.score  = score_of(w);
+    w.queued = true;
+    order_.insert({w.score, key});
+    update_congestion();
+    return true;
+}
+
+size_t decode_scheduler::run(multi_flow_decoder& dec, size_t budget) {
+    size_t fed = 0;
+    while (fed < budget && !order_.empty()) {
+        flow_key key = order_.begin()->second;
+        order_.erase(order_.begin());
+
+        auto it = flows_.find(key);
+        flow_work& w = it->second;
+        w.queued = false;
+        for (const auto& eq : w.eqs) dec.add_equation(key, eq);
+        fed      += w.eqs.size();
+        pending_ -= w.eqs.size();
+        w.eqs.clear();
+
+        // A full-rank monitor drops everything that follows, so a flow
+        // the decoder could not finish (inconsistent) starts over
+        if (dec.path(key) || w.mon.solved()) flows_.erase(it);
+        else w.fed = w.mon;
+    }
+    update_congestion();
+    return fed;
+}
+
+void decode_scheduler::forget(const flow_key& key) {
+    auto it = flows_.find(key);
+    if (it == flows_.end()) return;
+    dequeue(key, it->second);
+    pending_ -= it->second.eqs.size();
+    flows_.erase(it);
+    update_congestion();
+}
@@ -0,0 +1,2001 @@
+// src/decoder_bench.cpp
+//
+// Offline benchmarks for the C++ decoder. Equations are produced by the
+// same encoder as decoding_murmur.py, so no switch is needed.
+//
+//   ./bin/decoder_bench <mode> --apa ../APA/robust32_1.txt [--hops N] ...
+#include "apa_image.hpp"
+#include "collector.hpp"
+#include "crc_hash.hpp"
+#include "decode_plan.hpp"
+#include "decode_scheduler.hpp"
+#include "equation_dedup.hpp"
+#include "heavy_hitters.hpp"
+#include "lazy_equation.hpp"
+#include "markowitz_solver.hpp"
+#include "multi_flow_decoder.hpp"
+#include "partial_path.hpp"
+#include "path_store.hpp"
+#include "reactor.hpp"
+#include "readiness_model.hpp"
+#include "recipe_decoder.hpp"
+#include "snapshot.hpp"
+#include "socket_utils.hpp"
+#include "wide_decoder.hpp"
+#include "xor_codebook.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iterator>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using bench_args = std::map<std::string, std::string>;
+
+static std::string arg_str(const bench_args& a, const std::string& k,
+                           const std::string& def) {
+    auto it = a.find(k);
+    return it == a.end() ? def : it->second;
+}
+
+static long arg_int(const bench_args& a, const std::string& k, long def) {
+    auto it = a.find(k);
+    return it == a.end() ? def : std::strtol(it->second.c_str(), nullptr, 10);
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+static bool load_bench_apa(const bench_args& a, apa_t& apa, int& num_hops) {
+    // Degrees per APA line grow with the path length (robust256 has 256),
+    // so default to the controller's MAX_DEGREE rather than 32.
+    std::string path = arg_str(a, "apa", "../APA/robust32_1.txt");
+    int max_degree   = static_cast<int>(arg_int(a, "max-degree", MAX_HOPS));
+    if (!load_apa(path, apa, max_degree)) return false;
+    num_hops = static_cast<int>(arg_int(a, "hops", apa.max_hops));
+    if (num_hops > apa.max_hops) {
+        std::cerr << "[bench] Requested hops=" << num_hops << " > APA.max_hops="
+                  << apa.max_hops << ", clamping\n";
+        num_hops = apa.max_hops;
+    }
+    return true;
+}
+
+// 32-bit pkt_id of the ident-th packet of a flow. In the CRC variant the
+// switch hashes (src, dst, protocol, identification), so different flows
+// see different pkt_ids; mix32 stands in for that CRC here.
+static uint32_t flow_pkt_id(uint32_t flow_salt, uint32_t ident) {
+    return mix32(flow_salt ^ mix32(ident));
+}
+
+// -------------------------------------------------------------------
+// prefix: aggregate packets-to-decode with and without shared-prefix
+// substitution, for `sources` x `flows` flows started `stagger` packets
+// apart within each source. `diverge` percent of the flows leave their
+// source through another uplink (ECMP): their last prefix hop differs,
+// so the source's published prefix is wrong for them.
+// -------------------------------------------------------------------
+
+struct sim_flow {
+    flow_key key;
+    std::vector<uint16_t> switch_ids;
+    uint32_t salt  = 0;
+    long start     = 0;
+    long sent      = 0;
+    bool done      = false;
+    long first_path = 0;   // packets sent when a path was first published
+    long correct_at = 0;   // ... and when the published path was right
+};
+
+static std::vector<sim_flow> make_rack(int sources, int flows, int num_hops,
+                                       int prefix, long stagger, uint32_t seed,
+                                       int diverge_pct = 0) {
+    std::mt19937 rng(seed);
+    std::vector<sim_flow> rack;
+    for (int s = 0; s < sources; ++s) {
+        std::vector<uint16_t> shared(static_cast<size_t>(num_hops));
+        for (auto& id : shared) id = static_cast<uint16_t>(rng());
+        for (int f = 0; f < flows; ++f) {
+            sim_flow fl;
+            fl.key.src_addr = 0x0a000000u + static_cast<uint32_t>(s);
+            fl.key.dst_addr = 0x14000000u + static_cast<uint32_t>(f);
+            fl.key.protocol = 146;
+            fl.salt         = static_cast<uint32_t>(rng());
+            fl.start        = f * stagger;
+            fl.switch_ids   = shared;
+            for (int h = prefix; h < num_hops; ++h) {
+                fl.switch_ids[h] = static_cast<uint16_t>(rng());
+            }
+            if (prefix > 0 && static_cast<int>(rng() % 100) < diverge_pct) {
+                fl.switch_ids[prefix - 1] ^= static_cast<uint16_t>(1 + rng() % 0xFFFF);
+            }
+            rack.push_back(fl);
+        }
+    }
+    return rack;
+}
+
+struct rack_result {
+    long   to_path    = 0;   // packets until each flow's first published path
+    long   to_correct = 0;   // packets until each flow's path was right
+    size_t decoded = 0, wrong = 0;            // at the end
+    size_t seen_wrong = 0, retracted = 0;   // a path may be retracted unseen
+    size_t assisted = 0, refuted = 0;
+    double secs = 0;
+};
+
+// Flows keep sending while their path is provisional, as real flows do;
+// a flow that never decodes counts all the packets it sent.
+static rack_result run_rack(std::vector<sim_flow> rack, const apa_t& apa,
+                            int num_hops, int shared_prefix, long max_packets) {
+    multi_flow_decoder dec(num_hops, shared_prefix);
+    rack_result res;
+    size_t remaining = rack.size();
+    auto t0 = std::chrono::steady_clock::now();
+
+    // One packet per active flow per tick; flows give up at max_packets.
+    for (long tick = 0; remaining > 0; ++tick) {
+        for (auto& fl : rack) {
+            if (fl.done || tick < fl.start) continue;
+            if (fl.sent >= max_packets) { fl.done = true; --remaining; continue; }
+            ++fl.sent;
+            packet_equation eq = encode_packet(
+                apa, flow_pkt_id(fl.salt, static_cast<uint32_t>(fl.sent)), fl.switch_ids);
+            dec.add_equation(fl.key, eq);
+            const std::vector<uint16_t>* p = dec.path(fl.key);
+            if (!p) continue;
+            if (!fl.first_path) {
+                fl.first_path = fl.sent;
+                res.seen_wrong += *p != fl.switch_ids;
+            }
+            if (!fl.correct_at && *p == fl.switch_ids) fl.correct_at = fl.sent;
+            if (!dec.provisional(fl.key)) { fl.done = true; --remaining; }
+        }
+    }
+    res.secs = seconds_since(t0);
+
+    for (const auto& fl : rack) {
+        res.to_path    += fl.first_path ? fl.first_path : fl.sent;
+        res.to_correct += fl.correct_at ? fl.correct_at : fl.sent;
+        const std::vector<uint16_t>* p = dec.path(fl.key);
+        if (!p) continue;
+        ++res.decoded;
+        if (*p != fl.switch_ids) ++res.wrong;
+    }
+    res.retracted = dec.retractions();
+    res.assisted  = dec.assisted_flows();
+    res.refuted   = dec.assist_failures();
+    return res;
+}
+
+static int bench_prefix(const bench_args& a) {
+    apa_t apa;
+    int num_hops = 0;
+    if (!load_bench_apa(a, apa, num_hops)) return 1;
+
+    int sources      = static_cast<int>(arg_int(a, "sources", 8));
+    int flows        = static_cast<int>(arg_int(a, "flows", 16));
+    int prefix       = static_cast<int>(arg_int(a, "prefix", 2));
+    long stagger     = arg_int(a, "stagger", 8);
+    long max_packets = arg_int(a, "max-packets", 20000);
+    int diverge      = static_cast<int>(arg_int(a, "diverge", 25));
+
+    std::vector<sim_flow> rack = make_rack(sources, flows, num_hops, prefix,
+                                           stagger, 0xC0FFEE, diverge);
+    printf("[bench] prefix: %d sources x %d flows, hops=%d, shared prefix=%d, %d%% diverging\n",
+           sources, flows, num_hops, prefix, diverge);
+
+    double n = static_cast<double>(rack.size());
+    size_t any_wrong = 0;
+    for (int use_prefix : {0, prefix}) {
+        rack_result r = run_rack(rack, apa, num_hops, use_prefix, max_packets);
+        printf("[bench]   substitution=%-3s packets to path %.1f/flow, to right path %.1f/flow, "
+               "decoded=%zu/%zu  %.3fs\n",
+               use_prefix ? "on" : "off", static_cast<double>(r.to_path) / n,
+               static_cast<double>(r.to_correct) / n, r.decoded, rack.size(), r.secs);
+        if (use_prefix) {
+            printf("[bench]     assisted=%zu refuted=%zu (wrong paths seen=%zu, retracted=%zu), "
+                   "wrong at the end=%zu\n",
+                   r.assisted, r.refuted, r.seen_wrong, r.retracted, r.wrong);
+        }
+        any_wrong += r.wrong;
+    }
+    return any_wrong == 0 ? 0 : 1;
+}
+
+// -------------------------------------------------------------------
+// wide: packets-to-decode and decode rate for 16/32/64-bit switch IDs
+// (1/2/4 fragments) at each APA path length.
+// -------------------------------------------------------------------
+
+template <int Fragments>
+static void run_wide(const apa_t& apa, int num_hops, int flows, long max_packets) {
+    std::mt19937_64 rng(0xC0FFEE);
+    long packets = 0;
+    int decoded = 0, wrong = 0;
+    auto t0 = std::chrono::steady_clock::now();
+
+    for (int f = 0; f < flows; ++f) {
+        std::vector<uint64_t> ids(static_cast<size_t>(num_hops));
+        for (auto& id : ids) id = rng() >> (64 - wide_decoder<Fragments>::id_bits);
+        uint32_t salt = static_cast<uint32_t>(rng());
+
+        wide_decoder<Fragments> dec(num_hops);
+        for (long n = 1; n <= max_packets && !dec.solved(); ++n) {
+            dec.add_equation(encode_wide_packet<Fragments>(
+                apa, flow_pkt_id(salt, static_cast<uint32_t>(n)), ids));
+            ++packets;
+        }
+        std::vector<uint64_t> out;
+        if (dec.solve(out)) {
+            ++decoded;
+            if (out != ids) ++wrong;
+        }
+    }
+    double secs = seconds_since(t0);
+    printf("[bench]   hops=%3d id_bits=%2d packets/flow=%7.1f decoded=%d/%d wrong=%d  %.2f Meq/s\n",
+           num_hops, wide_decoder<Fragments>::id_bits,
+           static_cast<double>(packets) / flows, decoded, flows, wrong,
+           static_cast<double>(packets) / secs / 1e6);
+}
+
+static int bench_wide(const bench_args& a) {
+    std::string dir  = arg_str(a, "apa-dir", "../APA");
+    int flows        = static_cast<int>(arg_int(a, "flows", 16));
+    long max_packets = arg_int(a, "max-packets", 50000);
+
+    printf("[bench] wide: %d flows per point\n", flows);
+    for (int hops : {32, 64, 128, 256}) {
+        apa_t apa;
+        if (!load_apa(dir + "/robust" + std::to_string(hops) + "_1.txt", apa, MAX_HOPS)) {
+            return 1;
+        }
+        run_wide<1>(apa, hops, flows, max_packets);
+        run_wide<2>(apa, hops, flows, max_packets);
+        run_wide<4>(apa, hops, flows, max_packets);
+    }
+    return 0;
+}
+
+// -------------------------------------------------------------------
+// monitor: per-equation cost of the full online_decoder vs. the
+// rank_monitor on the same pre-encoded equations (encoding excluded).
+// -------------------------------------------------------------------
+
+static std::vector<std::vector<packet_equation>>
+encode_flows(const apa_t& apa, int num_hops, int flows, long packets, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::vector<std::vector<packet_equation>> out(static_cast<size_t>(flows));
+    for (auto& eqs : out) {
+        std::vector<uint16_t> ids(static_cast<size_t>(num_hops));
+        for (auto& id : ids) id = static_cast<uint16_t>(rng());
+        uint32_t salt = static_cast<uint32_t>(rng());
+        eqs.reserve(static_cast<size_t>(packets));
+        for (long n = 1; n <= packets; ++n) {
+            eqs.push_back(encode_packet(apa, flow_pkt_id(salt, static_cast<uint32_t>(n)), ids));
+        }
+    }
+    return out;
+}
+
+static flow_key bench_flow(long f) {
+    flow_key key;
+    key.src_addr = static_cast<uint32_t>(f);
+    key.dst_addr = static_cast<uint32_t>(f * 2654435761u);
+    key.protocol = 6;
+    return key;
+}
+
+template <typename Decoder>
+static void run_monitor(const char* name,
+                        const std::vector<std::vector<packet_equation>>& flows,
+                        int num_hops, int rounds) {
+    long eqs = 0, full_rank = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (const auto& flow : flows) {
+            Decoder dec(num_hops);
+            for (const auto& eq : flow) {
+                dec.add_equation(eq);
+                ++eqs;
+            }
+            full_rank += dec.solved();
+        }
+    }
+    double secs = seconds_since(t0);
+    printf("[bench]   %-14s %6.1f ns/eq  full rank %ld/%ld\n", name,
+           secs * 1e9 / static_cast<double>(eqs), full_rank,
+           static_cast<long>(flows.size()) * rounds);
+}
+
+static int bench_monitor(const bench_args& a) {
+    apa_t apa;
+    int num_hops = 0;
+    if (!load_bench_apa(a, apa, num_hops)) return 1;
+
+    int flows    = static_cast<int>(arg_int(a, "flows", 64));
+    long packets = arg_int(a, "packets", 4L * num_hops);
+    int rounds   = static_cast<int>(arg_int(a, "rounds", 20));
+
+    auto eqs = encode_flows(apa, num_hops, flows, packets, 0xC0FFEE);
+    printf("[bench] monitor: %d flows x %ld packets, hops=%d\n", flows, packets, num_hops);
+    run_monitor<online_decoder>("online_decoder", eqs, num_hops, rounds);
+    run_monitor<rank_monitor>("rank_monitor", eqs, num_hops, rounds);
+    return 0;
+}
+
+// -------------------------------------------------------------------
+// dedup: share of exact-duplicate equations, decoder time with and
+// without the dedup stage, and how early corrupted pints are caught
+// (first dedup conflict vs. first decoder inconsistency).
+// -------------------------------------------------------------------
+
+static int bench_dedup(const bench_args& a) {
+    apa_t apa;
+    int num_hops = 0;
+    if (!load_bench_apa(a, apa, num_hops)) return 1;
+
+    int flows        = static_cast<int>(arg_int(a, "flows", 64));
+    long packets     = arg_int(a, "packets", 4L * num_hops);
+    long corrupt_ppm = arg_int(a, "corrupt-ppm", 20000);
+
+    auto eqs = encode_flows(apa, num_hops, flows, packets, 0xC0FFEE);
+    std::vector<std::vector<uint16_t>> truth(static_cast<size_t>(flows));
+    for (int f = 0; f < flows; ++f) {
+        solve_switch_ids(eqs[static_cast<size_t>(f)], num_hops, truth[static_cast<size_t>(f)]);
+    }
+    std::mt19937 rng(0xBADC0DE);
+    for (auto& flow : eqs) {
+        for (auto& eq : flow) {
+            if (static_cast<long>(rng() % 1000000) < corrupt_ppm) {
+                eq.pint ^= static_cast<uint16_t>(1u << (rng() % 16));
+            }
+        }
+    }
+    printf("[bench] dedup: %d flows x %ld packets, hops=%d, corrupt=%ld ppm\n",
+           flows, packets, num_hops, corrupt_ppm);
+
+    // plain decoder
+    long first_inconsistent = 0, flagged_dec = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (const auto& flow : eqs) {
+        online_decoder dec(num_hops);
+        bool flagged = false;
+        for (long n = 0; n < static_cast<long>(flow.size()); ++n) {
+            dec.add_equation(flow[n]);
+            if (!dec.consistent() && !flagged) {
+                flagged = true;
+                first_inconsistent += n + 1;
+                ++flagged_dec;
+            }
+        }
+    }
+    double plain_secs = seconds_since(t0);
+
+    // dedup stage in front of the decoder
+    size_t dups = 0, uniq = 0;
+    long first_conflict = 0, flagged_dedup = 0;
+    t0 = std::chrono::steady_clock::now();
+    for (const auto& flow : eqs) {
+        online_decoder dec(num_hops);
+        equation_dedup dd;
+        bool flagged = false;
+        for (long n = 0; n < static_cast<long>(flow.size()); ++n) {
+            dedup_result r = dd.check(flow[n]);
+            if (r == dedup_result::conflict && !flagged) {
+                flagged = true;
+                first_conflict += n + 1;
+                ++flagged_dedup;
+            }
+            if (r == dedup_result::fresh) dec.add_equation(flow[n]);
+        }
+        dups += dd.duplicates() + dd.conflicts();
+        uniq += dd.unique();
+    }
+    double dedup_secs = seconds_since(t0);
+
+    printf("[bench]   duplicates=%zu/%zu (%.1f%%)\n", dups, dups + uniq,
+           100.0 * static_cast<double>(dups) / static_cast<double>(dups + uniq));
+    printf("[bench]   decoder only: %.3fs, flagged %ld flows, first inconsistency at pkt %.1f\n",
+           plain_secs, flagged_dec,
+           flagged_dec ? static_cast<double>(first_inconsistent) / flagged_dec : 0.0);
+    printf("[bench]   with dedup:   %.3fs, flagged %ld flows, first conflict at pkt %.1f\n",
+           dedup_secs, flagged_dedup,
+           flagged_dedup ? static_cast<double>(first_conflict) / flagged_dedup : 0.0);
+
+    // The collector's path: each flow fed to a multi_flow_decoder until
+    // it decodes, which is where its equations stop
+    for (bool on : {false, true}) {
+        multi_flow_decoder dec(num_hops, 0);
+        dec.set_dedup(on);
+        long fed = 0;
+        t0 = std::chrono::steady_clock::now();
+        for (int f = 0; f < flows; ++f) {
+            for (const auto& eq : eqs[static_cast<size_t>(f)]) {
+                ++fed;
+                if (dec.add_equation(bench_flow(f), eq)) break;
+            }
+        }
+        double secs = seconds_since(t0);
+        size_t decoded = 0, wrong = 0, suspect = 0;
+        for (int f = 0; f < flows; ++f) {
+            const std::vector<uint16_t>* path = dec.path(bench_flow(f));
+            decoded += path != nullptr;
+            wrong   += path && *path != truth[static_cast<size_t>(f)];
+            suspect += dec.suspect(bench_flow(f));
+        }
+        printf("[bench]   multi_flow_decoder, dedup %-3s: %.3fs for %ld packets, %zu dropped, "
+               "%zu suspect, %zu decoded (%zu wrong)\n",
+               on ? "on" : "off", secs, fed, dec.duplicates_dropped() + dec.dedup_conflicts(),
+               suspect, decoded, wrong);
+    }
+    return 0;
+}
+
+// -------------------------------------------------------------------
+// readiness: accuracy of the expected-remaining-packets model on fresh
+// flows, against a rank-only model and the naive num_hops - rank.
+// -------------------------------------------------------------------
+
+static int bench_readiness(const bench_args& a) {
+    apa_t apa;
+    int num_hops = 0;
+    if (!load_bench_apa(a, apa, num_hops)) return 1;
+
+    int trials       = static_cast<int>(arg_int(a, "trials", 2000));
+    int flows        = static_cast<int>(arg_int(a, "flows", 200));
+    long max_packets = arg_int(a, "max-packets", 50000);
+
+    readiness_model model;
+    auto t0 = std::chrono::steady_clock::now();
+    if (!model.build(apa, num_hops, trials, max_packets, 0xC0FFEE)) {
+        std::cerr << "[bench] No simulated flow decoded\n";
+        return 1;
+    }
+    printf("[bench] readiness: model from %d flows in %.2fs, hops=%d\n",
+           trials, seconds_since(t0), num_hops);
+
+    // What a decoder pays instead: the saved table, then the process-wide copy
+    std::string table = arg_str(a, "table", "/tmp/recipe_readiness.bin");
+    if (!model.save(table)) {
+        std::cerr << "[bench] Cannot save " << table << "\n";
+        return 1;
+    }
+    t0 = std::chrono::steady_clock::now();
+    auto shared = readiness_model::shared(apa, num_hops, table);
+    double load_ms = seconds_since(t0) * 1e3;
+    t0 = std::chrono::steady_clock::now();
+    auto again = readiness_model::shared(apa, num_hops, table);
+    double hit_ms = seconds_since(t0) * 1e3;
+    if (!shared || again != shared) {
+        std::cerr << "[bench] readiness_model::shared() failed\n";
+        return 1;
+    }
+    printf("[bench]   shared(): %.2f ms from %s, %.4f ms once loaded\n",
+           load_ms, table.c_str(), hit_ms);
+
+    double err_cell = 0, err_rank = 0, err_naive = 0;
+    double late_cell = 0, late_rank = 0;   // rank >= 3/4 of the hops
+    long samples = 0, late = 0;
+    std::vector<int> ranks;
+    std::mt19937 rng(0xFEEDu);
+    std::vector<uint16_t> ids(static_cast<size_t>(num_hops), 0);
+    std::vector<double> pred_cell, pred_rank, pred_naive;
+
+    t0 = std::chrono::steady_clock::now();
+    for (int f = 0; f < flows; ++f) {
+        uint32_t salt = static_cast<uint32_t>(rng());
+        rank_monitor mon(num_hops);
+        readiness_tracker tr(num_hops);
+        pred_cell.clear();
+        pred_rank.clear();
+        pred_naive.clear();
+        ranks.clear();
+        long n = 0;
+        while (!mon.solved() && n < max_packets) {
+            ranks.push_back(mon.rank());
+            pred_cell.push_back(model.expected_remaining(mon.rank(), tr.uncovered));
+            pred_rank.push_back(model.expected_remaining(mon.rank()));
+            pred_naive.push_back(num_hops - mon.rank());
+            ++n;
+            packet_equation eq = encode_packet(
+                apa, flow_pkt_id(salt, static_cast<uint32_t>(n)), ids);
+            mon.add_equation(eq);
+            tr.observe(eq.xor_set);
+        }
+        if (!mon.solved()) continue;
+        for (long i = 0; i < n; ++i) {
+            double actual = static_cast<double>(n - i);
+            err_cell  += std::abs(pred_cell[i] - actual);
+            err_rank  += std::abs(pred_rank[i] - actual);
+            err_naive += std::abs(pred_naive[i] - actual);
+            ++samples;
+            if (4 * ranks[i] >= 3 * num_hops) {
+                late_cell += std::abs(pred_cell[i] - actual);
+                late_rank += std::abs(pred_rank[i] - actual);
+                ++late;
+            }
+        }
+    }
+    double secs = seconds_since(t0);
+    if (samples == 0) {
+        std::cerr << "[bench] No test flow decoded within " << max_packets << " packets\n";
+        return 1;
+    }
+    printf("[bench]   mean abs error (packets): rank+uncovered=%.1f rank-only=%.1f naive=%.1f\n",
+           err_cell / samples, err_rank / samples, err_naive / samples);
+    if (late > 0) {
+        printf("[bench]   from 3/4 rank on (%ld predictions): rank+uncovered=%.1f rank-only=%.1f\n",
+               late, late_cell / late, late_rank / late);
+    }
+    printf("[bench]   %ld predictions in %.3fs (incl. encoding)\n", samples, secs);
+    return 0;
+}
+
+// -------------------------------------------------------------------
+// collector: in-process ingest rate of the sharded collector (no
+// sockets), from pre-encoded records of `flows` flows.
+// -------------------------------------------------------------------
+
+static int bench_collector(const bench_args& a) {
+    apa_t apa;
+    int num_hops = 0;
+    if (!load_bench_apa(a, apa, num_hops)) return 1;
+
+    int flows    = static_cast<int>(arg_int(a, "flows", 4096));
+    long packets = arg_int(a, "packets", 2L * num_hops);
+    int workers  = static_cast<int>(arg_int(a, "workers", 4));
+    double rate  = std::atof(arg_str(a, "sample", "1.0").c_str());
+
+    auto eqs = encode_flows(apa, num_hops, flows, packets, 0xC0FFEE);
+    std::vector<equation_record> records;
+    records.reserve(static_cast<size_t>(flows) * packets);
+    for (long n = 0; n < packets; ++n) {
+        for (int f = 0; f < flows; ++f) {
+            const packet_equation& eq = eqs[f][n];
+            equation_record r{};
+            r.src_addr = 0x0a000000u + static_cast<uint32_t>(f / 64);
+            r.dst_addr = 0x14000000u + static_cast<uint32_t>(f);
+            r.protocol = 146;
+            r.num_hops = static_cast<uint16_t>(num_hops);
+            r.pint     = eq.pint;
+            r.pktid    = eq.pktid;
+            for (int k = 0; k < HOP_MASK_WORDS; ++k) r.xor_set[k] = eq.xor_set.w[k];
+            records.push_back(r);
+        }
+    }
+
+    collector_config cfg;
+    cfg.num_hops = num_hops;
+    cfg.workers  = workers;
+    cfg.sample_rate = rate;
+    collector col(cfg);
+    col.start();
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < records.size(); i += COLLECTOR_MAX_BATCH) {
+        size_t n = std::min(COLLECTOR_MAX_BATCH, records.size() - i);
+        col.submit(records.data() + i, n);
+    }
+    col.stop();
+    double secs = seconds_since(t0);
+
+    collector_stats st = col.stats();
+    printf("[bench] collector: %d workers, %d flows x %ld packets, hops=%d, sample %.3f\n",
+           workers, flows, packets, num_hops, rate);
+    printf("[bench]   %.2f M records/s (%lu to decoders, %lu counted only), "
+           "%lu/%d paths decoded, %zu in store\n",
+           static_cast<double>(st.received + st.unsampled) / secs / 1e6,
+           static_cast<unsigned long>(st.received), static_cast<unsigned long>(st.unsampled),
+           static_cast<unsigned long>(st.decoded), flows, col.store().size());
+    return 0;
+}
+
+// -------------------------------------------------------------------
+// pathstore: interning and inverted-index queries for `flows` flows on
+// 5-hop paths of a k-ary fat tree (ToR, agg, core, agg, ToR).
+// -------------------------------------------------------------------
+
+static std::vector<uint16_t> fat_tree_path(int k, std::mt19937& rng) {
+    int half = k / 2;
+    int src_pod = static_cast<int>(rng() % k), dst_pod = static_cast<int>(rng() % k);
+    int src_tor = static_cast<int>(rng() % half), dst_tor = static_cast<int>(rng() % half);
+    int agg     = static_cast<int>(rng() % half);   // up-agg index = core group
+    int core    = static_cast<int>(rng() % half);
+
+    // ToRs 0.., aggs 0x4000.., cores 0x8000..
+    auto tor_id = [&](int pod, int t) { return static_cast<uint16_t>(pod * half + t); };
+    auto agg_id = [&](int pod, int a) { return static_cast<uint16_t>(0x4000 + pod * half + a); };
+    return {tor_id(src_pod, src_tor), agg_id(src_pod, agg),
+            static_cast<uint16_t>(0x8000 + agg * half + core),
+            agg_id(dst_pod, agg), tor_id(dst_pod, dst_tor)};
+}
+
+static int bench_pathstore(const bench_args& a) {
+    long flows   = arg_int(a, "flows", 1000000);
+    int k        = static_cast<int>(arg_int(a, "k", 16));
+    long queries = arg_int(a, "queries", 100000);
+
+    std::mt19937 rng(0xC0FFEE);
+    path_store store;
+    std::vector<path_store::update> batch;
+    auto t0 = std::chrono::steady_clock::now();
+    for (long f = 0; f < flows; ++f) {
+        flow_key key;
+        key.src_addr = static_cast<uint32_t>(f);
+        key.dst_addr = static_cast<uint32_t>(f * 2654435761u);
+        key.protocol = 6;
+        batch.emplace_back(key, fat_tree_path(k, rng));
+        if (batch.size() == COLLECTOR_MAX_BATCH || f + 1 == flows) {
+            store.publish_batch(batch);
+            batch.clear();
+        }
+    }
+    double pub_secs = seconds_since(t0);
+    printf("[bench] pathstore: %ld flows, k=%d fat tree\n", flows, k);
+    printf("[bench]   publish %.2f M flows/s, %zu distinct paths, index %.1f KiB\n",
+           static_cast<double>(flows) / pub_secs / 1e6, store.num_paths(),
+           static_cast<double>(store.index_bytes()) / 1024.0);
+
+    int half = k / 2;
+    size_t hits = 0;
+    t0 = std::chrono::steady_clock::now();
+    for (long q = 0; q < queries; ++q) {
+        uint16_t core = static_cast<uint16_t>(0x8000 + rng() % (half * half));
+        hits += store.paths_through(core, 2).cardinality();
+    }
+    double secs = seconds_since(t0);
+    printf("[bench]   paths through core at hop 2: %.2f us/query (%.0f paths avg)\n",
+           secs * 1e6 / queries, static_cast<double>(hits) / queries);
+
+    std::vector<flow_key> out;
+    hits = 0;
+    long flow_queries = std::max(1L, queries / 100);
+    t0 = std::chrono::steady_clock::now();
+    for (long q = 0; q < flow_queries; ++q) {
+        uint16_t tor  = static_cast<uint16_t>(rng() % (k * half));
+        uint16_t core = static_cast<uint16_t>(0x8000 + rng() % (half * half));
+        out.clear();
+        store.flows_through_all({{tor, 0}, {core, 2}}, out);
+        hits += out.size();
+    }
+    secs = seconds_since(t0);
+    printf("[bench]   flows from ToR via core: %.2f us/query (%.0f flows avg)\n",
+           secs * 1e6 / flow_queries, static_cast<double>(hits) / flow_queries);
+    return 0;
+}
+
+// -------------------------------------------------------------------
+// rcu: `readers` threads look flows up while one writer republishes
+// batches of changed paths; lock-free path_store against a mutex-guarded
+// unordered_map doing the same work.
+// -------------------------------------------------------------------
+
+struct locked_path_map {
+    std::mutex mu;
+    std::unordered_map<flow_key, std::vector<uint16_t>, flow_key_hash> map;
+
+    void publish_batch(const std::vector<path_store::update>& updates) {
+        std::lock_guard<std::mutex> lock(mu);
+        for (const auto& u : updates) map[u.first] = u.second;
+    }
+    bool lookup(const flow_key& key, std::vector<uint16_t>& path) {
+        std::lock_guard<std::mutex> lock(mu);
+        auto it = map.find(key);
+        if (it == map.end()) return false;
+        path = it->second;
+        return true;
+    }
+};
+
+template <typename Store>
+static void run_rcu(const char* name, Store& store, long flows, int k, int readers,
+                    int batch, long rate, double duration) {
+    std::mt19937 rng(0xC0FFEE);
+    std::vector<path_store::update> updates;
+    for (long f = 0; f < flows; ++f) {
+        updates.emplace_back(bench_flow(f), fat_tree_path(k, rng));
+        if (static_cast<long>(updates.size()) == batch || f + 1 == flows) {
+            store.publish_batch(updates);
+            updates.clear();
+        }
+    }
+
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> reads{0}, found{0};
+    std::vector<std::thread> threads;
+    for (int r = 0; r < readers; ++r) {
+        threads.emplace_back([&, r] {
+            std::mt19937 rrng(static_cast<uint32_t>(r) * 7919u + 1);
+            std::vector<uint16_t> path;
+            uint64_t n = 0, hit = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                for (int i = 0; i < 256; ++i, ++n) {
+                    hit += store.lookup(bench_flow(static_cast<long>(rrng() % flows)), path);
+                }
+            }
+            reads.fetch_add(n);
+            found.fetch_add(hit);
+        });
+    }
+
+    // Writer: `rate` batches per second (0: as fast as possible)
+    long batches = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    while (seconds_since(t0) < duration) {
+        for (int i = 0; i < batch; ++i) {
+            updates.emplace_back(bench_flow(static_cast<long>(rng() % flows)),
+                                 fat_tree_path(k, rng));
+        }
+        store.publish_batch(updates);
+        updates.clear();
+        ++batches;
+        if (rate > 0) {
+            auto next = t0 + std::chrono::microseconds(batches * 1000000 / rate);
+            std::this_thread::sleep_until(next);
+        }
+    }
+    stop = true;
+    for (auto& t : threads) t.join();
+    double secs = seconds_since(t0);
+
+    printf("[bench]   %-6s %.2f M lookups/s (%.0f%% hit), %.0f batches/s written\n",
+           name, static_cast<double>(reads) / secs / 1e6,
+           100.0 * static_cast<double>(found) / std::max<uint64_t>(1, reads),
+           static_cast<double>(batches) / secs);
+}
+
+static int bench_rcu(const bench_args& a) {
+    long flows      = arg_int(a, "flows", 200000);
+    int k           = static_cast<int>(arg_int(a, "k", 16));
+    int readers     = static_cast<int>(arg_int(a, "readers", 4));
+    int batch       = static_cast<int>(arg_int(a, "batch", 256));
+    long rate       = arg_int(a, "rate", 1000);
+    double duration = static_cast<double>(arg_int(a, "ms", 2000)) / 1000.0;
+
+    printf("[bench] rcu: %ld flows, %d readers, writer %ld batches/s x %d\n",
+           flows, readers, rate, batch);
+    {
+        path_store store;
+        run_rcu("rcu", store, flows, k, readers, batch, rate, duration);
+        printf("[bench]          %zu retired versions pending\n", store.retired_versions());
+    }
+    {
+        locked_path_map store;
+        run_rcu("mutex", store, flows, k, readers, batch, rate, duration);
+    }
+    return 0;
+}
+
+// -------------------------------------------------------------------
+// reactor: `sockets` echo loops that always have a datagram waiting
+// (UDP sockets connected to themselves, each recv answered by a send),
+// plus a 1 ms ticker, on one reactor. Without an inline budget the first
+// loop never suspends and starves the others and the ticker.
+// -------------------------------------------------------------------
+
+struct reactor_run {
+    std::vector<uint64_t> frames;   // per socket
+    uint64_t ticks = 0;
+    double max_late_ms = 0;
+};
+
+static task echo_forever(reactor& r, int fd, uint64_t& frames,
+                         std::chrono::steady_clock::time_point end) {
+    char buf[64] = {};
+    while (std::chrono::steady_clock::now() < end) {
+        ssize_t n = co_await async_recv(r, fd, buf, sizeof(buf));
+        if (n <= 0) continue;
+        co_await async_sendto(r, fd, buf, static_cast<size_t>(n), nullptr, 0);
+        ++frames;
+    }
+}
+
+static task tick(reactor& r, reactor_run& out, std::chrono::steady_clock::time_point end) {
+    auto due = std::chrono::steady_clock::now();
+    while (due < end) {
+        due += std::chrono::milliseconds(1);
+        co_await r.sleep_until(due);
+        double late = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - due).count();
+        out.max_late_ms = std::max(out.max_late_ms, late);
+        ++out.ticks;
+    }
+    r.stop();
+}
+
+static reactor_run run_reactor(int inline_ops, int sockets, int backlog, double secs) {
+    reactor_run out;
+    out.frames.assign(static_cast<size_t>(sockets), 0);
+    std::vector<int> fds;
+    for (int i = 0; i < sockets; ++i) {
+        int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+        struct sockaddr_in self{};
+        self.sin_family      = AF_INET;
+        self.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(self);
+        if (fd < 0 || bind(fd, reinterpret_cast<sockaddr*>(&self), len) < 0 ||
+            getsockname(fd, reinterpret_cast<sockaddr*>(&self), &len) < 0 ||
+            connect(fd, reinterpret_cast<sockaddr*>(&self), len) < 0) {
+            perror("[bench] udp self-connect");
+            return out;
+        }
+        for (int b = 0; b < backlog; ++b) send(fd, "x", 1, 0);
+        fds.push_back(fd);
+    }
+
+    reactor r(inline_ops);
+    auto end = std::chrono::steady_clock::now() +
+               std::chrono::microseconds(static_cast<long>(secs * 1e6));
+    r.spawn(tick(r, out, end));
+    for (int i = 0; i < sockets; ++i) {
+        r.spawn(echo_forever(r, fds[static_cast<size_t>(i)],
+                             out.frames[static_cast<size_t>(i)], end));
+    }
+    r.run();
+    for (int fd : fds) {
+        r.forget(fd);
+        close(fd);
+    }
+    return out;
+}
+
+static int bench_reactor(const bench_args& a) {
+    int sockets = static_cast<int>(arg_int(a, "sockets", 2));
+    int backlog = static_cast<int>(arg_int(a, "backlog", 64));
+    int ops     = static_cast<int>(arg_int(a, "ops", REACTOR_INLINE_OPS));
+    double secs = static_cast<double>(arg_int(a, "ms", 500)) / 1000.0;
+
+    printf("[bench] reactor: %d always-ready echo loops + 1 ms ticker, %.1f s\n",
+           sockets, secs);
+    for (int limit : {std::numeric_limits<int>::max(), ops}) {
+        reactor_run res = run_reactor(limit, sockets, backlog, secs);
+        printf("[bench]   inline ops %-10s frames per loop:",
+               limit == std::numeric_limits<int>::max() ? "unlimited"
+                                                        : std::to_string(limit).c_str());
+        for (uint64_t f : res.frames) printf(" %llu", static_cast<unsigned long long>(f));
+        printf(" | %llu ticks, worst %.1f ms late\n",
+               static_cast<unsigned long long>(res.ticks), res.max_late_ms);
+    }
+    return 0;
+}
+
+// -------------------------------------------------------------------
+// snapshot: save a decoder holding `sources` x `flows` half-decoded
+// flows, restore it, and check that both copies finish identically.
+// Restore is compared with replaying the raw equations, and the worker
+// stall of serializing in place with that of forking a child to do it.
+// -------------------------------------------------------------------
+
+static int bench_snapshot(const bench_args& a) {
+    apa_t apa;
+    int num_hops = 0;
+    if (!load_bench_apa(a, apa, num_hops)) return 1;
+
+    int sources  = static_cast<int>(arg_int(a, "sources", 64));
+    int flows    = static_cast<int>(arg_int(a, "flows", 64));
+    long before  = arg_int(a, "packets", num_hops);
+    long after   = arg_int(a, "more", 4 * num_hops);
+    std::string path = arg_str(a, "path", "/tmp/recipe_bench.snap");
+
+    std::vector<sim_flow> rack = make_rack(sources, flows, num_hops, 0, 0, 0xC0FFEE);
+    auto feed = [&](multi_flow_decoder& dec, long from, long to) {
+        for (const auto& fl : rack) {
+            for (long i = from; i < to; ++i) {
+                dec.add_equation(fl.key, encode_packet(
+                    apa, flow_pkt_id(fl.salt, static_cast<uint32_t>(i)), fl.switch_ids));
+            }
+        }
+    };
+
+    // Equations as they would be replayed from a packet log
+    std::vector<std::pair<flow_key, packet_equation>> replay_log;
+    for (const auto& fl : rack) {
+        for (long i = 0; i < before; ++i) {
+            replay_log.emplace_back(fl.key, encode_packet(
+                apa, flow_pkt_id(fl.salt, static_cast<uint32_t>(i)), fl.switch_ids));
+        }
+    }
+
+    multi_flow_decoder live(num_hops, 0);
+    auto t0 = std::chrono::steady_clock::now();
+    for (const auto& e : replay_log) live.add_equation(e.first, e.second);
+    double replay_secs = seconds_since(t0);
+
+    t0 = std::chrono::steady_clock::now();
+    snapshot_writer w;
+    live.save(w.section(SNAP_DECODER));
+    double save_secs = seconds_since(t0);
+    t0 = std::chrono::steady_clock::now();
+    if (!w.commit(path, 1)) return 1;
+    double commit_secs = seconds_since(t0);
+
+    // The collector forks and serializes in the child (copy-on-write)
+    std::string fork_path = path + ".fork";
+    t0 = std::chrono::steady_clock::now();
+    pid_t pid = fork();
+    if (pid == 0) {
+        snapshot_writer cw;
+        live.save(cw.section(SNAP_DECODER));
+        _exit(cw.commit(fork_path, 2) ? 0 : 1);
+    }
+    double fork_secs = seconds_since(t0);
+    int status = 1;
+    if (pid > 0) waitpid(pid, &status, 0);
+    double child_secs = seconds_since(t0);
+    unlink(fork_path.c_str());
+
+    multi_flow_decoder restored(num_hops, 0);
+    t0 = std::chrono::steady_clock::now();
+    auto r = std::make_shared<snapshot_reader>();
+    if (!r->open(path) || !restored.load(r)) {
+        std::cerr << "[bench] Restore failed\n";
+        return 1;
+    }
+    double load_secs = seconds_since(t0);
+    r.reset();   // the decoder keeps the mapping while it needs it
+
+    // Every flow read in from the mapping
+    t0 = std::chrono::steady_clock::now();
+    size_t touched = 0;
+    for (const auto& fl : rack) touched += restored.has_flow(fl.key);
+    double touch_secs = seconds_since(t0);
+
+    struct stat st{};
+    stat(path.c_str(), &st);
+    printf("[bench] snapshot: %zu flows (%zu decoded) after %ld packets, hops=%d\n",
+           live.num_flows(), live.decoded_flows(), before, num_hops);
+    printf("[bench]   file %.1f MiB, serialize %.1f ms, commit %.1f ms, replay %.1f ms\n",
+           static_cast<double>(st.st_size) / (1024.0 * 1024.0), save_secs * 1e3,
+           commit_secs * 1e3, replay_secs * 1e3);
+    printf("[bench]   worker stall: serialize in place %.1f ms, fork %.2f ms "
+           "(child %s after %.1f ms)\n",
+           save_secs * 1e3, fork_secs * 1e3,
+           pid > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0 ? "done" : "FAILED",
+           child_secs * 1e3);
+    printf("[bench]   restore %.3f ms, first touch of %zu flows %.1f ms\n",
+           load_secs * 1e3, touched, touch_secs * 1e3);
+
+    feed(live, before, before + after);
+    feed(restored, before, before + after);
+    size_t same = 0;
+    for (const auto& fl : rack) {
+        const std::vector<uint16_t>* x = live.path(fl.key);
+        const std::vector<uint16_t>* y = restored.path(fl.key);
+        same += (!x && !y) || (x && y && *x == *y);
+    }
+    printf("[bench]   after %ld more packets: %zu vs %zu decoded, %zu/%zu flows identical\n",
+           after, live.decoded_flows(), restored.decoded_flows(), same, rack.size());
+    unlink(path.c_str());
+    return same == rack.size() ? 0 : 1;
+}
+
+// -------------------------------------------------------------------
+// sketch: top-k paths and (switch, hop) pairs under Zipf traffic, from
+// two half-stream sketches merged, against exact counters.
+// -------------------------------------------------------------------
+
+static void report_topk(const char* name, const heavy_hitters& hh,
+                        const std::unordered_map<uint64_t, uint64_t>& exact, size_t k) {
+    std::vector<std::pair<uint64_t, uint64_t>> truth(exact.begin(), exact.end());
+    std::sort(truth.begin(), truth.end(), [](const auto& x, const auto& y) {
+        return x.second > y.second;
+    });
+    if (truth.size() > k) truth.resize(k);
+
+    auto top = hh.top();
+    size_t found = 0;
+    double worst = 0;
+    for (const auto& t : truth) {
+        for (const auto& e : top) found += e.first == t.first;
+        double err = static_cast<double>(hh.estimate(t.first) - t.second) / t.second;
+        worst = std::max(worst, err);
+    }
+    printf("[bench]   %-6s recall %zu/%zu of exact top-%zu, max overestimate %.2f%%, "
+           "%zu distinct keys\n",
+           name, found, truth.size(), k, 100.0 * worst, exact.size());
+}
+
+static int bench_sketch(const bench_args& a) {
+    long flows   = arg_int(a, "flows", 200000);
+    long packets = arg_int(a, "packets", 10000000);
+    int k        = static_cast<int>(arg_int(a, "k", 16));
+    size_t topk  = static_cast<size_t>(arg_int(a, "top", 32));
+    int width    = static_cast<int>(arg_int(a, "width", 4096));
+    double zipf  = std::atof(arg_str(a, "zipf", "1.1").c_str());
+
+    // Flow f sends with weight 1/(f+1)^zipf over a random fat-tree path
+    std::mt19937 rng(0xC0FFEE);
+    std::vector<std::vector<uint16_t>> paths;
+    std::vector<double> weights;
+    for (long f = 0; f < flows; ++f) {
+        paths.push_back(fat_tree_path(k, rng));
+        weights.push_back(1.0 / std::pow(static_cast<double>(f + 1), zipf));
+    }
+    std::discrete_distribution<long> pick(weights.begin(), weights.end());
+    std::vector<long> sends(static_cast<size_t>(packets));
+    for (auto& s : sends) s = pick(rng);
+
+    heavy_hitters half[2] = {heavy_hitters(topk, 4, width), heavy_hitters(topk, 4, width)};
+    heavy_hitters hop_half[2] = {heavy_hitters(topk, 4, width), heavy_hitters(topk, 4, width)};
+    std::unordered_map<uint64_t, uint64_t> exact_paths, exact_hops;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (long i = 0; i < packets; ++i) {
+        const std::vector<uint16_t>& p = paths[sends[i]];
+        half[i & 1].add(path_store::path_fingerprint(p));
+        for (size_t h = 0; h < p.size(); ++h) {
+            hop_half[i & 1].add(hop_sketch_key(p[h], static_cast<int>(h)));
+        }
+    }
+    double secs = seconds_since(t0);
+
+    for (long i = 0; i < packets; ++i) {
+        const std::vector<uint16_t>& p = paths[sends[i]];
+        ++exact_paths[path_store::path_fingerprint(p)];
+        for (size_t h = 0; h < p.size(); ++h) {
+            ++exact_hops[hop_sketch_key(p[h], static_cast<int>(h))];
+        }
+    }
+
+    half[0].merge(half[1]);
+    hop_half[0].merge(hop_half[1]);
+    printf("[bench] sketch: %ld packets over %ld flows (zipf %.2f), k=%d fat tree\n",
+           packets, flows, zipf, k);
+    printf("[bench]   %.1f ns/packet (path + %zu hops), %.1f KiB per sketch, "
+           "exact maps ~%.1f KiB\n",
+           secs * 1e9 / packets, paths[0].size(),
+           static_cast<double>(half[0].memory_bytes()) / 1024.0,
+           static_cast<double>((exact_paths.size() + exact_hops.size()) * 32) / 1024.0);
+    report_topk("paths", half[0], exact_paths, topk);
+    report_topk("hops", hop_half[0], exact_hops, topk);
+    return 0;
+}
+
+// -------------------------------------------------------------------
+// schedule: time-to-path under overload, in ticks. Flow f starts at
+// f*stagger and sends one packet per tick until it decodes; the decoder
+// takes `overload` times fewer equations per tick than arrive. Drop-tail
+// FIFO vs. decode_scheduler, both holding at most `queue` equations.
+// -------------------------------------------------------------------
+
+struct schedule_result {
+    std::vector<long> ttp;   // ticks from a flow's start to its path
+    size_t decoded = 0;
+    size_t dropped = 0;      // equations refused or shed
+    long ticks     = 0;
+};
+
+using schedule_arrivals = std::vector<std::pair<flow_key, const packet_equation*>>;
+
+// `feed` queues the tick's arrivals, feeds up to `credit` equations into
+// the decoder and returns how many it fed.
+template <typename Feed>
+static schedule_result run_schedule(const std::vector<std::vector<packet_equation>>& eqs,
+                                    int num_hops, long stagger, long budget, Feed feed) {
+    multi_flow_decoder dec(num_hops, 0);
+    schedule_result r;
+    long flows = static_cast<long>(eqs.size()), packets = static_cast<long>(eqs[0].size());
+    std::vector<bool> done(eqs.size(), false);
+    std::vector<flow_key> decoded;
+    schedule_arrivals arrivals;
+
+    long end = (flows - 1) * stagger + packets, credit = 0;
+    // Past the last arrival, run until the queue is drained
+    for (long tick = 0, idle = 0; tick < end || idle < 2; ++tick) {
+        arrivals.clear();
+        for (long f = 0; f < flows && tick < end; ++f) {
+            long n = tick - f * stagger;
+            if (n < 0 || n >= packets || done[f]) continue;
+            arrivals.emplace_back(bench_flow(f), &eqs[f][n]);
+        }
+        credit = std::min(credit + budget, budget);   // no saving up idle ticks
+        long fed = feed(dec, arrivals, credit, r.dropped);
+        credit  -= fed;
+        idle = tick >= end && fed == 0 ? idle + 1 : 0;
+
+        dec.drain_decoded(decoded);
+        for (const auto& key : decoded) {
+            long f = static_cast<long>(key.src_addr);
+            done[f] = true;
+            ++r.decoded;
+            r.ttp.push_back(tick - f * stagger);
+        }
+        decoded.clear();
+        r.ticks = tick + 1;
+    }
+    return r;
+}
+
+// Percentiles over all flows, an undecoded flow counting as never done
+static void report_schedule(const char* name, schedule_result& r, long flows) {
+    std::sort(r.ttp.begin(), r.ttp.end());
+    auto pct = [&](double q) {
+        size_t i = static_cast<size_t>(q * static_cast<double>(flows - 1));
+        return i < r.ttp.size() ? std::to_string(r.ttp[i]) : std::string("-");
+    };
+    printf("[bench]   %-9s %zu/%ld decoded, time-to-path median %s p90 %s p99 %s, "
+           "%zu eqs dropped, drained at tick %ld\n",
+           name, r.decoded, flows, pct(0.5).c_str(), pct(0.9).c_str(), pct(0.99).c_str(),
+           r.dropped, r.ticks);
+}
+
+static int bench_schedule(const bench_args& a) {
+    apa_t apa;
+    int num_hops = 0;
+    if (!load_bench_apa(a, apa, num_hops)) return 1;
+
+    long flows      = arg_int(a, "flows", 2048);
+    long packets    = arg_int(a, "packets", 4L * num_hops);
+    long stagger    = arg_int(a, "stagger", 1);
+    double overload = std::atof(arg_str(a, "overload", "1.5").c_str());
+    size_t queue    = static_cast<size_t>(arg_int(a, "queue", 64L * num_hops));
+    double age      = 1.0 / static_cast<double>(arg_int(a, "age", 256));
+
+    auto eqs = encode_flows(apa, num_hops, static_cast<int>(flows), packets, 0xC0FFEE);
+    // Flows decode after ~1.3x num_hops packets, so arrivals run at about
+    // min(flows, 1.3 num_hops / stagger) per tick
+    double concurrent = std::min(static_cast<double>(flows),
+                                 1.3 * num_hops / static_cast<double>(stagger));
+    long budget = std::max(1L, std::lround(concurrent / overload));
+
+    printf("[bench] schedule: %ld flows x <= %ld packets, one started every %ld ticks, "
+           "hops=%d, %ld eqs/tick decoded, queue %zu\n",
+           flows, packets, stagger, num_hops, budget, queue);
+
+    std::deque<std::pair<flow_key, const packet_equation*>> fifo;
+    auto t0 = std::chrono::steady_clock::now();
+    schedule_result plain = run_schedule(eqs, num_hops, stagger, budget,
+        [&](multi_flow_decoder& dec, const schedule_arrivals& in, long credit, size_t& dropped) {
+            for (const auto& e : in) {
+                if (fifo.size() < queue) fifo.push_back(e);
+                else ++dropped;
+            }
+            long fed = 0;
+            while (fed < credit && !fifo.empty()) {
+                // Leftovers of decoded flows cost nothing
+                if (!dec.path(fifo.front().first)) {
+                    dec.add_equation(fifo.front().first, *fifo.front().second);
+                    ++fed;
+                }
+                fifo.pop_front();
+            }
+            return fed;
+        });
+    double fifo_secs = seconds_since(t0);
+
+    decode_scheduler sched(num_hops, queue, age);
+    t0 = std::chrono::steady_clock::now();
+    schedule_result ranked = run_schedule(eqs, num_hops, stagger, budget,
+        [&](multi_flow_decoder& dec, const schedule_arrivals& in, long credit, size_t&) {
+            for (const auto& e : in) sched.push(e.first, *e.second);
+            return credit > 0 ? static_cast<long>(sched.run(dec, static_cast<size_t>(credit)))
+                              : 0L;
+        });
+    double sched_secs = seconds_since(t0);
+    ranked.dropped = sched.shed() + sched.rejected();
+
+    report_schedule("fifo", plain, flows);
+    report_schedule("scheduler", ranked, flows);
+    printf("[bench]   scheduler dropped %zu redundant eqs before the decoder; "
+           "wall time %.2f s vs %.2f s\n", sched.redundant(), sched_secs, fifo_secs);
+    return 0;
+}
+
+// -------------------------------------------------------------------
+// transport: raw-socket frame rate of each frame_transport backend over
+// a veth pair (needs root): `frames` frames sent from `tx` in batches of
+// `batch`, each batch drained from `rx` before the next.
+// -------------------------------------------------------------------
+
+constexpr uint16_t BENCH_ETHERTYPE = 0x88B5;   // IEEE local experimental
+
+static void run_transport(const std::string& kind, bool sqpoll, const std::string& tx_if,
+                          const std::string& rx_if, long frames, size_t batch, size_t size) {
+    int tx_index = 0, rx_index = 0;
+    // Protocol 0: the sending socket captures nothing
+    int tx_fd = open_raw_socket(tx_if, tx_index, 0);
+    int rx_fd = open_raw_socket(rx_if, rx_index, BENCH_ETHERTYPE);
+    if (tx_fd < 0 || rx_fd < 0) {
+        if (tx_fd >= 0) close(tx_fd);
+        if (rx_fd >= 0) close(rx_fd);
+        return;
+    }
+    int rcvbuf = 64 << 20;
+    setsockopt(rx_fd, SOL_SOCKET, SO_RCVBUFFORCE, &rcvbuf, sizeof(rcvbuf));
+
+    transport_options opt;
+    opt.frames = std::max<size_t>(batch, 1024);
+    opt.sqpoll = sqpoll;
+    auto tx = make_transport(kind, tx_fd, tx_index, opt);
+    auto rx = make_transport(kind, rx_fd, rx_index, opt);
+    if (!tx || !rx) {
+        close(tx_fd);
+        close(rx_fd);
+        return;
+    }
+
+    std::vector<std::vector<uint8_t>> data(batch, std::vector<uint8_t>(size, 0));
+    std::vector<frame_view> out, in;
+    for (auto& f : data) {
+        std::memset(f.data(), 0xff, 6);                 // broadcast
+        f[12] = BENCH_ETHERTYPE >> 8;
+        f[13] = BENCH_ETHERTYPE & 0xff;
+        out.push_back(frame_view{f.data(), f.size()});
+    }
+
+    double send_secs = 0, recv_secs = 0;
+    long sent = 0, received = 0, bad = 0;
+    while (sent < frames) {
+        size_t n = std::min<size_t>(batch, static_cast<size_t>(frames - sent));
+        out.resize(n);
+        for (size_t i = 0; i < n; ++i) {
+            uint32_t seq = static_cast<uint32_t>(sent + i);
+            std::memcpy(data[i].data() + 14, &seq, sizeof(seq));
+        }
+        auto t0 = std::chrono::steady_clock::now();
+        int k = tx->send_batch(out);
+        send_secs += seconds_since(t0);
+        if (k <= 0) break;
+        long target = sent + k;
+
+        t0 = std::chrono::steady_clock::now();
+        while (received < target) {
+            in.clear();
+            int got = rx->recv_batch(in, batch, 100);
+            if (got <= 0) break;   // 100 ms without a frame: lost
+            for (const auto& f : in) {
+                uint32_t seq;
+                std::memcpy(&seq, f.data + 14, sizeof(seq));
+                bad += f.len < 18 || seq != static_cast<uint32_t>(received);
+                ++received;
+            }
+        }
+        recv_secs += seconds_since(t0);
+        if (received < target) bad += target - received;
+        sent = target;
+        received = target;   // resync after a loss
+    }
+
+    // On veth the receive side's softirq work runs inside the sender's
+    // syscall, so only the combined rate compares backends fairly
+    printf("[bench]   %-13s send %6.2f  recv %6.2f  both %6.2f M frames/s  "
+           "(%ld frames, %ld lost or reordered)\n",
+           rx->name(), static_cast<double>(sent) / send_secs / 1e6,
+           static_cast<double>(sent) / recv_secs / 1e6,
+           static_cast<double>(sent) / (send_secs + recv_secs) / 1e6, sent, bad);
+    tx.reset();
+    rx.reset();
+    close(tx_fd);
+    close(rx_fd);
+}
+
+static int bench_transport(const bench_args& a) {
+    std::string tx_if = arg_str(a, "tx", "veth0");
+    std::string rx_if = arg_str(a, "rx", "veth1");
+    std::string which = arg_str(a, "backend", "all");
+    long frames  = arg_int(a, "frames", 500000);
+    size_t batch = static_cast<size_t>(arg_int(a, "batch", 32));
+    size_t size  = static_cast<size_t>(arg_int(a, "size", 64));
+    if (size < 18) size = 18;
+
+    printf("[bench] transport: %ld frames of %zu bytes, %s -> %s, batches of %zu\n",
+           frames, size, tx_if.c_str(), rx_if.c_str(), batch);
+    for (const char* kind : {"socket", "mmsg", "uring", "uring+sqpoll"}) {
+        if (which != "all" && which != kind) continue;
+        bool sqpoll = std::strcmp(kind, "uring+sqpoll") == 0;
+        run_transport(sqpoll ? "uring" : kind, sqpoll, tx_if, rx_if, frames, batch, size);
+    }
+    return 0;
+}
+
+// -------------------------------------------------------------------
+// codebook: build, save and map the fixed-hash xor_set codebook for
+// pkt_ids [first, first + pktids), check it against reconstruct_xor_set()
+// and compare per-packet lookup with hop-by-hop reconstruction.
+// -------------------------------------------------------------------
+
+static int bench_codebook(const bench_args& a) {
+    apa_t apa;
+    int num_hops = 0;
+    if (!load_bench_apa(a, apa, num_hops)) return 1;
+    uint32_t first  = static_cast<uint32_t>(arg_int(a, "first", 0));
+    uint32_t count  = static_cast<uint32_t>(arg_int(a, "pktids", 65536));
+    long lookups    = arg_int(a, "lookups", 10000000);
+    std::string out = arg_str(a, "out", "/tmp/recipe_codebook.bin");
+
+    xor_codebook built;
+    auto t0 = std::chrono::steady_clock::now();
+    if (!built.build(apa, num_hops, first, count)) return 1;
+    double build_secs = seconds_since(t0);
+    if (!built.save(out)) return 1;
+
+    xor_codebook book;
+    t0 = std::chrono::steady_clock::now();
+    if (!book.open(out) || !book.matches(apa, num_hops)) return 1;
+    double open_secs = seconds_since(t0);
+    printf("[bench] codebook: hops=%d, pkt_ids %u..%u, %zu bytes in %s\n", num_hops, first,
+           first + count - 1, book.bytes(), out.c_str());
+    printf("[bench]   built in %.3f s, mapped in %.1f us\n", build_secs, open_secs * 1e6);
+
+    size_t wrong = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        hop_mask m;
+        book.lookup(first + i, m);
+        wrong += m != reconstruct_xor_set(apa, num_hops, first + i);
+    }
+
+    // Receiver-side cost per packet: same pkt_id stream both ways
+    std::mt19937 rng(7);
+    std::vector<uint32_t> ids(static_cast<size_t>(std::min(lookups, 1L << 20)));
+    for (auto& id : ids) id = first + static_cast<uint32_t>(rng() % count);
+    uint64_t sink = 0;
+    t0 = std::chrono::steady_clock::now();
+    for (long n = 0; n < lookups / 16; ++n) {
+        sink += reconstruct_xor_set(apa, num_hops, ids[n % ids.size()]).w[0];
+    }
+    double replay_rate = static_cast<double>(lookups / 16) / seconds_since(t0);
+    t0 = std::chrono::steady_clock::now();
+    for (long n = 0; n < lookups; ++n) {
+        hop_mask m;
+        book.lookup(ids[n % ids.size()], m);
+        sink += m.w[0];
+    }
+    double lookup_rate = static_cast<double>(lookups) / seconds_since(t0);
+
+    printf("[bench]   replay %8.2f M xor_sets/s   lookup %8.2f M xor_sets/s   (%.0fx, "
+           "%zu mismatches, checksum %llu)\n",
+           replay_rate / 1e6, lookup_rate / 1e6, lookup_rate / replay_rate, wrong,
+           static_cast<unsigned long long>(sink & 0xff));
+    return wrong == 0 ? 0 : 1;
+}
+
+// -------------------------------------------------------------------
+// plan: fixed-hash flows that each keep `packets` pkt_ids starting at 1,
+// minus random losses, decoded per flow by elimination vs. by a cached
+// decode plan keyed on the received pkt_id set.
+// -------------------------------------------------------------------
+
+static int bench_plan(const bench_args& a) {
+    apa_t apa;
+    int num_hops = 0;
+    if (!load_bench_apa(a, apa, num_hops)) return 1;
+    long flows    = arg_int(a, "flows", 4096);
+    long packets  = arg_int(a, "packets", 3L * num_hops);
+    long loss_ppm = arg_int(a, "loss-ppm", 0);
+    size_t cap    = static_cast<size_t>(arg_int(a, "cache", 4096));
+
+    xor_codebook book;
+    if (!book.build(apa, num_hops, 1, static_cast<uint32_t>(packets))) return 1;
+
+    struct fixed_flow {
+        std::vector<uint16_t> switch_ids;
+        std::vector<packet_equation> eqs;   // in pkt_id order
+    };
+    std::mt19937 rng(0xC0FFEE);
+    std::vector<fixed_flow> rack(static_cast<size_t>(flows));
+    for (auto& fl : rack) {
+        fl.switch_ids.resize(static_cast<size_t>(num_hops));
+        for (auto& id : fl.switch_ids) id = static_cast<uint16_t>(rng());
+        for (long n = 1; n <= packets; ++n) {
+            if (static_cast<long>(rng() % 1000000) < loss_ppm) continue;
+            fl.eqs.push_back(encode_packet(book, static_cast<uint32_t>(n), fl.switch_ids));
+        }
+    }
+
+    size_t elim_ok = 0, elim_wrong = 0;
+    std::vector<uint16_t> ids;
+    auto t0 = std::chrono::steady_clock::now();
+    for (const auto& fl : rack) {
+        online_decoder dec(num_hops);
+        for (const auto& eq : fl.eqs) {
+            hop_mask m;
+            book.lookup(eq.pktid, m);
+            dec.add_equation(m, eq.pint);
+            if (dec.solved()) break;
+        }
+        if (!dec.solve(ids)) continue;
+        ++elim_ok;
+        elim_wrong += ids != fl.switch_ids;
+    }
+    double elim_secs = seconds_since(t0);
+
+    decode_plan_cache cache(cap);
+    size_t plan_ok = 0, plan_wrong = 0;
+    size_t plan_len = 0;
+    std::vector<uint32_t> pktids;
+    std::vector<std::vector<uint16_t>> pints(rack.size());
+    std::vector<std::shared_ptr<const decode_plan>> plans(rack.size());
+    ids.resize(static_cast<size_t>(num_hops));
+    t0 = std::chrono::steady_clock::now();
+    for (size_t f = 0; f < rack.size(); ++f) {
+        pktids.clear();
+        for (const auto& eq : rack[f].eqs) {
+            pktids.push_back(eq.pktid);
+            pints[f].push_back(eq.pint);   // already in pkt_id order
+        }
+        plans[f] = cache.get(book, pktids);
+        if (!plans[f] || !plans[f]->apply(pints[f].data(), ids.data())) continue;
+        ++plan_ok;
+        plan_len += plans[f]->length();
+        plan_wrong += ids != rack[f].switch_ids;
+    }
+    double plan_secs = seconds_since(t0);
+
+    // The plan program alone, with lookups already done
+    uint64_t sink = 0;
+    t0 = std::chrono::steady_clock::now();
+    for (size_t f = 0; f < rack.size(); ++f) {
+        if (plans[f] && plans[f]->apply(pints[f].data(), ids.data())) sink += ids[0];
+    }
+    double apply_secs = seconds_since(t0);
+
+    printf("[bench] plan: %ld fixed-hash flows x %ld packets, hops=%d, loss %.2f%%\n", flows,
+           packets, num_hops, static_cast<double>(loss_ppm) / 1e4);
+    printf("[bench]   elimination %8.0f flows/s  (%zu decoded, %zu wrong)\n",
+           static_cast<double>(flows) / elim_secs, elim_ok, elim_wrong);
+    printf("[bench]   plan        %8.0f flows/s  (%zu decoded, %zu wrong, %.0f XORs/flow, "
+           "%zu hits / %zu misses, %zu plans kept)\n",
+           static_cast<double>(flows) / plan_secs, plan_ok, plan_wrong,
+           plan_ok ? static_cast<double>(plan_len) / static_cast<double>(plan_ok) : 0.0,
+           cache.hits(), cache.misses(), cache.size());
+    printf("[bench]   plan apply  %8.0f flows/s  (without the cache lookup, checksum %llu)\n",
+           static_cast<double>(flows) / apply_secs, static_cast<unsigned long long>(sink & 0xff));
+
+    // Same programs, PLAN_LANES flows of one plan per run
+    std::unordered_map<const decode_plan*, std::vector<size_t>> by_plan;
+    for (size_t f = 0; f < rack.size(); ++f) {
+        if (plans[f] && plans[f]->full_rank()) by_plan[plans[f].get()].push_back(f);
+    }
+    std::vector<std::vector<uint16_t>> out(rack.size(),
+                                           std::vector<uint16_t>(static_cast<size_t>(num_hops)));
+    plan_batch_executor exec(num_hops);
+    const uint16_t* in_ptr[PLAN_LANES];
+    uint16_t* out_ptr[PLAN_LANES];
+    size_t runs = 0, batched = 0;
+    t0 = std::chrono::steady_clock::now();
+    for (const auto& [plan, members] : by_plan) {
+        for (size_t i = 0; i < members.size(); i += PLAN_LANES) {
+            size_t n = std::min(PLAN_LANES, members.size() - i);
+            for (size_t k = 0; k < n; ++k) {
+                in_ptr[k]  = pints[members[i + k]].data();
+                out_ptr[k] = out[members[i + k]].data();
+            }
+            exec.run(*plan, in_ptr, out_ptr, n);
+            ++runs;
+            batched += n;
+        }
+    }
+    double batch_secs = seconds_since(t0);
+    size_t batch_wrong = 0;
+    for (const auto& [plan, members] : by_plan) {
+        for (size_t f : members) batch_wrong += out[f] != rack[f].switch_ids;
+    }
+    printf("[bench]   plan batch  %8.0f flows/s  (%zu flows in %zu runs of <= %zu lanes, "
+           "%.1f us, %zu wrong)\n",
+           static_cast<double>(batched) / batch_secs, batched, runs, PLAN_LANES,
+           batch_secs * 1e6, batch_wrong);
+
+    // Prefix chain: an O(1) check on the highest contiguous pkt_id (which
+    // a receiver tracks as packets arrive) routes every flow past the
+    // first full-rank k to one shared plan, batched; the others are
+    // eliminated as usual, since lossy pkt_id sets rarely repeat
+    std::vector<uint32_t> highest(rack.size(), 0);
+    for (size_t f = 0; f < rack.size(); ++f) {
+        for (const auto& eq : rack[f].eqs) {
+            if (eq.pktid != highest[f] + 1) break;
+            highest[f] = eq.pktid;
+        }
+    }
+    decode_plan_cache hybrid(cap);
+    t0 = std::chrono::steady_clock::now();
+    const prefix_plan_chain& chain = hybrid.prefix(book, 1);
+    double chain_secs = seconds_since(t0);
+    printf("[bench]   prefix chain: full rank at k=%zu pkt_ids (rank %d at k=hops), "
+           "built in %.1f us\n",
+           chain.full_rank_k(), chain.rank_at(static_cast<size_t>(num_hops)), chain_secs * 1e6);
+
+    size_t via_prefix = 0, via_elim = 0, hybrid_ok = 0, hybrid_wrong = 0;
+    std::vector<size_t> lane_flows;
+    t0 = std::chrono::steady_clock::now();
+    auto flush = [&]() {
+        size_t n = lane_flows.size();
+        for (size_t k = 0; k < n; ++k) {
+            in_ptr[k]  = pints[lane_flows[k]].data();
+            out_ptr[k] = out[lane_flows[k]].data();
+        }
+        if (n > 0 && exec.run(*chain.plan(), in_ptr, out_ptr, n)) hybrid_ok += n;
+        lane_flows.clear();
+    };
+    for (size_t f = 0; f < rack.size(); ++f) {
+        if (chain.decodable(highest[f])) {
+            ++via_prefix;
+            lane_flows.push_back(f);
+            if (lane_flows.size() == PLAN_LANES) flush();
+            continue;
+        }
+        ++via_elim;
+        online_decoder dec(num_hops);
+        for (const auto& eq : rack[f].eqs) {
+            hop_mask m;
+            book.lookup(eq.pktid, m);
+            dec.add_equation(m, eq.pint);
+            if (dec.solved()) break;
+        }
+        if (dec.solve(ids)) {
+            std::copy(ids.begin(), ids.end(), out[f].begin());
+            ++hybrid_ok;
+        }
+    }
+    flush();
+    double hybrid_secs = seconds_since(t0);
+    for (size_t f = 0; f < rack.size(); ++f) hybrid_wrong += out[f] != rack[f].switch_ids;
+    printf("[bench]   plan prefix %8.0f flows/s  (%zu via the prefix plan, %zu eliminated, "
+           "%zu decoded, %zu wrong)\n",
+           static_cast<double>(flows) / hybrid_secs, via_prefix, via_elim, hybrid_ok,
+           hybrid_wrong);
+    return elim_wrong + plan_wrong + batch_wrong + hybrid_wrong == 0 ? 0 : 1;
+}
+
+// -------------------------------------------------------------------
+// crc: CRC-variant hash_id per (pkt_id, hop) as a 5-byte CRC vs. by CRC
+// linearity (one XOR), checked against each other and timed as xor_set
+// reconstruction for `packets` packets of `flows` flows.
+// -------------------------------------------------------------------
+
+static int bench_crc(const bench_args& a) {
+    apa_t apa;
+    int num_hops = 0;
+    if (!load_bench_apa(a, apa, num_hops)) return 1;
+    long flows   = arg_int(a, "flows", 64);
+    long packets = arg_int(a, "packets", 4096);
+
+    const uint8_t check[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    if (crc32(check, sizeof(check)) != 0xCBF43926u) {
+        std::cerr << "[bench] crc32 check value mismatch\n";
+        return 1;
+    }
+
+    std::vector<uint32_t> pkt_ids;
+    for (long f = 0; f < flows; ++f) {
+        for (long n = 1; n <= packets; ++n) {
+            pkt_ids.push_back(tofino_pkt_id(0x0a000001u, 0x14000000u + static_cast<uint32_t>(f),
+                                            146, static_cast<uint16_t>(n)));
+        }
+    }
+
+    crc_hop_hash hash;
+    size_t wrong = 0;
+    for (size_t i = 0; i < pkt_ids.size() && i < 65536; ++i) {
+        uint32_t term = hash.pkt_term(pkt_ids[i]);
+        for (int hop = 0; hop < 256; ++hop) {
+            wrong += hash(term, hop) != tofino_hop_hash(pkt_ids[i], static_cast<uint8_t>(hop));
+        }
+    }
+
+    uint64_t sink = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (uint32_t id : pkt_ids) {
+        sink += replay_xor_set(apa, num_hops, [id](int hop) {
+            return tofino_hop_hash(id, static_cast<uint8_t>(hop));
+        }).w[0];
+    }
+    double bytes_secs = seconds_since(t0);
+    t0 = std::chrono::steady_clock::now();
+    for (uint32_t id : pkt_ids) sink += reconstruct_xor_set_crc(apa, num_hops, id, hash).w[0];
+    double linear_secs = seconds_since(t0);
+    t0 = std::chrono::steady_clock::now();
+    for (uint32_t id : pkt_ids) sink += reconstruct_xor_set(apa, num_hops, id).w[0];
+    double mix_secs = seconds_since(t0);
+
+    double n = static_cast<double>(pkt_ids.size());
+    printf("[bench] crc: %zu packets, hops=%d (%zu hash mismatches, checksum %llu)\n",
+           pkt_ids.size(), num_hops, wrong, static_cast<unsigned long long>(sink & 0xff));
+    printf("[bench]   5-byte CRC per hop   %7.2f M xor_sets/s\n", n / bytes_secs / 1e6);
+    printf("[bench]   CRC linearity        %7.2f M xor_sets/s  (%.1fx)\n", n / linear_secs / 1e6,
+           bytes_secs / linear_secs);
+    printf("[bench]   recipe_hash_v4       %7.2f M xor_sets/s  (fixed-hash replay, for reference)\n",
+           n / mix_secs / 1e6);
+    return wrong == 0 ? 0 : 1;
+}
+
+// -------------------------------------------------------------------
+// image: xor_set replay with the APA compiled in (make APA_IMAGE=...)
+// vs. the runtime-loaded thresholds, for both hash variants, checked
+// against each other over the full and a shortened path.
+// -------------------------------------------------------------------
+
+static int bench_image(const bench_args& a) {
+    apa_t apa;
+    int num_hops = 0;
+    if (!load_bench_apa(a, apa, num_hops)) return 1;
+    long packets = arg_int(a, "packets", 65536);
+
+    std::span<const apa_image_info> images = embedded_apa_images();
+    printf("[bench] image: %zu APA images embedded\n", images.size());
+    for (const apa_image_info& image : images) {
+        printf("[bench]   %-14s hops=%3d  %6zu of %6zu thresholds kept (%.0f%%)\n", image.name,
+               image.hops, image.thresholds, image.full_thresholds,
+               100.0 * static_cast<double>(image.thresholds) / static_cast<double>(image.full_thresholds));
+    }
+    if (!apa.image) {
+        printf("[bench] %s is not embedded; runtime loader only (rebuild with make APA_IMAGE=...)\n",
+               arg_str(a, "apa", "../APA/robust32_1.txt").c_str());
+    }
+
+    apa_t runtime = apa;
+    runtime.image = nullptr;
+
+    std::vector<uint32_t> pkt_ids(static_cast<size_t>(packets));
+    for (size_t i = 0; i < pkt_ids.size(); ++i) pkt_ids[i] = mix32(static_cast<uint32_t>(i) + 1);
+
+    size_t wrong = 0;
+    for (int hops : {num_hops, num_hops / 2}) {
+        for (size_t i = 0; i < pkt_ids.size() && i < 65536; ++i) {
+            wrong += reconstruct_xor_set(apa, hops, pkt_ids[i]) !=
+                     reconstruct_xor_set(runtime, hops, pkt_ids[i]);
+            wrong += reconstruct_xor_set_crc(apa, hops, pkt_ids[i]) !=
+                     reconstruct_xor_set_crc(runtime, hops, pkt_ids[i]);
+        }
+    }
+
+    // Best of `rounds`, alternating the variants so that drift on a
+    // shared machine hits all of them alike
+    long rounds = arg_int(a, "rounds", 5);
+    uint64_t sink = 0;
+    auto rate = [&](auto&& replay) {
+        auto t0 = std::chrono::steady_clock::now();
+        for (uint32_t id : pkt_ids) sink += replay(id).w[0];
+        return static_cast<double>(pkt_ids.size()) / seconds_since(t0) / 1e6;
+    };
+    double v4_runtime = 0, v4_image = 0, crc_runtime = 0, crc_image = 0;
+    for (long r = 0; r < rounds; ++r) {
+        v4_runtime  = std::max(v4_runtime, rate([&](uint32_t id) { return reconstruct_xor_set(runtime, num_hops, id); }));
+        v4_image    = std::max(v4_image, rate([&](uint32_t id) { return reconstruct_xor_set(apa, num_hops, id); }));
+        crc_runtime = std::max(crc_runtime, rate([&](uint32_t id) { return reconstruct_xor_set_crc(runtime, num_hops, id); }));
+        crc_image   = std::max(crc_image, rate([&](uint32_t id) { return reconstruct_xor_set_crc(apa, num_hops, id); }));
+    }
+
+    printf("[bench] %zu packets, hops=%d, image %s (%zu mismatches, checksum %llu)\n",
+           pkt_ids.size(), num_hops, apa.image ? apa.image->name : "none", wrong,
+           static_cast<unsigned long long>(sink & 0xff));
+    printf("[bench]   recipe_hash_v4  runtime %7.2f  image %7.2f M xor_sets/s  (%.2fx)\n",
+           v4_runtime, v4_image, v4_image / v4_runtime);
+    printf("[bench]   CRC linearity   runtime %7.2f  image %7.2f M xor_sets/s  (%.2fx)\n",
+           crc_runtime, crc_image, crc_image / crc_runtime);
+    return wrong == 0 ? 0 : 1;
+}
+
+// -------------------------------------------------------------------
+// lazy: flows of `packets` fixed-hash packets each (pkt_ids count up
+// from a random IPv4 identification), decoded once the window is in:
+// every xor_set reconstructed up front and eliminated, vs. lazy
+// equations pulled by the peeling decoder, without and with a shared
+// LRU of xor_sets.
+// -------------------------------------------------------------------
+
+static int bench_lazy(const bench_args& a) {
+    apa_t apa;
+    int num_hops = 0;
+    if (!load_bench_apa(a, apa, num_hops)) return 1;
+    long flows   = arg_int(a, "flows", 1024);
+    long packets = arg_int(a, "packets", 3L * num_hops);
+    size_t cap   = static_cast<size_t>(arg_int(a, "cache", 4096));
+
+    struct window {
+        std::vector<uint16_t> switch_ids;
+        std::vector<lazy_equation> eqs;
+    };
+    std::mt19937 rng(0xC0FFEE);
+    std::vector<window> rack(static_cast<size_t>(flows));
+    for (auto& fl : rack) {
+        fl.switch_ids.resize(static_cast<size_t>(num_hops));
+        for (auto& id : fl.switch_ids) id = static_cast<uint16_t>(rng());
+        uint32_t ident = rng() & 0xffff;
+        for (long n = 0; n < packets; ++n) {
+            uint32_t pktid = (ident + static_cast<uint32_t>(n)) & 0xffff;
+            packet_equation eq = encode_packet(apa, pktid, fl.switch_ids);
+            fl.eqs.push_back(lazy_equation{pktid, static_cast<uint16_t>(num_hops), eq.pint});
+        }
+    }
+
+    size_t upfront_ok = 0, upfront_wrong = 0;
+    std::vector<uint16_t> ids;
+    std::vector<packet_equation> eqs;
+    auto t0 = std::chrono::steady_clock::now();
+    for (const auto& fl : rack) {
+        eqs.clear();
+        for (const auto& eq : fl.eqs) {
+            eqs.push_back(packet_equation{eq.pktid, eq.pint, reconstruct_xor_set(apa, eq.num_hops, eq.pktid)});
+        }
+        if (!solve_switch_ids(eqs, num_hops, ids)) continue;
+        ++upfront_ok;
+        upfront_wrong += ids != fl.switch_ids;
+    }
+    double upfront_secs = seconds_since(t0);
+
+    auto run = [&](size_t capacity, const char* label) {
+        xor_set_cache cache(apa, capacity);
+        size_t ok = 0, wrong = 0, by_peeling = 0, received = 0, materialized = 0;
+        long peeled = 0;
+        auto t1 = std::chrono::steady_clock::now();
+        for (const auto& fl : rack) {
+            peeling_decoder dec(num_hops, cache);
+            for (const auto& eq : fl.eqs) dec.add(eq);
+            bool done = dec.decode(ids);
+            received     += dec.received();
+            materialized += dec.materialized();
+            peeled       += dec.peeled();
+            if (!done) continue;
+            ++ok;
+            by_peeling += !dec.eliminated();
+            wrong += ids != fl.switch_ids;
+        }
+        double secs = seconds_since(t1);
+        printf("[bench]   %-12s %8.3f s  %zu/%ld decoded (%zu wrong, %zu by peeling alone, "
+               "%.1f of %d hops peeled)\n",
+               label, secs, ok, flows, wrong, by_peeling,
+               static_cast<double>(peeled) / static_cast<double>(flows), num_hops);
+        printf("[bench]   %-12s %zu of %zu equations materialized, %zu never (%.1f%%); "
+               "%zu reconstructions, %zu cache hits -> %zu avoided (%.1f%%)\n",
+               "", materialized, received, received - materialized,
+               100.0 * static_cast<double>(received - materialized) / static_cast<double>(received),
+               cache.reconstructions(), cache.hits(), received - cache.reconstructions(),
+               100.0 * static_cast<double>(received - cache.reconstructions()) / static_cast<double>(received));
+        return wrong;
+    };
+
+    size_t total = rack.size() * static_cast<size_t>(packets);
+    printf("[bench] lazy: %ld flows x %ld packets, hops=%d\n", flows, packets, num_hops);
+    printf("[bench]   %-12s %8.3f s  %zu/%ld decoded (%zu wrong); %zu reconstructions\n", "up front",
+           upfront_secs, upfront_ok, flows, upfront_wrong, total);
+    size_t wrong = upfront_wrong;
+    wrong += run(0, "lazy");
+    wrong += run(cap, "lazy + LRU");
+    return wrong == 0 ? 0 : 1;
+}
+
+// -------------------------------------------------------------------
+// pivot: per flow, the equations up to the first full-rank prefix,
+// solved by solve_switch_ids() and by markowitz_solver in column and in
+// Markowitz order (--fill is the density at which it goes dense). Row
+// operations and back-substitution XORs are counted on the same batches.
+// -------------------------------------------------------------------
+
+static int bench_pivot(const bench_args& a) {
+    apa_t apa;
+    int num_hops = 0;
+    if (!load_bench_apa(a, apa, num_hops)) return 1;
+    long flows  = arg_int(a, "flows", 256);
+    long rounds = arg_int(a, "rounds", 3);
+    double fill = std::strtod(arg_str(a, "fill", "0.2").c_str(), nullptr);
+
+    struct batch {
+        std::vector<uint16_t> switch_ids;
+        std::vector<packet_equation> eqs;
+    };
+    std::mt19937 rng(0xC0FFEE);
+    std::vector<batch> corpus(static_cast<size_t>(flows));
+    size_t total = 0;
+    for (auto& b : corpus) {
+        b.switch_ids.resize(static_cast<size_t>(num_hops));
+        for (auto& id : b.switch_ids) id = static_cast<uint16_t>(rng());
+        online_decoder dec(num_hops);
+        while (!dec.solved()) {
+            b.eqs.push_back(encode_packet(apa, rng(), b.switch_ids));
+            dec.add_equation(b.eqs.back());
+        }
+        total += b.eqs.size();
+    }
+
+    // Best of `rounds`, the variants taking turns.
+    struct variant {
+        const char* label;
+        pivot_order order;
+        double fill;
+        bool baseline;
+    };
+    struct result {
+        double best = 1e30;
+        size_t wrong = 0;
+        elimination_stats sum;
+    };
+    const variant variants[] = {
+        {"solve_switch_ids", pivot_order::column, 0.0, true},
+        {"column order", pivot_order::column, 0.0, false},
+        {"markowitz", pivot_order::markowitz, fill, false},
+        {"markowitz, no dense", pivot_order::markowitz, 1.01, false},
+    };
+    result results[std::size(variants)];
+    std::vector<uint16_t> ids;
+    for (long round = 0; round < rounds; ++round) {
+        for (size_t i = 0; i < std::size(variants); ++i) {
+            const variant& v = variants[i];
+            markowitz_solver solver(num_hops, v.order, v.fill);
+            result res;
+            auto t0 = std::chrono::steady_clock::now();
+            for (const auto& b : corpus) {
+                bool ok = v.baseline ? solve_switch_ids(b.eqs, num_hops, ids) : solver.solve(b.eqs, ids);
+                res.wrong += !ok || ids != b.switch_ids;
+                if (v.baseline) continue;
+                const elimination_stats& st = solver.stats();
+                res.sum.row_xors      += st.row_xors;
+                res.sum.back_xors     += st.back_xors;
+                res.sum.sparse_pivots += st.sparse_pivots;
+                res.sum.dense_pivots  += st.dense_pivots;
+                res.sum.max_degree    += st.max_degree;
+            }
+            res.best = std::min(seconds_since(t0), results[i].best);
+            results[i] = res;
+        }
+    }
+
+    printf("[bench] pivot: %ld flows, hops=%d, %.1f equations per flow, fill=%.2f\n",
+           flows, num_hops, static_cast<double>(total) / static_cast<double>(flows), fill);
+    size_t wrong = 0;
+    double n = static_cast<double>(flows);
+    for (size_t i = 0; i < std::size(variants); ++i) {
+        const variant& v = variants[i];
+        const result& res = results[i];
+        wrong += res.wrong;
+        if (v.baseline) {
+            printf("[bench]   %-20s %8.3f ms/flow  (%zu wrong)\n", v.label, 1e3 * res.best / n, res.wrong);
+            continue;
+        }
+        printf("[bench]   %-20s %8.3f ms/flow  (%zu wrong)  row ops %7.1f  back XORs %7.1f  "
+               "pivots %5.1f sparse + %5.1f dense  max degree %5.1f\n",
+               v.label, 1e3 * res.best / n, res.wrong,
+               static_cast<double>(res.sum.row_xors) / n, static_cast<double>(res.sum.back_xors) / n,
+               res.sum.sparse_pivots / n, res.sum.dense_pivots / n, res.sum.max_degree / n);
+    }
+    return wrong == 0 ? 0 : 1;
+}
+
+// -------------------------------------------------------------------
+// partial: flows fed one random packet at a time into a
+// partial_path_decoder until the path is complete. Reports how many
+// equations it took until the ToR (hop 0), the first and last `ends`
+// hops, half of the hops and the whole path were known, and the cost
+// per equation against online_decoder on the same packets.
+// -------------------------------------------------------------------
+
+static int bench_partial(const bench_args& a) {
+    apa_t apa;
+    int num_hops = 0;
+    if (!load_bench_apa(a, apa, num_hops)) return 1;
+    long flows = arg_int(a, "flows", 256);
+    int ends   = static_cast<int>(arg_int(a, "ends", 3));
+    if (ends > num_hops) ends = num_hops;
+
+    std::mt19937 rng(0xC0FFEE);
+    std::vector<std::vector<packet_equation>> corpus(static_cast<size_t>(flows));
+    std::vector<std::vector<uint16_t>> paths(static_cast<size_t>(flows));
+    std::vector<uint16_t> ids;
+
+    // milestones, in equations
+    enum { TOR, FIRST, LAST, HALF, FULL, MILESTONES };
+    const char* names[MILESTONES] = {"hop 0", "first hops", "last hops", "half the hops", "full path"};
+    double sum[MILESTONES] = {};
+    size_t wrong = 0, incomplete = 0;
+    for (long f = 0; f < flows; ++f) {
+        auto& path = paths[static_cast<size_t>(f)];
+        path.resize(static_cast<size_t>(num_hops));
+        for (auto& id : path) id = static_cast<uint16_t>(rng());
+
+        partial_path_decoder dec(num_hops);
+        size_t at[MILESTONES] = {};
+        for (long n = 0; n < 64L * num_hops && !dec.solved(); ++n) {
+            packet_equation eq = encode_packet(apa, rng(), path);
+            corpus[static_cast<size_t>(f)].push_back(eq);
+            if (dec.add_equation(eq) == 0) continue;
+            size_t k = dec.equations();
+            if (!at[TOR] && dec.known(0)) at[TOR] = k;
+            if (!at[FIRST] && dec.known_prefix() >= ends) at[FIRST] = k;
+            if (!at[LAST] && dec.known_suffix() >= ends) at[LAST] = k;
+            if (!at[HALF] && 2 * dec.known_count() >= num_hops) at[HALF] = k;
+        }
+        at[FULL] = dec.equations();
+        if (!dec.solved()) { ++incomplete; continue; }
+        for (const resolved_hop& h : dec.resolved()) wrong += h.switch_id != path[static_cast<size_t>(h.hop)];
+        wrong += !dec.solve(ids) || ids != path;
+        for (int m = 0; m < MILESTONES; ++m) sum[m] += static_cast<double>(at[m]);
+    }
+
+    size_t total = 0;
+    for (const auto& eqs : corpus) total += eqs.size();
+    auto time_per_eq = [&](auto&& feed) {
+        double best = 1e30;
+        for (int round = 0; round < 3; ++round) {
+            auto t0 = std::chrono::steady_clock::now();
+            for (const auto& eqs : corpus) feed(eqs);
+            best = std::min(best, seconds_since(t0));
+        }
+        return 1e9 * best / static_cast<double>(total);
+    };
+    double online_ns = time_per_eq([&](const std::vector<packet_equation>& eqs) {
+        online_decoder dec(num_hops);
+        for (const auto& eq : eqs) dec.add_equation(eq);
+    });
+    auto stamp = std::chrono::steady_clock::now();
+    double partial_ns = time_per_eq([&](const std::vector<packet_equation>& eqs) {
+        partial_path_decoder dec(num_hops);
+        for (const auto& eq : eqs) dec.add_equation(eq, stamp);
+    });
+
+    double done = static_cast<double>(flows - static_cast<long>(incomplete));
+    printf("[bench] partial: %ld flows, hops=%d (%zu incomplete, %zu wrong)\n",
+           flows, num_hops, incomplete, wrong);
+    for (int m = 0; m < MILESTONES; ++m) {
+        printf("[bench]   %-14s known after %7.1f equations (%5.1f%% of full)\n",
+               m == FIRST || m == LAST ? (std::string(names[m]) + " " + std::to_string(ends)).c_str() : names[m],
+               sum[m] / done, 100.0 * sum[m] / sum[FULL]);
+    }
+    printf("[bench]   per equation: online_decoder %.1f ns, partial_path_decoder %.1f ns\n",
+           online_ns, partial_ns);
+    return wrong == 0 && incomplete == 0 ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    static const std::map<std::string, int (*)(const bench_args&)> modes = {
+        {"prefix", bench_prefix},
+        {"wide",   bench_wide},
+        {"monitor", bench_monitor},
+        {"dedup",   bench_dedup},
+        {"readiness", bench_readiness},
+        {"collector", bench_collector},
+        {"pathstore", bench_pathstore},
+        {"rcu",       bench_rcu},
+        {"reactor",   bench_reactor},
+        {"snapshot",  bench_snapshot},
+        {"sketch",    bench_sketch},
+        {"schedule",  bench_schedule},
+        {"transport", bench_transport},
+        {"codebook",  bench_codebook},
+        {"plan",      bench_plan},
+        {"crc",       bench_crc},
+        {"image",     bench_image},
+        {"lazy",      bench_lazy},
+        {"pivot",     bench_pivot},
+        {"partial",   bench_partial},
+    };
+
+    if (argc < 2 || modes.find(argv[1]) == modes.end()) {
+        std::cerr << "usage: " << argv[0] << " <mode> [--key value ...]\nmodes:";
+        for (const auto& m : modes) std::cerr << " " << m.first;
+        std::cerr << "\n";
+        return 1;
+    }
+
+    bench_args args;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        if (std::strncmp(argv[i], "--", 2) != 0) {
+            std::cerr << "[bench] Unexpected argument " << argv[i] << "\n";
+            return 1;
+        }
+        args[argv[i] + 2] = argv[i + 1];
+    }
+    return modes.at(argv[1])(args);
+}
@@ -0,0 +1,87 @@
+// src/epoch.cpp
+#include "epoch.hpp"
+
+#include <functional>
+#include <thread>
+
+// Readers pick a slot per critical section, starting from a per-thread
+// hint so that each thread normally reuses an uncontended slot.
+int epoch_domain::acquire_slot() {
+    static thread_local int hint =
+        static_cast<int>(std::hash<std::thread::id>()(std::this_thread::get_id()) %
+                         EPOCH_MAX_READERS);
+    for (;;) {
+        for (int i = 0; i < EPOCH_MAX_READERS; ++i) {
+            int s = (hint + i) % EPOCH_MAX_READERS;
+            bool expected = false;
+            if (!slots_[s].owned.load(std::memory_order_relaxed) &&
+                slots_[s].owned.compare_exchange_strong(expected, true,
+                                                        std::memory_order_acquire)) {
+                hint = s;
+                return s;
+            }
+        }
+        std::this_thread::yield();
+    }
+}
+
+void epoch_domain::release_slot(int slot) {
+    slots_[slot].owned.store(false, std::memory_order_release);
+}
+
+epoch_domain::guard::guard(epoch_domain& d) : dom_(d), slot_(d.acquire_slot()) {
+    // Announce, then make sure the announcement is visible before any
+    // shared pointer is loaded (pairs with the fence in reclaim()).
+    dom_.slots_[slot_].epoch.store(dom_.global_.load(std::memory_order_acquire),
+                                   std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+epoch_domain::guard::~guard() {
+    dom_.slots_[slot_].epoch.store(0, std::memory_order_release);
+    dom_.release_slot(slot_);
+}
+
+epoch_domain::~epoch_domain() {
+    std::lock_guard<std::mutex> lock(retire_mu_);
+    for (auto& r : retired_) r.second();
+    retired_.clear();
+}
+
+void epoch_domain::retire(std::function<void()> deleter) {
+    // Readers that announce an epoch greater than `e` started after the
+    // old version became unreachable.
+    uint64_t e = global_.fetch_add(1, std::memory_order_acq_rel);
+    std::lock_guard<std::mutex> lock(retire_mu_);
+    retired_.emplace_back(e, std::move(deleter));
+}
+
+size_t epoch_domain::reclaim() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    uint64_t min_active = UINT64_MAX;
+    for (const auto& s : slots_) {
+        uint64_t e = s.epoch.load(std::memory_order_acquire);
+        if (e != 0 && e < min_active) min_active = e;
+    }
+
+    std::vector<std::function<void()>> ready;
+    {
+        std::lock_guard<std::mutex> lock(retire_mu_);
+        size_t keep = 0;
+        for (auto& r : retired_) {
+            if (r.first < min_active) {
+                ready.push_back(std::move(r.second));
+            } else {
+                retired_[keep++] = std::move(r);
+            }
+        }
+        retired_.resize(keep);
+    }
+    for (auto& f : ready) f();
+    return ready.size();
+}
+
+size_t epoch_domain::pending() const {
+    std::lock_guard<std::mutex> lock(retire_mu_);
+    return retired_.size();
+}
@@ -0,0 +1,95 @@
+// src/equation_dedup.cpp
+#include "equation_dedup.hpp"
+
+constexpr size_t DEDUP_INITIAL_SLOTS = 64;
+
+dedup_result equation_dedup::check(const packet_equation& eq) {
+    // keep the load factor at or below 1/2
+    if (2 * (entries_.size() + 1) > fps_.size()) grow();
+
+    uint64_t fp   = eq.xor_set.fingerprint() | 1;  // never 0 (empty)
+    size_t   mask = fps_.size() - 1;
+    for (size_t slot = fp & mask;; slot = (slot + 1) & mask) {
+        if (fps_[slot] == 0) {
+            fps_[slot]        = fp;
+            slot_entry_[slot] = static_cast<uint32_t>(entries_.size());
+            entries_.push_back(entry{eq.xor_set, eq.pint});
+            return dedup_result::fresh;
+        }
+        if (fps_[slot] != fp) continue;
+
+        const entry& prev = entries_[slot_entry_[slot]];
+        if (prev.xor_set != eq.xor_set) continue;  // fingerprint collision
+        if (prev.pint != eq.pint) {
+            ++conflicts_;
+            return dedup_result::conflict;
+        }
+        ++duplicates_;
+        return dedup_result::duplicate;
+    }
+}
+
+void equation_dedup::grow() {
+    size_t n = fps_.empty() ? DEDUP_INITIAL_SLOTS : 2 * fps_.size();
+    fps_.assign(n, 0);
+    slot_entry_.assign(n, 0);
+
+    size_t mask = n - 1;
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        uint64_t fp = entries_[i].xor_set.fingerprint() | 1;
+        size_t slot = fp & mask;
+        while (fps_[slot] != 0) slot = (slot + 1) & mask;
+        fps_[slot]        = fp;
+        slot_entry_[slot] = static_cast<uint32_t>(i);
+    }
+}
+
+void equation_dedup::clear() {
+    fps_.clear();
+    slot_entry_.clear();
+    entries_.clear();
+    duplicates_ = 0;
+    conflicts_  = 0;
+}
+
+void equation_dedup::save(std::vector<uint8_t>& out) const {
+    uint64_t head[4] = {fps_.size(), entries_.size(), duplicates_, conflicts_};
+    snapshot_put(out, head, 4);
+    snapshot_put(out, fps_.data(), fps_.size());
+    snapshot_put(out, slot_entry_.data(), slot_entry_.size());
+    // field by field: entry has tail padding that must not reach the file
+    for (const entry& e : entries_) snapshot_put(out, e.xor_set.w, HOP_MASK_WORDS);
+    for (const entry& e : entries_) snapshot_put(out, &e.pint, 1);
+}
+
+bool equation_dedup::load(snapshot_cursor& in) {
+    uint64_t head[4];
+    if (!in.get(head, 4)) return false;
+    // Slots are a power of two (or 0) and hold every entry at load <= 1/2
+    if ((head[0] & (head[0] - 1)) != 0 || 2 * head[1] > head[0]) return false;
+
+    fps_.resize(head[0]);
+    slot_entry_.resize(head[0]);
+    entries_.resize(head[1]);
+    if (!in.get(fps_.data(), fps_.size()) ||
+        !in.get(slot_entry_.data(), slot_entry_.size())) {
+        clear();
+        return false;
+    }
+    bool ok = true;
+    for (entry& e : entries_) ok = ok && in.get(e.xor_set.w, HOP_MASK_WORDS);
+    for (entry& e : entries_) ok = ok && in.get(&e.pint, 1);
+    if (!ok) {
+        clear();
+        return false;
+    }
+    for (size_t i = 0; i < fps_.size(); ++i) {
+        if (fps_[i] != 0 && slot_entry_[i] >= entries_.size()) {
+            clear();
+            return false;
+        }
+    }
+    duplicates_ = head[2];
+    conflicts_  = head[3];
+    return true;
+}
@@ -0,0 +1,182 @@
+// src/heavy_hitters.cpp
+#include "heavy_hitters.hpp"
+
+#include <algorithm>
+
+static uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ull;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBull;
+    x ^= x >> 31;
+    return x;
+}
+
+// -------------------------------------------------------------------
+// count_min
+// -------------------------------------------------------------------
+
+count_min::count_min(int depth, int width)
+    : depth_(depth < 1 ? 1 : depth) {
+    uint64_t w = 1;
+    while (w < static_cast<uint64_t>(width)) w <<= 1;
+    mask_ = w - 1;
+    cells_.assign(static_cast<size_t>(depth_) * w, 0);
+}
+
+uint64_t count_min::add(uint64_t key, uint64_t n) {
+    uint64_t h  = mix64(key);
+    uint64_t h1 = h, h2 = (h >> 32) | 1;   // odd step: distinct columns
+    uint64_t est = UINT64_MAX;
+    for (int r = 0; r < depth_; ++r) {
+        uint64_t& c = cells_[r * (mask_ + 1) + ((h1 + r * h2) & mask_)];
+        c += n;
+        est = std::min(est, c);
+    }
+    total_ += n;
+    return est;
+}
+
+uint64_t count_min::estimate(uint64_t key) const {
+    uint64_t h  = mix64(key);
+    uint64_t h1 = h, h2 = (h >> 32) | 1;
+    uint64_t est = UINT64_MAX;
+    for (int r = 0; r < depth_; ++r) {
+        est = std::min(est, cells_[r * (mask_ + 1) + ((h1 + r * h2) & mask_)]);
+    }
+    return est;
+}
+
+bool count_min::merge(const count_min& o) {
+    if (o.depth_ != depth_ || o.mask_ != mask_) return false;
+    for (size_t i = 0; i < cells_.size(); ++i) cells_[i] += o.cells_[i];
+    total_ += o.total_;
+    return true;
+}
+
+void count_min::save(std::vector<uint8_t>& out) const {
+    uint64_t head[3] = {static_cast<uint64_t>(depth_), mask_ + 1, total_};
+    snapshot_put(out, head, 3);
+    snapshot_put(out, cells_.data(), cells_.size());
+}
+
+bool count_min::load(snapshot_cursor& in) {
+    uint64_t head[3];
+    if (!in.get(head, 3)) return false;
+    if (head[0] != static_cast<uint64_t>(depth_) || head[1] != mask_ + 1) return false;
+    total_ = head[2];
+    return in.get(cells_.data(), cells_.size());
+}
+
+// -------------------------------------------------------------------
+// heavy_hitters
+// -------------------------------------------------------------------
+
+heavy_hitters::heavy_hitters(size_t k, int depth, int width)
+    : k_(k), cm_(depth, width) {
+    heap_.reserve(k_);
+}
+
+void heavy_hitters::add(uint64_t key, uint64_t n) {
+    offer(key, cm_.add(key, n));
+}
+
+void heavy_hitters::offer(uint64_t key, uint64_t est) {
+    auto it = pos_.find(key);
+    if (it != pos_.end()) {
+        size_t i = it->second;
+        if (est <= heap_[i].count) return;
+        heap_[i].count = est;   // only grows: move away from the root
+        sift_down(i);
+        return;
+    }
+    if (heap_.size() < k_) {
+        heap_.push_back(entry{key, est});
+        pos_[key] = heap_.size() - 1;
+        sift_up(heap_.size() - 1);
+        return;
+    }
+    if (k_ == 0 || est <= heap_[0].count) return;
+    pos_.erase(heap_[0].key);
+    place(0, entry{key, est});
+    sift_down(0);
+}
+
+void heavy_hitters::place(size_t i, const entry& e) {
+    heap_[i] = e;
+    pos_[e.key] = i;
+}
+
+void heavy_hitters::sift_up(size_t i) {
+    entry e = heap_[i];
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (heap_[parent].count <= e.count) break;
+        place(i, heap_[parent]);
+        i = parent;
+    }
+    place(i, e);
+}
+
+void heavy_hitters::sift_down(size_t i) {
+    entry e = heap_[i];
+    size_t n = heap_.size();
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= n) break;
+        if (child + 1 < n && heap_[child + 1].count < heap_[child].count) ++child;
+        if (e.count <= heap_[child].count) break;
+        place(i, heap_[child]);
+        i = child;
+    }
+    place(i, e);
+}
+
+std::vector<std::pair<uint64_t, uint64_t>> heavy_hitters::top() const {
+    std::vector<std::pair<uint64_t, uint64_t>> out;
+    out.reserve(heap_.size());
+    for (const auto& e : heap_) out.emplace_back(e.key, e.count);
+    std::sort(out.begin(), out.end(), [](const auto& a, const auto& b) {
+        return a.second != b.second ? a.second > b.second : a.first < b.first;
+    });
+    return out;
+}
+
+bool heavy_hitters::merge(const heavy_hitters& o) {
+    if (!cm_.merge(o.cm_)) return false;
+
+    std::vector<uint64_t> keys;
+    keys.reserve(heap_.size() + o.heap_.size());
+    for (const auto& e : heap_) keys.push_back(e.key);
+    for (const auto& e : o.heap_) keys.push_back(e.key);
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    heap_.clear();
+    pos_.clear();
+    for (uint64_t key : keys) offer(key, cm_.estimate(key));
+    return true;
+}
+
+size_t heavy_hitters::memory_bytes() const {
+    return cm_.memory_bytes() + heap_.capacity() * sizeof(entry) +
+           pos_.size() * (sizeof(uint64_t) + sizeof(size_t) + 2 * sizeof(void*));
+}
+
+void heavy_hitters::save(std::vector<uint8_t>& out) const {
+    uint64_t n = heap_.size();
+    cm_.save(out);
+    snapshot_put(out, &n);
+    snapshot_put(out, heap_.data(), heap_.size());
+}
+
+bool heavy_hitters::load(snapshot_cursor& in) {
+    uint64_t n;
+    if (!cm_.load(in) || !in.get(&n) || n > k_) return false;
+    std::vector<entry> entries(n);
+    if (!in.get(entries.data(), entries.size())) return false;
+    heap_.clear();
+    pos_.clear();
+    for (const auto& e : entries) offer(e.key, e.count);
+    return true;
+}
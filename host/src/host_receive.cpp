@@ -1,6 +1,9 @@
 // src/host_receive.cpp
 #include "packet_format.hpp"
+#include "reactor.hpp"
+#include "snapshot.hpp"
 #include "socket_utils.hpp"
+#include "spsc_queue.hpp"
 
 #ifndef __linux__
 #error "host_receive.cpp can only be built/run on Linux (AF_PACKET)."
@@ -9,22 +12,37 @@
 #include <arpa/inet.h>
 #include <net/ethernet.h>
 #include <linux/if_packet.h>
+#include <poll.h>
+#include <pthread.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
 #include <cstdint>
+#include <cstdlib>
 #include <cstring>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
-#include <set>
 
 // Experiment parameters
 constexpr int NUM_PACKETS = 500;
 constexpr int MAX_ITER    = 64;
 
+// Progress is snapshotted so a restarted run resumes where it stopped
+constexpr const char* SNAPSHOT_PATH = "output/host_receive.snap";
+constexpr const char* LOG_PATH      = "output/host_global_log.csv";
+constexpr int SNAPSHOT_EVERY_S      = 5;
+constexpr int HOPID_SLOTS           = 256;   // hopid = 255 - ttl
+
 static void ensure_output_directory() {
     struct stat st{};
     if (stat("output", &st) == -1) {
@@ -37,141 +55,709 @@ static void ensure_output_directory() {
 }
 
 // Helper: check if all packets are done
-static bool all_done(const std::vector<bool>& done) {
+static bool all_done(const std::vector<uint8_t>& done) {
     for (int i = 1; i <= NUM_PACKETS; ++i) {
         if (!done[i]) return false;
     }
     return true;
 }
 
-int main() {
-    ensure_output_directory();
-    // Change this to the NIC connected to Tofino
-    std::string ifname = "veth1";
+// (pktid, hopid) pairs already logged, one bit each
+struct seen_bitmap {
+    std::vector<uint64_t> words =
+        std::vector<uint64_t>(((NUM_PACKETS + 1) * HOPID_SLOTS + 63) / 64, 0);
 
-    uint8_t host_mac[6]   = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55};
-    uint8_t tofino_mac[6] = {0x00, 0xaa, 0xbb, 0xcc, 0xdd, 0xee};
+    bool test_and_set(int pktid, int hopid) {
+        size_t bit = static_cast<size_t>(pktid) * HOPID_SLOTS + hopid;
+        uint64_t m = 1ull << (bit % 64);
+        bool was   = words[bit / 64] & m;
+        words[bit / 64] |= m;
+        return was;
+    }
+};
+
+// The log must be flushed first: its length is saved with the progress,
+// and a resumed run cuts off whatever was logged after it
+static bool save_progress(const std::vector<uint8_t>& done, const seen_bitmap& seen,
+                          uint64_t generation) {
+    struct stat st{};
+    if (stat(LOG_PATH, &st) < 0) {
+        perror("[host] stat log");
+        return false;
+    }
+    snapshot_writer snap;
+    std::vector<uint8_t>& out = snap.section(SNAP_RECEIVER);
+    uint32_t shape[2] = {NUM_PACKETS, HOPID_SLOTS};
+    uint64_t log_bytes = static_cast<uint64_t>(st.st_size);
+    snapshot_put(out, shape, 2);
+    snapshot_put(out, &log_bytes);
+    snapshot_put(out, done.data(), done.size());
+    snapshot_put(out, seen.words.data(), seen.words.size());
+    return snap.commit(SNAPSHOT_PATH, generation);
+}
+
+static bool restore_progress(std::vector<uint8_t>& done, seen_bitmap& seen,
+                             uint64_t& generation, uint64_t& log_bytes) {
+    snapshot_reader snap;
+    if (!snap.open(SNAPSHOT_PATH)) return false;
+
+    snapshot_cursor in;
+    uint32_t shape[2];
+    if (!snap.find(SNAP_RECEIVER, in) || !in.get(shape, 2) ||
+        shape[0] != NUM_PACKETS || shape[1] != HOPID_SLOTS || !in.get(&log_bytes) ||
+        !in.get(done.data(), done.size()) ||
+        !in.get(seen.words.data(), seen.words.size())) {
+        std::cerr << "[host] " << SNAPSHOT_PATH << " is from another experiment, ignoring\n";
+        done.assign(done.size(), 0);
+        seen = seen_bitmap{};
+        return false;
+    }
+    generation = snap.generation();
+    return true;
+}
+
+// -------------------------------------------------------------------
+// Staged pipeline (--parse N): an RX thread, parse/dedup workers and
+// respond workers (log + echo), connected by SPSC queues of frame
+// descriptors. Frames stay in one pool; only slot indices move, and
+// every slot comes back to RX once its frame is handled.
+//
+// RX shards frames by pktid, so a pktid's seen bits belong to one parse
+// worker and its done flag to one respond worker; no locks on either.
+// For a snapshot RX stops receiving until every slot is back, which
+// also orders all worker writes before the save.
+// -------------------------------------------------------------------
+
+constexpr size_t FRAME_SLOT  = 2048;
+constexpr size_t POOL_FRAMES = 4096;
+constexpr size_t STAGE_QUEUE = 1024;
+constexpr size_t STAGE_BATCH = 32;
+
+struct pipeline_config {
+    int parse_workers   = 0;   // 0: single inline loop
+    int respond_workers = 1;
+    int pin_rx          = -1;  // CPU, -1: unpinned
+    std::vector<int> pin_parse, pin_respond;
+};
+
+struct frame_desc {
+    uint32_t slot;
+    uint16_t len;
+    uint16_t pktid;
+    uint16_t pint;
+    uint8_t  ttl;
+    uint8_t  xor_deg;
+    bool     first;    // (pktid, hopid) not logged before
+};
+
+static bool pin_to_cpu(pthread_t t, int cpu) {
+    if (cpu < 0) return true;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    int err = pthread_setaffinity_np(t, sizeof(set), &set);
+    if (err != 0) {
+        std::cerr << "[host] Cannot pin to CPU " << cpu << ": " << std::strerror(err) << "\n";
+        return false;
+    }
+    return true;
+}
+
+// Yield first, then sleep, so idle workers do not hold a core
+static void idle_wait(int& spins) {
+    if (++spins < 64) std::this_thread::yield();
+    else std::this_thread::sleep_for(std::chrono::microseconds(50));
+}
+
+class receive_pipeline {
+public:
+    receive_pipeline(const pipeline_config& cfg, int sockfd, int ifindex,
+                     const uint8_t host_mac[6], const uint8_t tofino_mac[6],
+                     std::vector<uint8_t>& done, seen_bitmap& seen,
+                     std::ofstream& log, uint64_t& generation)
+        : cfg_(cfg), sockfd_(sockfd), ifindex_(ifindex), done_(done), seen_(seen),
+          log_(log), generation_(generation), pool_(POOL_FRAMES * FRAME_SLOT) {
+        std::memcpy(host_mac_, host_mac, 6);
+        std::memcpy(tofino_mac_, tofino_mac, 6);
+        int left = 0;
+        for (int i = 1; i <= NUM_PACKETS; ++i) left += !done_[i];
+        left_ = left;
+
+        int P = cfg_.parse_workers, R = cfg_.respond_workers;
+        for (int p = 0; p < P; ++p) {
+            to_parse_.push_back(std::make_unique<spsc_queue<frame_desc>>(STAGE_QUEUE));
+            parse_free_.push_back(std::make_unique<spsc_queue<uint32_t>>(POOL_FRAMES));
+            for (int r = 0; r < R; ++r) {
+                to_respond_.push_back(std::make_unique<spsc_queue<frame_desc>>(STAGE_QUEUE));
+            }
+        }
+        for (int r = 0; r < R; ++r) {
+            respond_free_.push_back(std::make_unique<spsc_queue<uint32_t>>(POOL_FRAMES));
+        }
+        for (uint32_t s = 0; s < POOL_FRAMES; ++s) free_.push_back(s);
+    }
+
+    // Runs RX on the calling thread until every packet is done.
+    void run() {
+        std::vector<std::thread> threads;
+        for (int p = 0; p < cfg_.parse_workers; ++p) {
+            threads.emplace_back([this, p] { parse_loop(p); });
+            if (p < static_cast<int>(cfg_.pin_parse.size())) {
+                pin_to_cpu(threads.back().native_handle(), cfg_.pin_parse[p]);
+            }
+        }
+        for (int r = 0; r < cfg_.respond_workers; ++r) {
+            threads.emplace_back([this, r] { respond_loop(r); });
+            if (r < static_cast<int>(cfg_.pin_respond.size())) {
+                pin_to_cpu(threads.back().native_handle(), cfg_.pin_respond[r]);
+            }
+        }
+        pin_to_cpu(pthread_self(), cfg_.pin_rx);
+
+        rx_loop();
+        quiesce();
+        stop_ = true;
+        for (auto& t : threads) t.join();
+    }
+
+private:
+    uint8_t* frame(uint32_t slot) { return pool_.data() + slot * FRAME_SLOT; }
+    spsc_queue<frame_desc>& to_respond(int p, int r) {
+        return *to_respond_[p * cfg_.respond_workers + r];
+    }
+
+    // Blocks (backpressure) until the downstream stage took every item
+    template <typename T>
+    static void push_all(spsc_queue<T>& q, std::vector<T>& items) {
+        size_t off = 0;
+        for (int spins = 0; off < items.size(); idle_wait(spins)) {
+            off += q.push(items.data() + off, items.size() - off);
+        }
+        items.clear();
+    }
+
+    void reclaim() {
+        uint32_t slots[STAGE_BATCH];
+        auto drain = [&](spsc_queue<uint32_t>& q) {
+            for (size_t n; (n = q.pop(slots, STAGE_BATCH)) > 0;) {
+                free_.insert(free_.end(), slots, slots + n);
+            }
+        };
+        for (auto& q : parse_free_) drain(*q);
+        for (auto& q : respond_free_) drain(*q);
+    }
+
+    void quiesce() {
+        for (int spins = 0; free_.size() < POOL_FRAMES; idle_wait(spins)) reclaim();
+    }
+
+    void rx_loop() {
+        int P = cfg_.parse_workers;
+        std::vector<std::vector<frame_desc>> batch(static_cast<size_t>(P));
+        auto last_snapshot = std::chrono::steady_clock::now();
+        auto last_report   = last_snapshot;
+        uint64_t frames = 0, reported = 0;
+        struct pollfd pfd{sockfd_, POLLIN, 0};
+
+        while (left_.load(std::memory_order_acquire) > 0) {
+            reclaim();
+
+            auto now = std::chrono::steady_clock::now();
+            if (now - last_snapshot >= std::chrono::seconds(SNAPSHOT_EVERY_S)) {
+                quiesce();
+                {
+                    std::lock_guard<std::mutex> lock(log_mu_);
+                    log_.flush();
+                }
+                save_progress(done_, seen_, ++generation_);
+                last_snapshot = now;
+            }
+            if (now - last_report >= std::chrono::seconds(1)) {
+                report(frames - reported,
+                       std::chrono::duration<double>(now - last_report).count());
+                reported    = frames;
+                last_report = now;
+            }
+
+            if (free_.empty()) {
+                std::this_thread::yield();
+                continue;
+            }
+            // Wake up regularly to notice the last packet being done
+            if (poll(&pfd, 1, 100) <= 0) continue;
+
+            for (size_t k = 0; k < STAGE_BATCH && !free_.empty(); ++k) {
+                uint32_t slot = free_.back();
+                ssize_t n = recv(sockfd_, frame(slot), FRAME_SLOT, MSG_DONTWAIT);
+                if (n <= 0) {
+                    if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                        perror("[host] recv failed");
+                    }
+                    break;
+                }
+                free_.pop_back();
+                ++frames;
+
+                frame_desc d{};
+                d.slot = slot;
+                d.len  = static_cast<uint16_t>(n);
+                // Peek at the pktid only to pick the parse worker
+                uint16_t id = 0;
+                if (static_cast<size_t>(n) >= sizeof(ethernet_h) + sizeof(ipv4_h)) {
+                    auto* ip = reinterpret_cast<const ipv4_h*>(frame(slot) + sizeof(ethernet_h));
+                    id = ntohs(ip->identification);
+                }
+                batch[id % P].push_back(d);
+            }
+            for (int p = 0; p < P; ++p) push_all(*to_parse_[p], batch[p]);
+        }
+    }
+
+    void parse_loop(int p) {
+        int R = cfg_.respond_workers;
+        frame_desc in[STAGE_BATCH];
+        std::vector<std::vector<frame_desc>> out(static_cast<size_t>(R));
+        std::vector<uint32_t> drop;
+
+        for (int spins = 0;;) {
+            size_t n = to_parse_[p]->pop(in, STAGE_BATCH);
+            if (n == 0) {
+                if (stop_) break;
+                idle_wait(spins);
+                continue;
+            }
+            spins = 0;
+
+            for (size_t k = 0; k < n; ++k) {
+                frame_desc d = in[k];
+                const uint8_t* buf = frame(d.slot);
+                if (d.len < sizeof(ethernet_h) + sizeof(ipv4_h) + sizeof(recipe_h)) {
+                    drop.push_back(d.slot);
+                    continue;
+                }
+                auto* eth = reinterpret_cast<const ethernet_h*>(buf);
+                auto* ip  = reinterpret_cast<const ipv4_h*>(buf + sizeof(ethernet_h));
+                auto* rec = reinterpret_cast<const recipe_h*>(
+                    buf + sizeof(ethernet_h) + sizeof(ipv4_h));
+                d.pktid = ntohs(ip->identification);
+                if (ntohs(eth->ether_type) != 0x0800 || ip->protocol != 146 ||
+                    d.pktid == 0 || d.pktid > NUM_PACKETS) {
+                    drop.push_back(d.slot);
+                    continue;
+                }
+                d.ttl     = ip->ttl;
+                d.pint    = ntohs(rec->pint);
+                d.xor_deg = rec->xor_degree;
+                d.first   = !seen_.test_and_set(d.pktid, 255 - d.ttl);
+                out[d.pktid % R].push_back(d);
+            }
+            for (int r = 0; r < R; ++r) push_all(to_respond(p, r), out[r]);
+            push_all(*parse_free_[p], drop);
+        }
+    }
+
+    void respond_loop(int r) {
+        int P = cfg_.parse_workers;
+        frame_desc in[STAGE_BATCH];
+        std::vector<uint32_t> back;
+        std::string lines;
+
+        struct sockaddr_ll addr{};
+        addr.sll_family  = AF_PACKET;
+        addr.sll_ifindex = ifindex_;
+        addr.sll_halen   = ETH_ALEN;
+        std::memcpy(addr.sll_addr, tofino_mac_, 6);
+
+        for (int spins = 0;;) {
+            size_t got = 0;
+            for (int p = 0; p < P; ++p) {
+                size_t n = to_respond(p, r).pop(in, STAGE_BATCH);
+                got += n;
+                for (size_t k = 0; k < n; ++k) {
+                    const frame_desc& d = in[k];
+                    int hopid = 255 - d.ttl;
+                    if (d.first) {
+                        lines += std::to_string(d.pktid) + "," + std::to_string(hopid) + "," +
+                                 std::to_string(d.ttl) + "," + std::to_string(d.pint) + "," +
+                                 std::to_string(d.xor_deg) + "\n";
+                    }
+                    back.push_back(d.slot);
+
+                    // Stop echoing this pktid once TTL is 0 or hopid >= MAX_ITER
+                    if (d.ttl == 0 || hopid >= MAX_ITER) {
+                        if (!done_[d.pktid]) {
+                            done_[d.pktid] = 1;
+                            left_.fetch_sub(1, std::memory_order_release);
+                        }
+                        continue;
+                    }
+                    auto* eth = reinterpret_cast<ethernet_h*>(frame(d.slot));
+                    std::memcpy(eth->dst, tofino_mac_, 6);
+                    std::memcpy(eth->src, host_mac_, 6);
+                    if (sendto(sockfd_, eth, d.len, 0,
+                               reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+                        perror("[host] sendto failed");
+                    }
+                }
+            }
+            if (got == 0) {
+                if (stop_) break;
+                idle_wait(spins);
+                continue;
+            }
+            spins = 0;
+
+            if (!lines.empty()) {
+                std::lock_guard<std::mutex> lock(log_mu_);
+                log_ << lines;
+                lines.clear();
+            }
+            push_all(*respond_free_[r], back);
+        }
+    }
+
+    // Queue depths summed per stage, high-water marks since the last report
+    void report(uint64_t frames, double secs) {
+        auto depth = [](auto& queues, size_t& high) {
+            size_t sum = 0;
+            high = 0;
+            for (auto& q : queues) {
+                sum += q->size();
+                high = std::max(high, q->take_high_water());
+            }
+            return sum;
+        };
+        size_t parse_max, respond_max, free_max;
+        size_t parse_q   = depth(to_parse_, parse_max);
+        size_t respond_q = depth(to_respond_, respond_max);
+        size_t free_q    = depth(respond_free_, free_max) + depth(parse_free_, free_max);
+        printf("[host] pipeline: %.0f frames/s, %d left | parse q %zu (max %zu) | "
+               "respond q %zu (max %zu) | returning %zu | %zu/%zu frames in flight\n",
+               static_cast<double>(frames) / secs, left_.load(), parse_q, parse_max,
+               respond_q, respond_max, free_q, POOL_FRAMES - free_.size(), POOL_FRAMES);
+    }
+
+    pipeline_config cfg_;
+    int sockfd_;
+    int ifindex_;
+    uint8_t host_mac_[6];
+    uint8_t tofino_mac_[6];
+    std::vector<uint8_t>& done_;   // [pktid], written by respond worker pktid % R
+    seen_bitmap& seen_;            // bits of pktid owned by parse worker pktid % P
+    std::ofstream& log_;
+    std::mutex log_mu_;
+    uint64_t& generation_;
+
+    std::vector<uint8_t> pool_;
+    std::vector<uint32_t> free_;   // RX only
+    std::vector<std::unique_ptr<spsc_queue<frame_desc>>> to_parse_;     // [p]
+    std::vector<std::unique_ptr<spsc_queue<frame_desc>>> to_respond_;   // [p * R + r]
+    std::vector<std::unique_ptr<spsc_queue<uint32_t>>> parse_free_;     // [p]
+    std::vector<std::unique_ptr<spsc_queue<uint32_t>>> respond_free_;   // [r]
+    std::atomic<int> left_{0};
+    std::atomic<bool> stop_{false};
+};
 
+static bool parse_cpu_list(const char* v, std::vector<int>& out) {
+    out.clear();
+    for (const char* p = v; *p;) {
+        char* end;
+        long cpu = std::strtol(p, &end, 10);
+        if (end == p || cpu < 0) return false;
+        out.push_back(static_cast<int>(cpu));
+        p = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',') return false;
+    }
+    return !out.empty();
+}
+
+// -------------------------------------------------------------------
+// Single-threaded receive/respond loop on the reactor: one coroutine per
+// interface, plus a timer coroutine for snapshots
+// -------------------------------------------------------------------
+
+struct nic {
+    std::string name;
+    int sockfd  = -1;
     int ifindex = 0;
-    int sockfd  = open_raw_socket(ifname, ifindex);
-    if (sockfd < 0) {
-        std::cerr << "Failed to open raw socket on " << ifname << "\n";
-        return 1;
+};
+
+static bool open_nic(nic& n) {
+    n.sockfd = open_raw_socket(n.name, n.ifindex);
+    if (n.sockfd < 0) {
+        std::cerr << "Failed to open raw socket on " << n.name << "\n";
+        return false;
     }
 
-    std::cout << "[host] Using interface " << ifname
-              << " (ifindex=" << ifindex << ")\n";
+    std::cout << "[host] Using interface " << n.name
+              << " (ifindex=" << n.ifindex << ")\n";
 
     // Increase socket buffer sizes aggressively to handle burst traffic
     long int rcvbuf = (long int) 128 * 1024 * 1024;  // 128 MB
     long int sndbuf = (long int) 128 * 1024 * 1024;  // 128 MB
-    if (setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf)) < 0) {
+    if (setsockopt(n.sockfd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf)) < 0) {
         perror("setsockopt SO_RCVBUF");
     } else {
         std::cout << "[host] Set SO_RCVBUF to " << rcvbuf << " bytes\n";
     }
-    if (setsockopt(sockfd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf)) < 0) {
+    if (setsockopt(n.sockfd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf)) < 0) {
         perror("setsockopt SO_SNDBUF");
     } else {
         std::cout << "[host] Set SO_SNDBUF to " << sndbuf << " bytes\n";
     }
+    return true;
+}
+
+struct receive_state {
+    uint8_t host_mac[6]   = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55};
+    uint8_t tofino_mac[6] = {0x00, 0xaa, 0xbb, 0xcc, 0xdd, 0xee};
+    std::vector<uint8_t> done = std::vector<uint8_t>(NUM_PACKETS + 1, 0);
+    seen_bitmap seen;
+    std::ofstream log;
+    uint64_t generation = 0;
+    bool verbose = false;   // a line per frame (--verbose 1)
+};
+
+// Logs a received frame and rewrites it in place into its echo; false
+// if it is not echoed (not a recipe frame, or its pktid is done)
+static bool handle_frame(receive_state& st, uint8_t* frame, size_t frame_size) {
+    if (frame_size < sizeof(ethernet_h) + sizeof(ipv4_h) + sizeof(recipe_h)) {
+        if (st.verbose) printf("[host] Received frame too small, ignoring\n");
+        return false;
+    }
 
-    std::vector<bool> done(NUM_PACKETS + 1, false);
-    std::set<std::pair<uint16_t, int>> seen_packets;
+    auto* rx_eth = reinterpret_cast<ethernet_h*>(frame);
+    if (ntohs(rx_eth->ether_type) != 0x0800) {
+        if (st.verbose) printf("[host] Received non-IPv4 frame, ignoring\n");
+        return false;
+    }
 
-    // global log file for all packets
-    std::ofstream global_log("output/host_global_log.csv");
-    global_log << "pktid,hopid,ttl,pint,xor\n";
+    auto* rx_ip = reinterpret_cast<ipv4_h*>(
+        frame + sizeof(ethernet_h));
+    if (rx_ip->protocol != 146) {
+        if (st.verbose) printf("[host] Received non-recipe IP packet, ignoring\n");
+        return false;
+    }
+
+    auto* rx_rec = reinterpret_cast<recipe_h*>(
+        frame + sizeof(ethernet_h) + sizeof(ipv4_h));
+
+    uint16_t rx_pktid = ntohs(rx_ip->identification);
+    if (rx_pktid == 0 || rx_pktid > NUM_PACKETS) {
+        return false;
+    }
 
-    // --------------------------
-    // Global receive/respond loop
-    // --------------------------
-    std::cout << "[host] Entering global receive/respond loop...\n";
+    uint8_t  ttl     = rx_ip->ttl;
+    int      hopid   = 255 - ttl;
+    uint16_t pint    = ntohs(rx_rec->pint);
+    uint8_t  xor_deg = rx_rec->xor_degree;
 
-    // Use a static buffer to avoid repeated allocations
-    static uint8_t rx_buffer[2048];
-    
-    while (!all_done(done)) {
-        printf("[host] Waiting to receive a frame...\n");
-        ssize_t n = recv(sockfd, rx_buffer, sizeof(rx_buffer), 0);
-        printf("[host] Received %zd bytes\n", n);
+    if (st.verbose) {
+        printf("[host] recv pktid=%u hopid=%d ttl=%u pint=%u xor=%u\n",
+               rx_pktid, hopid, ttl, pint, xor_deg);
+    }
+
+    // check if we've seen this (pktid, hopid) combination before
+    if (!st.seen.test_and_set(rx_pktid, hopid)) {
+        // first time seeing this combination, log it
+        st.log << rx_pktid << "," << hopid << ","
+               << static_cast<int>(ttl) << "," << pint << ","
+               << static_cast<int>(xor_deg) << "\n";
+    }
+
+    // Stop echoing this pktid once TTL is 0 or hopid >= MAX_ITER
+    if (ttl == 0 || hopid >= MAX_ITER) {
+        st.done[rx_pktid] = 1;
+        if (st.verbose) printf("[host] Marking pktid=%u as done\n", rx_pktid);
+        return false;
+    }
+
+    std::memcpy(rx_eth->dst, st.tofino_mac, 6);
+    std::memcpy(rx_eth->src, st.host_mac, 6);
+    return true;
+}
+
+static task receive_loop(reactor& r, receive_state& st, const nic& nc) {
+    // Frame buffer lives in the coroutine frame, one per interface
+    uint8_t rx_buffer[2048];
+
+    struct sockaddr_ll addr{};
+    addr.sll_family  = AF_PACKET;
+    addr.sll_ifindex = nc.ifindex;
+    addr.sll_halen   = ETH_ALEN;
+    std::memcpy(addr.sll_addr, st.tofino_mac, 6);
+
+    while (!all_done(st.done)) {
+        if (st.verbose) printf("[host] Waiting to receive a frame on %s...\n", nc.name.c_str());
+        ssize_t n = co_await async_recv(r, nc.sockfd, rx_buffer, sizeof(rx_buffer));
+        if (st.verbose) printf("[host] Received %zd bytes\n", n);
         if (n < 0) {
+            errno = static_cast<int>(-n);
             perror("[host] recv failed");
             continue;
         }
         if (n == 0) continue;
 
         size_t frame_size = static_cast<size_t>(n);
-        if (frame_size < sizeof(ethernet_h) + sizeof(ipv4_h) + sizeof(recipe_h)) {
-            printf("[host] Received frame too small, ignoring\n");
-            continue;
-        }
-
-        auto* rx_eth = reinterpret_cast<ethernet_h*>(rx_buffer);
-        if (ntohs(rx_eth->ether_type) != 0x0800) {
-            printf("[host] Received non-IPv4 frame, ignoring\n");
-            continue;
-        }
+        if (!handle_frame(st, rx_buffer, frame_size)) continue;
 
-        auto* rx_ip = reinterpret_cast<ipv4_h*>(
-            rx_buffer + sizeof(ethernet_h));
-        if (rx_ip->protocol != 146) {
-            printf("[host] Received non-recipe IP packet, ignoring\n");
-            continue;
+        if (st.verbose) printf("[host] Sending frame back to switch...\n");
+        ssize_t sent = co_await async_sendto(r, nc.sockfd, rx_buffer, frame_size,
+                                             reinterpret_cast<struct sockaddr*>(&addr),
+                                             sizeof(addr));
+        if (sent < 0) {
+            errno = static_cast<int>(-sent);
+            perror("[host] sendto failed");
         }
+    }
+    // Whichever interface sees the last packet done ends the run
+    r.stop();
+}
 
-        auto* rx_rec = reinterpret_cast<recipe_h*>(
-            rx_buffer + sizeof(ethernet_h) + sizeof(ipv4_h));
+// --transport: frames of one interface received and echoed in batches
+// through a frame_transport (see socket_utils.hpp), snapshots inline
+constexpr size_t TRANSPORT_BATCH = 32;
 
-        uint16_t rx_pktid = ntohs(rx_ip->identification);
-        if (rx_pktid == 0 || rx_pktid > NUM_PACKETS) {
-            continue;
+static bool transport_loop(receive_state& st, frame_transport& tr) {
+    std::vector<frame_view> rx, tx;
+    auto last_snapshot = std::chrono::steady_clock::now();
+    while (!all_done(st.done)) {
+        rx.clear();
+        tx.clear();
+        // Wake up regularly for snapshots
+        if (tr.recv_batch(rx, TRANSPORT_BATCH, 100) < 0) {
+            perror("[host] recv_batch failed");
+            return false;
+        }
+        for (const frame_view& f : rx) {
+            if (handle_frame(st, f.data, f.len)) tx.push_back(f);
+        }
+        if (!tx.empty()) {
+            int sent = tr.send_batch(tx);
+            if (sent < static_cast<int>(tx.size())) {
+                std::cerr << "[host] " << tr.name() << ": sent " << sent << " of "
+                          << tx.size() << " frames\n";
+            }
         }
 
-        uint8_t  ttl     = rx_ip->ttl;
-        int      hopid   = 255 - ttl;
-        uint16_t pint    = ntohs(rx_rec->pint);
-        uint8_t  xor_deg = rx_rec->xor_degree;
-
-        printf("[host] recv pktid=%u hopid=%d ttl=%u pint=%u xor=%u\n",
-               rx_pktid, hopid, ttl, pint, xor_deg);
-
-        // check if we've seen this (pktid, hopid) combination before
-        auto packet_key = std::make_pair(rx_pktid, hopid);
-        if (seen_packets.find(packet_key) == seen_packets.end()) {
-            // first time seeing this combination, log it
-            global_log << rx_pktid << "," << hopid << ","
-                       << static_cast<int>(ttl) << "," << pint << ","
-                       << static_cast<int>(xor_deg) << "\n";
-            seen_packets.insert(packet_key);
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_snapshot >= std::chrono::seconds(SNAPSHOT_EVERY_S)) {
+            st.log.flush();
+            save_progress(st.done, st.seen, ++st.generation);
+            last_snapshot = now;
         }
+    }
+    return true;
+}
 
-        // Stop echoing this pktid once TTL is 0 or hopid >= MAX_ITER
-        if (ttl == 0 || hopid >= MAX_ITER) {
-            done[rx_pktid] = true;
-            printf("[host] Marking pktid=%u as done\n", rx_pktid);
-            continue;
+static task snapshot_loop(reactor& r, receive_state& st) {
+    for (;;) {
+        co_await r.sleep_for(std::chrono::seconds(SNAPSHOT_EVERY_S));
+        st.log.flush();
+        save_progress(st.done, st.seen, ++st.generation);
+    }
+}
+
+int main(int argc, char** argv) {
+    // Change this to the NIC(s) connected to Tofino (--if, repeatable)
+    std::vector<nic> nics;
+    pipeline_config pcfg;
+    std::string transport;   // empty: reactor loop (or --parse pipeline)
+    bool verbose = false;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string k = argv[i];
+        const char* v = argv[i + 1];
+        bool ok = true;
+        if      (k == "--if")          nics.push_back(nic{v});
+        else if (k == "--parse")       pcfg.parse_workers   = std::atoi(v);
+        else if (k == "--respond")     pcfg.respond_workers = std::atoi(v);
+        else if (k == "--pin-rx")      pcfg.pin_rx          = std::atoi(v);
+        else if (k == "--pin-parse")   ok = parse_cpu_list(v, pcfg.pin_parse);
+        else if (k == "--pin-respond") ok = parse_cpu_list(v, pcfg.pin_respond);
+        else if (k == "--transport")   transport = v;
+        else if (k == "--verbose")     verbose = std::atoi(v) != 0;
+        else ok = false;
+        if (!ok) {
+            std::cerr << "[host] Bad option " << k << " " << v << "\n";
+            return 1;
         }
+    }
+    if (nics.empty()) nics.push_back(nic{"veth1"});
+    if (pcfg.parse_workers < 0 || pcfg.respond_workers < 1) {
+        std::cerr << "[host] --parse must be >= 0 and --respond >= 1\n";
+        return 1;
+    }
+    if (pcfg.parse_workers > 0 && nics.size() > 1) {
+        std::cerr << "[host] The --parse pipeline serves a single --if\n";
+        return 1;
+    }
+    if (!transport.empty() && (pcfg.parse_workers > 0 || nics.size() > 1)) {
+        std::cerr << "[host] --transport serves a single --if, without --parse\n";
+        return 1;
+    }
 
-        std::memcpy(rx_eth->dst, tofino_mac, 6);
-        std::memcpy(rx_eth->src, host_mac, 6);
+    ensure_output_directory();
+    for (auto& n : nics) {
+        if (!open_nic(n)) return 1;
+    }
 
-        struct sockaddr_ll addr{};
-        addr.sll_family  = AF_PACKET;
-        addr.sll_ifindex = ifindex;
-        addr.sll_halen   = ETH_ALEN;
-        std::memcpy(addr.sll_addr, tofino_mac, 6);
+    receive_state st;
+    st.verbose = verbose;
+    uint64_t log_bytes = 0;
+    bool resumed = restore_progress(st.done, st.seen, st.generation, log_bytes);
 
-        printf("[host] Sending frame back to switch...\n");
-        if (sendto(sockfd, rx_buffer, frame_size, 0,
-                   reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
-            perror("[host] sendto failed");
+    // global log file for all packets; a resumed run drops the lines
+    // logged after the snapshot (their packets are not in `seen`) and
+    // appends from there
+    if (resumed) {
+        struct stat ls{};
+        if (stat(LOG_PATH, &ls) < 0 || static_cast<uint64_t>(ls.st_size) < log_bytes ||
+            truncate(LOG_PATH, static_cast<off_t>(log_bytes)) < 0) {
+            std::cerr << "[host] " << LOG_PATH << " is shorter than the snapshot, starting over\n";
+            resumed = false;
+            st = receive_state{};
+            st.verbose = verbose;
         }
+    }
+    if (resumed) {
+        int left = 0;
+        for (int i = 1; i <= NUM_PACKETS; ++i) left += !st.done[i];
+        std::cout << "[host] Resumed from " << SNAPSHOT_PATH << ", " << left
+                  << " packets left\n";
+        st.log.open(LOG_PATH, std::ios::app);
+    } else {
+        st.log.open(LOG_PATH);
+        st.log << "pktid,hopid,ttl,pint,xor\n";
+    }
 
+    if (!transport.empty()) {
+        std::unique_ptr<frame_transport> tr =
+            make_transport(transport, nics[0].sockfd, nics[0].ifindex);
+        if (!tr) return 1;
+        std::cout << "[host] Entering " << tr->name() << " receive/respond loop...\n";
+        if (!transport_loop(st, *tr)) return 1;
+    } else if (pcfg.parse_workers > 0) {
+        std::cout << "[host] Pipeline: 1 rx, " << pcfg.parse_workers << " parse, "
+                  << pcfg.respond_workers << " respond threads\n";
+        receive_pipeline pipe(pcfg, nics[0].sockfd, nics[0].ifindex, st.host_mac,
+                              st.tofino_mac, st.done, st.seen, st.log, st.generation);
+        pipe.run();
+    } else if (!all_done(st.done)) {
+        // --------------------------
+        // Global receive/respond loop, all interfaces on this thread
+        // --------------------------
+        std::cout << "[host] Entering global receive/respond loop...\n";
+        reactor r;
+        if (!r.ok()) return 1;
+        for (const auto& n : nics) r.spawn(receive_loop(r, st, n));
+        r.spawn(snapshot_loop(r, st));
+        r.run();
     }
 
     printf("[host] All packets done, exiting\n");
+    // The run is complete; the next one starts from scratch
+    unlink(SNAPSHOT_PATH);
 
-    close(sockfd);
+    for (const auto& n : nics) close(n.sockfd);
     return 0;
 }
@@ -1,5 +1,6 @@
 // src/host_send.cpp
 #include "packet_format.hpp"
+#include "reactor.hpp"
 #include "socket_utils.hpp"
 
 #ifndef __linux__
@@ -13,58 +14,71 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <chrono>
+#include <cerrno>
 #include <cstdint>
+#include <cstdlib>
 #include <cstring>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <vector>
 
 // Experiment parameters
 constexpr int NUM_PACKETS = 500;
 constexpr int MAX_ITER    = 64;
+constexpr int SEND_GAP_MS = 10;   // between initial packets
 
-int main() {
-
-    // Change this to the NIC connected to Tofino
-    std::string ifname = "veth1";
-
-    uint8_t host_mac[6]   = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55};
-    uint8_t tofino_mac[6] = {0x00, 0xaa, 0xbb, 0xcc, 0xdd, 0xee};
-
+struct nic {
+    std::string name;
+    int sockfd  = -1;
     int ifindex = 0;
-    int sockfd  = open_raw_socket(ifname, ifindex);
-    if (sockfd < 0) {
-        std::cerr << "Failed to open raw socket on " << ifname << "\n";
-        return 1;
+    std::unique_ptr<frame_transport> tr = nullptr;   // --transport; null: reactor sendto
+};
+
+static bool open_nic(nic& n) {
+    n.sockfd = open_raw_socket(n.name, n.ifindex);
+    if (n.sockfd < 0) {
+        std::cerr << "Failed to open raw socket on " << n.name << "\n";
+        return false;
     }
 
-    std::cout << "[host] Using interface " << ifname
-              << " (ifindex=" << ifindex << ")\n";
+    std::cout << "[host] Using interface " << n.name
+              << " (ifindex=" << n.ifindex << ")\n";
 
     // Increase socket buffer sizes aggressively to handle burst traffic
     long int rcvbuf = (long int) 128 * 1024 * 1024;  // 128 MB
     long int sndbuf = (long int) 128 * 1024 * 1024;  // 128 MB
-    if (setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf)) < 0) {
+    if (setsockopt(n.sockfd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf)) < 0) {
         perror("setsockopt SO_RCVBUF");
     } else {
         std::cout << "[host] Set SO_RCVBUF to " << rcvbuf << " bytes\n";
     }
-    if (setsockopt(sockfd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf)) < 0) {
+    if (setsockopt(n.sockfd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf)) < 0) {
         perror("setsockopt SO_SNDBUF");
     } else {
         std::cout << "[host] Set SO_SNDBUF to " << sndbuf << " bytes\n";
     }
+    return true;
+}
 
+// --------------------------
+// Send initial packets for pktid=1..NUM_PACKETS on one interface
+// (`verbose`: a line per packet)
+// --------------------------
+static task send_packets(reactor& r, const nic& n, const uint8_t host_mac[6],
+                         const uint8_t tofino_mac[6], bool verbose) {
     // Flow for all packets
     uint32_t src_ip = inet_addr("100.0.0.1");
     uint32_t dst_ip = inet_addr("200.0.0.1");
 
-    std::vector<bool> done(NUM_PACKETS + 1, false);
+    struct sockaddr_ll addr{};
+    addr.sll_family  = AF_PACKET;
+    addr.sll_ifindex = n.ifindex;
+    addr.sll_halen   = ETH_ALEN;
+    std::memcpy(addr.sll_addr, tofino_mac, 6);
 
-    // --------------------------
-    // 1) Send initial packets for pktid=1..NUM_PACKETS
-    // --------------------------
     for (int p = 1; p <= NUM_PACKETS; ++p) {
         uint16_t pktid = static_cast<uint16_t>(p);
 
@@ -76,11 +90,9 @@ int main() {
         ipv4_h ip{};
         ip.version_ihl       = (4 << 4) | 5;
         ip.tos               = 0;
-
         uint16_t ip_total_len = static_cast<uint16_t>(
             sizeof(ipv4_h) + sizeof(recipe_h));
         ip.total_len          = htons(ip_total_len);
-
         ip.identification    = htons(pktid);
         ip.flags_frag_offset = htons(0x4000);
         ip.ttl               = 255;
@@ -107,24 +119,71 @@ int main() {
         uint16_t init_pint  = ntohs(recipe.pint);
         uint8_t  init_xdeg  = recipe.xor_degree;
 
-        std::cout << "[host] init pktid=" << pktid
-                  << " hopid=" << init_hopid
-                  << " ttl=" << static_cast<int>(init_ttl)
-                  << " pint=" << init_pint
-                  << " xor=" << static_cast<int>(init_xdeg) << "\n";
+        if (verbose) {
+            std::cout << "[host] " << n.name << " init pktid=" << pktid
+                      << " hopid=" << init_hopid
+                      << " ttl=" << static_cast<int>(init_ttl)
+                      << " pint=" << init_pint
+                      << " xor=" << static_cast<int>(init_xdeg) << "\n";
+        }
 
         // Send initial frame
-        if (!send_frame(sockfd, frame, ifindex, tofino_mac)) {
+        ssize_t sent;
+        if (n.tr) {
+            sent = n.tr->send_batch({frame_view{frame.data(), frame.size()}}) == 1 ? 0 : -EIO;
+        } else {
+            sent = co_await async_sendto(r, n.sockfd, frame.data(), frame.size(),
+                                         reinterpret_cast<struct sockaddr*>(&addr),
+                                         sizeof(addr));
+        }
+        if (sent < 0) {
             std::cerr << "[host] Failed to send initial frame for pktid="
-                      << pktid << "\n";
-            done[pktid] = true;
+                      << pktid << ": " << std::strerror(static_cast<int>(-sent)) << "\n";
             continue;
         }
 
-        // Add delay between sends to avoid overwhelming the switch
-        usleep(10000);  // 10ms delay between packets
+        // Pace sends to avoid overwhelming the switch
+        co_await r.sleep_for(std::chrono::milliseconds(SEND_GAP_MS));
     }
+}
+
+int main(int argc, char** argv) {
+    // Change this to the NIC(s) connected to Tofino (--if, repeatable)
+    std::vector<nic> nics;
+    std::string transport;   // socket, mmsg or uring; empty: reactor sendto
+    bool verbose = false;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string k = argv[i];
+        if (k == "--if") {
+            nics.push_back(nic{argv[i + 1]});
+        } else if (k == "--transport") {
+            transport = argv[i + 1];
+        } else if (k == "--verbose") {
+            verbose = std::atoi(argv[i + 1]) != 0;
+        } else {
+            std::cerr << "[host] Unknown option " << k << "\n";
+            return 1;
+        }
+    }
+    if (nics.empty()) nics.push_back(nic{"veth1"});
+
+    uint8_t host_mac[6]   = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55};
+    uint8_t tofino_mac[6] = {0x00, 0xaa, 0xbb, 0xcc, 0xdd, 0xee};
+
+    for (auto& n : nics) {
+        if (!open_nic(n)) return 1;
+        if (!transport.empty()) {
+            n.tr = make_transport(transport, n.sockfd, n.ifindex);
+            if (!n.tr) return 1;
+        }
+    }
+
+    // One thread paces every interface
+    reactor r;
+    if (!r.ok()) return 1;
+    for (const auto& n : nics) r.spawn(send_packets(r, n, host_mac, tofino_mac, verbose));
+    r.run();
 
-    close(sockfd);
+    for (const auto& n : nics) close(n.sockfd);
     return 0;
 }
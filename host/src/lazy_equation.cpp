@@ -0,0 +1,134 @@
+// src/lazy_equation.cpp
+#include "lazy_equation.hpp"
+
+#include <algorithm>
+
+// -------------------------------------------------------------------
+// xor_set_cache
+// -------------------------------------------------------------------
+
+hop_mask xor_set_cache::get(uint32_t pktid, int num_hops) {
+    uint64_t k = key(pktid, num_hops);
+    auto it = index_.find(k);
+    if (it != index_.end()) {
+        ++hits_;
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return it->second->second;
+    }
+
+    ++reconstructions_;
+    hop_mask m = reconstruct_xor_set(apa_, num_hops, pktid);
+    if (capacity_ == 0) return m;
+    if (lru_.size() < capacity_) {
+        lru_.emplace_front(k, m);
+        index_.emplace(k, lru_.begin());
+        return m;
+    }
+    // Full: the oldest entry's list and map nodes are reused, so a miss
+    // allocates nothing
+    lru_.splice(lru_.begin(), lru_, std::prev(lru_.end()));
+    auto node  = index_.extract(lru_.front().first);
+    node.key() = k;
+    index_.insert(std::move(node));
+    lru_.front() = entry{k, m};
+    return m;
+}
+
+void xor_set_cache::clear() {
+    lru_.clear();
+    index_.clear();
+}
+
+// -------------------------------------------------------------------
+// peeling_decoder
+// -------------------------------------------------------------------
+
+peeling_decoder::peeling_decoder(int num_hops, xor_set_cache& cache)
+    : num_hops_(num_hops), cache_(cache), elim_(num_hops),
+      values_(static_cast<size_t>(num_hops), 0) {}
+
+void peeling_decoder::reset() {
+    elim_.reset();
+    pending_.clear();
+    next_ = 0;
+    eqs_.clear();
+    ripple_.clear();
+    resolved_ = hop_mask{};
+    std::fill(values_.begin(), values_.end(), 0);
+    peeled_       = 0;
+    eliminated_   = false;
+    received_     = 0;
+    materialized_ = 0;
+}
+
+void peeling_decoder::pull(const lazy_equation& eq) {
+    packet_equation m = cache_.materialize(eq);
+    ++materialized_;
+    elim_.add_equation(m);
+
+    // Substitute the hops peeled so far
+    residual r{m.xor_set, m.pint, 0};
+    for (int k = 0; k < HOP_MASK_WORDS; ++k) {
+        for (uint64_t known = r.xor_set.w[k] & resolved_.w[k]; known; known &= known - 1) {
+            r.pint ^= values_[static_cast<size_t>(k * 64 + __builtin_ctzll(known))];
+        }
+        r.xor_set.w[k] &= ~resolved_.w[k];
+    }
+    r.degree = r.xor_set.count();
+    if (r.degree == 0) return;   // nothing new (or a corrupted pint)
+
+    if (r.degree == 1) ripple_.push_back(static_cast<uint32_t>(eqs_.size()));
+    eqs_.push_back(r);
+}
+
+void peeling_decoder::resolve(int hop, uint16_t value) {
+    resolved_.set(hop);
+    values_[static_cast<size_t>(hop)] = value;
+    ++peeled_;
+
+    // A scan rather than per-hop lists: far fewer hops are peeled than
+    // equations are pulled on long paths, so the lists cost more to keep
+    for (uint32_t e = 0; e < eqs_.size(); ++e) {
+        residual& r = eqs_[e];
+        if (!r.xor_set.test(hop)) continue;
+        r.xor_set.clear(hop);
+        r.pint ^= value;
+        if (--r.degree == 1) ripple_.push_back(e);
+    }
+}
+
+void peeling_decoder::peel() {
+    while (!ripple_.empty()) {
+        residual& r = eqs_[ripple_.back()];
+        ripple_.pop_back();
+        if (r.degree != 1) continue;   // already resolved through another equation
+        int hop = r.xor_set.lowest();
+        if (hop >= num_hops_ || resolved_.test(hop)) continue;
+        resolve(hop, r.pint);
+    }
+}
+
+bool peeling_decoder::decode(std::vector<uint16_t>& switch_ids) {
+    // Cached equations first, by degree; the rest in arrival order
+    auto first = pending_.begin() + static_cast<std::ptrdiff_t>(next_);
+    auto uncached = std::stable_partition(first, pending_.end(), [this](const lazy_equation& eq) {
+        return cache_.peek(eq.pktid, eq.num_hops) != nullptr;
+    });
+    std::stable_sort(first, uncached, [this](const lazy_equation& a, const lazy_equation& b) {
+        return cache_.peek(a.pktid, a.num_hops)->count() < cache_.peek(b.pktid, b.num_hops)->count();
+    });
+
+    for (;;) {
+        peel();
+        if (peeled_ == num_hops_) {
+            switch_ids = values_;
+            return true;
+        }
+        if (elim_.solved()) {
+            eliminated_ = true;
+            return elim_.solve(switch_ids);
+        }
+        if (next_ == pending_.size()) return false;
+        pull(pending_[next_++]);
+    }
+}
@@ -0,0 +1,195 @@
+// src/markowitz_solver.cpp
+#include "markowitz_solver.hpp"
+
+#include <iostream>
+
+// Calls f(j) for every set bit j of m, lowest first.
+template <typename F>
+static void for_each_bit(const hop_mask& m, F&& f) {
+    for (int k = 0; k < HOP_MASK_WORDS; ++k) {
+        for (uint64_t w = m.w[k]; w; w &= w - 1) f(k * 64 + __builtin_ctzll(w));
+    }
+}
+
+markowitz_solver::markowitz_solver(int num_hops, pivot_order order, double dense_fill)
+    : num_hops_(num_hops), order_(order), dense_fill_(dense_fill),
+      count_(static_cast<size_t>(num_hops), 0) {}
+
+void markowitz_solver::load(const std::vector<packet_equation>& eqs) {
+    size_t n = eqs.size();
+    rows_.resize(n);
+    rhs_.resize(n);
+    degree_.resize(n);
+    active_.clear();
+    pivots_.clear();
+    count_.assign(static_cast<size_t>(num_hops_), 0);
+    open_ = hop_mask{};
+    for (int c = 0; c < num_hops_; ++c) open_.set(c);
+    nonzeros_     = 0;
+    inconsistent_ = false;
+    stats_        = elimination_stats{};
+    stats_.rows   = n;
+
+    for (size_t r = 0; r < n; ++r) {
+        rows_[r]   = eqs[r].xor_set;
+        rhs_[r]    = eqs[r].pint;
+        degree_[r] = rows_[r].count();
+        widen(degree_[r]);
+        if (drop_if_empty(static_cast<uint32_t>(r))) continue;
+        active_.push_back(static_cast<uint32_t>(r));
+        nonzeros_ += static_cast<size_t>(degree_[r]);
+        for_each_bit(rows_[r], [&](int j) { ++count_[j]; });
+    }
+}
+
+// An empty row is redundant, and contradicts the others unless 0 = pint.
+bool markowitz_solver::drop_if_empty(uint32_t r) {
+    if (degree_[r] != 0) return false;
+    if (rhs_[r] != 0) inconsistent_ = true;
+    return true;
+}
+
+// -------------------------------------------------------------------
+// Sparse phase: Markowitz pivots
+// -------------------------------------------------------------------
+
+bool markowitz_solver::sparse_phase() {
+    while (!active_.empty() && !open_.empty()) {
+        size_t cols = static_cast<size_t>(open_.count());
+        if (static_cast<double>(nonzeros_) > dense_fill_ * static_cast<double>(active_.size() * cols)) {
+            return true;   // the rest goes to the dense core
+        }
+
+        // Limited search: the lowest-count column with its sparsest
+        // holder, and every column of the rows of lowest degree. A column
+        // held by one row, or a singleton row, costs nothing.
+        int min_col = -1;
+        for_each_bit(open_, [&](int c) {
+            if (count_[c] > 0 && (min_col < 0 || count_[c] < count_[min_col])) min_col = c;
+        });
+        if (min_col < 0) return true;   // open columns no row holds: rank deficient
+
+        int min_degree = num_hops_ + 1;
+        for (uint32_t r : active_) {
+            if (degree_[r] < min_degree) min_degree = degree_[r];
+        }
+
+        size_t best_pos = 0, best_cost = SIZE_MAX;
+        int best_col = -1;
+        auto consider = [&](size_t pos, int c) {
+            size_t cost = static_cast<size_t>(degree_[active_[pos]] - 1) * static_cast<size_t>(count_[c] - 1);
+            if (cost < best_cost) { best_cost = cost; best_pos = pos; best_col = c; }
+        };
+        int holder_degree = num_hops_ + 1;
+        for (size_t pos = 0; pos < active_.size() && best_cost > 0; ++pos) {
+            uint32_t r = active_[pos];
+            if (degree_[r] < holder_degree && rows_[r].test(min_col)) {
+                holder_degree = degree_[r];
+                consider(pos, min_col);
+            }
+            if (degree_[r] == min_degree) {
+                for_each_bit(rows_[r], [&](int c) { consider(pos, c); });
+            }
+        }
+
+        // The pivot row leaves the active matrix as it is; rows below it
+        // lose column best_col.
+        uint32_t p = active_[best_pos];
+        active_[best_pos] = active_.back();
+        active_.pop_back();
+        open_.clear(best_col);
+        nonzeros_ -= static_cast<size_t>(degree_[p]);
+        for_each_bit(rows_[p], [&](int j) { --count_[j]; });
+        pivots_.push_back(pivot{p, best_col});
+        ++stats_.sparse_pivots;
+
+        const hop_mask& prow = rows_[p];
+        for (size_t pos = 0; pos < active_.size();) {
+            uint32_t r = active_[pos];
+            if (!rows_[r].test(best_col)) { ++pos; continue; }
+            hop_mask gained, lost;
+            for (int k = 0; k < HOP_MASK_WORDS; ++k) {
+                gained.w[k] = prow.w[k] & ~rows_[r].w[k];
+                lost.w[k]   = prow.w[k] & rows_[r].w[k];
+            }
+            rows_[r] ^= prow;
+            rhs_[r]  ^= rhs_[p];
+            ++stats_.row_xors;
+            for_each_bit(gained, [&](int j) { ++count_[j]; });
+            for_each_bit(lost, [&](int j) { --count_[j]; });
+            int degree = rows_[r].count();
+            nonzeros_ += static_cast<size_t>(degree);
+            nonzeros_ -= static_cast<size_t>(degree_[r]);
+            degree_[r] = degree;
+            widen(degree);
+            if (drop_if_empty(r)) {
+                active_[pos] = active_.back();
+                active_.pop_back();
+                continue;
+            }
+            ++pos;
+        }
+    }
+    return true;
+}
+
+// -------------------------------------------------------------------
+// Dense phase: the remaining core in column order
+// -------------------------------------------------------------------
+
+bool markowitz_solver::dense_phase() {
+    // Active rows only hold open columns, so this is online_decoder on the
+    // core: each row is reduced against the pivots in increasing column
+    // order, and stops once every open column has one.
+    std::vector<int> owner(static_cast<size_t>(num_hops_), -1);
+    int missing = open_.count();
+    for (uint32_t r : active_) {
+        if (missing == 0) break;
+        for (int col = rows_[r].lowest(); col >= 0; col = rows_[r].lowest()) {
+            if (owner[col] < 0) {
+                owner[col] = static_cast<int>(r);
+                --missing;
+                ++stats_.dense_pivots;
+                widen(rows_[r].count());
+                break;
+            }
+            rows_[r] ^= rows_[owner[col]];
+            rhs_[r]  ^= rhs_[owner[col]];
+            ++stats_.row_xors;
+        }
+        if (rows_[r].empty() && rhs_[r] != 0) inconsistent_ = true;
+    }
+    if (missing != 0) return false;
+
+    // Reversed below, so the core is read back from its last column.
+    for_each_bit(open_, [&](int c) {
+        pivots_.push_back(pivot{static_cast<uint32_t>(owner[c]), c});
+    });
+    return true;
+}
+
+bool markowitz_solver::solve(const std::vector<packet_equation>& eqs,
+                             std::vector<uint16_t>& switch_ids) {
+    load(eqs);
+    bool full = true;
+    if (order_ == pivot_order::markowitz) full = sparse_phase();
+    if (full) full = dense_phase();
+    if (inconsistent_) {
+        std::cerr << "[decoder] System inconsistent, no solution.\n";
+        return false;
+    }
+    if (!full) return false;
+
+    // Each pivot row only holds its own column and columns pivoted after
+    // it, so the hops come out in reverse pivot order.
+    switch_ids.assign(static_cast<size_t>(num_hops_), 0);
+    for (size_t i = pivots_.size(); i-- > 0;) {
+        const pivot& pv = pivots_[i];
+        hop_mask rest = rows_[pv.row];
+        rest.clear(pv.col);
+        uint16_t v = rhs_[pv.row];
+        for_each_bit(rest, [&](int j) { v ^= switch_ids[j]; ++stats_.back_xors; });
+        switch_ids[pv.col] = v;
+    }
+    return true;
+}
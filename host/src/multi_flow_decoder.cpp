@@ -0,0 +1,635 @@
+// src/multi_flow_decoder.cpp
+#include "multi_flow_decoder.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+// Flow flags in snapshot records and index slots
+constexpr uint32_t FLOW_DECODED        = 1;
+constexpr uint32_t FLOW_ASSISTED       = 2;
+constexpr uint32_t FLOW_ASSIST_REFUSED = 4;
+constexpr uint32_t FLOW_SUSPECT        = 8;
+constexpr uint32_t FLOW_PROVISIONAL    = 16;
+
+multi_flow_decoder::multi_flow_decoder(int num_hops, int shared_prefix)
+    : num_hops_(num_hops),
+      shared_prefix_(std::min(shared_prefix, num_hops)) {}
+
+bool multi_flow_decoder::add_equation(const flow_key& key,
+                                      const packet_equation& eq) {
+    flow_state* found = find_flow(key);
+    if (!found) {
+        found = &flows_.emplace(key, flow_state(num_hops_)).first->second;
+
+        source_group& grp = groups_[key.src_addr];
+        grp.pending.push_back(key);
+        if (grp.prefix_known) substitute_prefix(*found, grp);
+    }
+
+    flow_state& fs = *found;
+    if (fs.decoded && !fs.provisional) return false;
+    fs.sweep = sweep_;
+
+    switch (dedup_ ? fs.dedup.check(eq) : dedup_result::fresh) {
+    case dedup_result::duplicate:
+        ++duplicates_;
+        return false;
+    case dedup_result::conflict:
+        ++conflicts_;
+        fs.suspect = true;
+        return false;
+    case dedup_result::fresh:
+        break;
+    }
+
+    fs.log.push_back(eq);
+    if (fs.provisional) {
+        check_provisional(key, fs, eq);
+        return false;
+    }
+    fs.ready.observe(eq.xor_set);
+    fs.dec.add_equation(eq);
+    if (!fs.dec.consistent()) {
+        // A wrong substituted prefix shows up as 0 = pint; fall back to
+        // the flow's own equations. Unassisted, the equations themselves
+        // contradict each other (corruption).
+        if (fs.assisted) rebuild_unassisted(fs);
+        else             fs.suspect = true;
+        return false;
+    }
+    return try_finish(key, fs);
+}
+
+const std::vector<uint16_t>* multi_flow_decoder::path(const flow_key& key) {
+    flow_state* fs = find_flow(key);
+    if (!fs || !fs->decoded) return nullptr;
+    return &fs->switch_ids;
+}
+
+void multi_flow_decoder::drain_decoded(std::vector<flow_key>& out) {
+    out.insert(out.end(), newly_decoded_.begin(), newly_decoded_.end());
+    drained_.insert(drained_.end(), newly_decoded_.begin(), newly_decoded_.end());
+    newly_decoded_.clear();
+}
+
+size_t multi_flow_decoder::evict_decoded() {
+    size_t n = 0, keep = 0;
+    for (const auto& key : drained_) {
+        auto it = flows_.find(key);
+        if (it == flows_.end()) {
+            // Still in the snapshot: drop it unread unless provisional
+            long slot = restored_slot(key);
+            uint32_t flags = 0;
+            if (slot < 0 || !restored_flags(static_cast<size_t>(slot), flags)) continue;
+            if (flags & FLOW_PROVISIONAL) {
+                drained_[keep++] = key;
+                continue;
+            }
+            drop_restored(static_cast<size_t>(slot));
+            ++n;
+            continue;
+        }
+        if (!it->second.decoded) continue;   // retracted
+        if (it->second.provisional) {
+            drained_[keep++] = key;
+            continue;
+        }
+        flows_.erase(it);
+        ++n;
+    }
+    drained_.resize(keep);
+    return n;
+}
+
+void multi_flow_decoder::evict_idle(std::vector<flow_key>& evicted) {
+    if (restored_.left > 0 && restored_.sweep != sweep_) evict_restored(evicted);
+    for (auto it = flows_.begin(); it != flows_.end();) {
+        if (it->second.decoded || it->second.sweep == sweep_) {
+            if (it->second.provisional && it->second.sweep != sweep_) finalize(it->second);
+            ++it;
+            continue;
+        }
+        auto g = groups_.find(it->first.src_addr);
+        if (g != groups_.end()) {
+            std::vector<flow_key>& pending = g->second.pending;
+            auto pos = std::find(pending.begin(), pending.end(), it->first);
+            if (pos != pending.end()) pending.erase(pos);
+            if (pending.empty() && !g->second.prefix_known) groups_.erase(g);
+        }
+        evicted.push_back(it->first);
+        it = flows_.erase(it);
+        ++idle_evicted_;
+    }
+    ++sweep_;
+}
+
+bool multi_flow_decoder::suspect(const flow_key& key) {
+    flow_state* fs = find_flow(key);
+    return fs && fs->suspect;
+}
+
+double multi_flow_decoder::expected_remaining(const flow_key& key) {
+    flow_state* fs = model_ ? find_flow(key) : nullptr;
+    if (!fs) return -1.0;
+    if (fs->decoded) return 0.0;
+    return model_->expected_remaining(fs->dec.rank(), fs->ready.uncovered);
+}
+
+size_t multi_flow_decoder::provisional_flows() const {
+    size_t n = restored_.provisional;
+    for (const auto& kv : flows_) n += kv.second.provisional;
+    return n;
+}
+
+bool multi_flow_decoder::provisional(const flow_key& key) {
+    flow_state* fs = find_flow(key);
+    return fs && fs->provisional;
+}
+
+// -1 if the flow's own equations determine a prefix hop that differs
+// from the substituted one, 1 once they determine all of them, else 0.
+int multi_flow_decoder::prefix_verdict(const flow_key& key, const flow_state& fs) const {
+    const source_group& grp = groups_.at(key.src_addr);
+    int known = 0;
+    for (int hop = 0; hop < shared_prefix_; ++hop) {
+        if (!fs.own->known(hop)) continue;
+        if (fs.own->switch_id(hop) != grp.prefix[hop]) return -1;
+        ++known;
+    }
+    return known == shared_prefix_ ? 1 : 0;
+}
+
+// An equation of a provisional flow: one XOR per hop of its xor_set
+// against the published path, plus the own-equation decoder.
+void multi_flow_decoder::check_provisional(const flow_key& key, flow_state& fs,
+                                           const packet_equation& eq) {
+    fs.own->add_equation(eq);
+    uint16_t expect = 0;
+    for (int k = 0; k < HOP_MASK_WORDS; ++k) {
+        for (uint64_t w = eq.xor_set.w[k]; w; w &= w - 1) {
+            int hop = k * 64 + __builtin_ctzll(w);
+            if (hop < num_hops_) expect ^= fs.switch_ids[static_cast<size_t>(hop)];
+        }
+    }
+    int verdict = expect != eq.pint ? -1 : prefix_verdict(key, fs);
+    if (verdict == 1) finalize(fs);
+    if (verdict >= 0) return;
+
+    // Retract: the flow decodes again from its own equations
+    fs.decoded     = false;
+    fs.provisional = false;
+    fs.switch_ids.clear();
+    --decoded_;
+    ++retractions_;
+    auto pos = std::find(newly_decoded_.begin(), newly_decoded_.end(), key);
+    if (pos != newly_decoded_.end()) newly_decoded_.erase(pos);
+    groups_[key.src_addr].pending.push_back(key);
+    rebuild_unassisted(fs);
+    try_finish(key, fs);
+}
+
+// The path is final: drop what only rebuilds and checks needed
+void multi_flow_decoder::finalize(flow_state& fs) {
+    fs.provisional = false;
+    fs.log.clear();
+    fs.log.shrink_to_fit();
+    fs.own.reset();
+    fs.dedup.clear();
+}
+
+bool multi_flow_decoder::try_finish(const flow_key& key, flow_state& fs) {
+    if (!fs.dec.solved()) return false;
+    int verdict = 1;
+    if (fs.assisted) {
+        fs.own = std::make_unique<partial_path_decoder>(num_hops_);
+        for (const auto& eq : fs.log) fs.own->add_equation(eq);
+        verdict = prefix_verdict(key, fs);
+        if (verdict < 0) {
+            // Refuted before publishing; the own equations may suffice
+            rebuild_unassisted(fs);
+            return try_finish(key, fs);
+        }
+    }
+    if (!fs.dec.solve(fs.switch_ids)) return false;
+
+    fs.decoded = true;
+    ++decoded_;
+    newly_decoded_.push_back(key);
+    if (verdict == 1) finalize(fs);
+    else              fs.provisional = true;
+
+    source_group& grp = groups_[key.src_addr];
+    auto pos = std::find(grp.pending.begin(), grp.pending.end(), key);
+    if (pos != grp.pending.end()) grp.pending.erase(pos);
+
+    if (!grp.prefix_known && shared_prefix_ > 0) publish_prefix(key, fs);
+    return true;
+}
+
+void multi_flow_decoder::substitute_prefix(flow_state& fs,
+                                           const source_group& grp) {
+    if (fs.assisted || fs.assist_refused) return;
+
+    // The substituted hops count as covered for the readiness model,
+    // which was tabulated on (rank, uncovered) pairs of real flows.
+    for (int hop = 0; hop < shared_prefix_; ++hop) {
+        fs.dec.add_equation(hop_mask::single(hop), grp.prefix[hop]);
+        fs.ready.observe(hop_mask::single(hop));
+    }
+    fs.assisted = true;
+    ++assisted_;
+    if (!fs.dec.consistent()) rebuild_unassisted(fs);
+}
+
+void multi_flow_decoder::rebuild_unassisted(flow_state& fs) {
+    fs.dec.reset();
+    fs.ready = readiness_tracker(num_hops_);
+    for (const auto& eq : fs.log) {
+        fs.dec.add_equation(eq);
+        fs.ready.observe(eq.xor_set);
+    }
+    fs.own.reset();
+    fs.switch_ids.clear();
+    fs.assisted       = false;
+    fs.assist_refused = true;
+    ++assist_failures_;
+}
+
+void multi_flow_decoder::publish_prefix(const flow_key& key,
+                                        const flow_state& fs) {
+    source_group& grp = groups_[key.src_addr];
+    grp.prefix.assign(fs.switch_ids.begin(),
+                      fs.switch_ids.begin() + shared_prefix_);
+    grp.prefix_known = true;
+
+    // try_finish() edits grp.pending, so walk a copy
+    std::vector<flow_key> pending = grp.pending;
+    for (const auto& other : pending) {
+        flow_state& ofs = flows_.at(other);
+        substitute_prefix(ofs, grp);
+        if (ofs.dec.consistent()) try_finish(other, ofs);
+    }
+}
+
+// -------------------------------------------------------------------
+// Snapshots
+//
+// The section is a head block (checksum, its own size, shape, counters,
+// the decoded keys and the known prefixes), then `slots` index slots,
+// then the flow records. Slots are probed in place and checked one by
+// one; a record carries its own checksum and is parsed when its flow is
+// first touched. Records of untouched flows are copied through as they
+// are by the next save().
+// -------------------------------------------------------------------
+
+#pragma pack(push, 1)
+struct flow_slot_h {
+    uint32_t key[3];
+    uint32_t flags;
+    uint64_t offset;     // record, from the start of the section
+    uint64_t bytes;      // 0: empty slot
+    uint64_t check;      // the fields above
+};
+#pragma pack(pop)
+
+static void put_key(std::vector<uint8_t>& out, const flow_key& key) {
+    uint32_t v[3] = {key.src_addr, key.dst_addr, key.protocol};
+    snapshot_put(out, v, 3);
+}
+
+static bool get_key(snapshot_cursor& in, flow_key& key) {
+    uint32_t v[3];
+    if (!in.get(v, 3) || v[2] > 0xFF) return false;
+    key.src_addr = v[0];
+    key.dst_addr = v[1];
+    key.protocol = static_cast<uint8_t>(v[2]);
+    return true;
+}
+
+static uint64_t slot_check(const flow_slot_h& sl) {
+    return snapshot_checksum(reinterpret_cast<const uint8_t*>(&sl),
+                             offsetof(flow_slot_h, check));
+}
+
+static size_t slot_home(const flow_key& key, size_t slots) {
+    return flow_key_hash()(key) & (slots - 1);
+}
+
+// Overwrites the 8 bytes at `at` with the checksum of what follows them
+static void seal(std::vector<uint8_t>& out, size_t at) {
+    uint64_t check = snapshot_checksum(out.data() + at + 8, out.size() - at - 8);
+    std::memcpy(out.data() + at, &check, 8);
+}
+
+void multi_flow_decoder::save(std::vector<uint8_t>& out) const {
+    struct saved { flow_key key; uint32_t flags; const flow_state* fs; size_t slot; };
+    std::vector<saved> all;
+    all.reserve(num_flows());
+    for (const auto& kv : flows_) {
+        const flow_state& fs = kv.second;
+        uint32_t flags = (fs.decoded ? FLOW_DECODED : 0u) |
+                         (fs.assisted ? FLOW_ASSISTED : 0u) |
+                         (fs.assist_refused ? FLOW_ASSIST_REFUSED : 0u) |
+                         (fs.suspect ? FLOW_SUSPECT : 0u) |
+                         (fs.provisional ? FLOW_PROVISIONAL : 0u);
+        all.push_back(saved{kv.first, flags, &fs, 0});
+    }
+    for (size_t i = 0; restored_.left > 0 && i < restored_.slots; ++i) {
+        flow_slot_h sl;
+        if (restored_.taken[i]) continue;
+        std::memcpy(&sl, restored_.base + restored_.index + i * sizeof(sl), sizeof(sl));
+        if (sl.bytes == 0 || sl.check != slot_check(sl)) continue;
+        flow_key key;
+        key.src_addr = sl.key[0];
+        key.dst_addr = sl.key[1];
+        key.protocol = static_cast<uint8_t>(sl.key[2]);
+        all.push_back(saved{key, sl.flags, nullptr, i});
+    }
+
+    // Head block
+    size_t head_at = out.size();
+    uint64_t decoded_keys = 0, known = 0;
+    for (const auto& f : all) decoded_keys += (f.flags & FLOW_DECODED) != 0;
+    for (const auto& kv : groups_) known += kv.second.prefix_known;
+    size_t slots = 2;
+    while (slots < 2 * all.size()) slots <<= 1;   // load <= 1/2
+
+    uint64_t head_bytes = 0;   // filled in below
+    int32_t  shape[2]   = {num_hops_, shared_prefix_};
+    uint64_t counters[6] = {decoded_, assisted_, assist_failures_,
+                            duplicates_, conflicts_, retractions_};
+    uint64_t sizes[4]    = {all.size(), slots, decoded_keys, known};
+    snapshot_put(out, &head_bytes);   // checksum
+    snapshot_put(out, &head_bytes);
+    snapshot_put(out, shape, 2);
+    snapshot_put(out, counters, 6);
+    snapshot_put(out, sizes, 4);
+    for (const auto& f : all) {
+        if (!(f.flags & FLOW_DECODED)) continue;
+        put_key(out, f.key);
+        snapshot_put(out, &f.flags);
+    }
+    for (const auto& kv : groups_) {
+        if (!kv.second.prefix_known) continue;
+        snapshot_put(out, &kv.first);
+        snapshot_put(out, kv.second.prefix.data(), kv.second.prefix.size());
+    }
+    out.resize(head_at + ((out.size() - head_at + 7) & ~size_t{7}), 0);
+    head_bytes = out.size() - head_at;
+    std::memcpy(out.data() + head_at + 8, &head_bytes, 8);
+    seal(out, head_at);
+
+    // Index, empty slots first; records fill them in as they are written
+    size_t index_at = out.size();
+    flow_slot_h empty{};
+    empty.check = slot_check(empty);
+    for (size_t i = 0; i < slots; ++i) snapshot_put(out, &empty);
+
+    for (const auto& f : all) {
+        flow_slot_h sl{};
+        sl.key[0] = f.key.src_addr;
+        sl.key[1] = f.key.dst_addr;
+        sl.key[2] = f.key.protocol;
+        sl.flags  = f.flags;
+        sl.offset = out.size() - head_at;
+        if (f.fs) {
+            // Field by field: packet_equation has padding
+            const flow_state& fs = *f.fs;
+            size_t at = out.size();
+            uint32_t sizes_f[3] = {f.flags, static_cast<uint32_t>(fs.log.size()),
+                                   static_cast<uint32_t>(fs.switch_ids.size())};
+            int32_t uncovered = fs.ready.uncovered;
+            snapshot_put(out, &sl.check);   // checksum
+            put_key(out, f.key);
+            snapshot_put(out, sizes_f, 3);
+            snapshot_put(out, &uncovered);
+            snapshot_put(out, fs.ready.covered.w, HOP_MASK_WORDS);
+            for (const auto& eq : fs.log) snapshot_put(out, &eq.pktid);
+            for (const auto& eq : fs.log) snapshot_put(out, &eq.pint);
+            for (const auto& eq : fs.log) snapshot_put(out, eq.xor_set.w, HOP_MASK_WORDS);
+            snapshot_put(out, fs.switch_ids.data(), fs.switch_ids.size());
+            fs.dec.save(out);
+            fs.dedup.save(out);
+            seal(out, at);
+        } else {
+            flow_slot_h old;
+            std::memcpy(&old, restored_.base + restored_.index + f.slot * sizeof(old),
+                        sizeof(old));
+            if (old.offset > restored_.bytes || old.bytes > restored_.bytes - old.offset) {
+                continue;   // corrupt; the flow is lost
+            }
+            const uint8_t* rec = restored_.base + old.offset;
+            out.insert(out.end(), rec, rec + old.bytes);
+        }
+        sl.bytes = out.size() - head_at - sl.offset;
+        sl.check = slot_check(sl);
+
+        size_t i = slot_home(f.key, slots);
+        for (;; i = (i + 1) & (slots - 1)) {
+            flow_slot_h cur;
+            std::memcpy(&cur, out.data() + index_at + i * sizeof(cur), sizeof(cur));
+            if (cur.bytes == 0) break;
+        }
+        std::memcpy(out.data() + index_at + i * sizeof(sl), &sl, sizeof(sl));
+    }
+}
+
+bool multi_flow_decoder::load(std::shared_ptr<const snapshot_reader> snap) {
+    snapshot_cursor sec;
+    if (!snap || !snap->find(SNAP_DECODER, sec, false)) return false;   // checked below
+    const uint8_t* base = sec.pos();
+    size_t bytes = sec.left();
+
+    uint64_t check, head_bytes;
+    if (!sec.get(&check) || !sec.get(&head_bytes) ||
+        head_bytes < 16 || head_bytes > bytes ||
+        check != snapshot_checksum(base + 8, head_bytes - 8)) {
+        std::cerr << "[decoder] snapshot head block is corrupt, ignoring\n";
+        return false;
+    }
+    int32_t  shape[2];
+    uint64_t counters[6], sizes[4];
+    if (!sec.get(shape, 2) || !sec.get(counters, 6) || !sec.get(sizes, 4)) return false;
+    if (shape[0] != num_hops_ || shape[1] != shared_prefix_) return false;
+    size_t slots = sizes[1];
+    if ((slots & (slots - 1)) != 0 || 2 * sizes[0] > slots ||
+        slots > (bytes - head_bytes) / sizeof(flow_slot_h)) {
+        return false;
+    }
+
+    std::vector<flow_key> decoded;
+    size_t provisional = 0;
+    for (uint64_t i = 0; i < sizes[2]; ++i) {
+        flow_key key;
+        uint32_t flags;
+        if (!get_key(sec, key) || !sec.get(&flags)) return false;
+        decoded.push_back(key);
+        provisional += (flags & FLOW_PROVISIONAL) != 0;
+    }
+    std::unordered_map<uint32_t, source_group> groups;
+    for (uint64_t i = 0; i < sizes[3]; ++i) {
+        uint32_t src;
+        if (!sec.get(&src)) return false;
+        source_group& grp = groups[src];
+        grp.prefix.resize(static_cast<size_t>(shared_prefix_));
+        if (!sec.get(grp.prefix.data(), grp.prefix.size())) return false;
+        grp.prefix_known = true;
+    }
+
+    flows_.clear();
+    groups_.swap(groups);
+    newly_decoded_.swap(decoded);
+    drained_.clear();
+    decoded_         = counters[0];
+    assisted_        = counters[1];
+    assist_failures_ = counters[2];
+    duplicates_      = counters[3];
+    conflicts_       = counters[4];
+    retractions_     = counters[5];
+
+    restored_ = restored_index{};
+    restored_.base        = base;
+    restored_.bytes       = bytes;
+    restored_.index       = head_bytes;
+    restored_.slots       = slots;
+    restored_.taken.assign(slots, 0);
+    restored_.left        = sizes[0];
+    restored_.provisional = provisional;
+    restored_.sweep       = sweep_;
+    restored_.file        = std::move(snap);
+    if (restored_.left == 0) restored_ = restored_index{};
+    return true;
+}
+
+// -------------------------------------------------------------------
+// Restored flows
+// -------------------------------------------------------------------
+
+multi_flow_decoder::flow_state* multi_flow_decoder::find_flow(const flow_key& key) {
+    auto it = flows_.find(key);
+    if (it != flows_.end()) return &it->second;
+    if (restored_.left == 0) return nullptr;
+    long slot = restored_slot(key);
+    return slot < 0 ? nullptr : materialize(key, static_cast<size_t>(slot));
+}
+
+// Untaken slot of `key`, or -1. A slot failing its check ends the probe.
+long multi_flow_decoder::restored_slot(const flow_key& key) const {
+    if (restored_.left == 0) return -1;
+    size_t mask = restored_.slots - 1;
+    for (size_t i = slot_home(key, restored_.slots), n = 0; n < restored_.slots;
+         i = (i + 1) & mask, ++n) {
+        flow_slot_h sl;
+        std::memcpy(&sl, restored_.base + restored_.index + i * sizeof(sl), sizeof(sl));
+        if (sl.check != slot_check(sl)) {
+            std::cerr << "[decoder] snapshot index slot " << i << " is corrupt\n";
+            return -1;
+        }
+        if (sl.bytes == 0) return -1;
+        if (sl.key[0] == key.src_addr && sl.key[1] == key.dst_addr &&
+            sl.key[2] == key.protocol) {
+            return restored_.taken[i] ? -1 : static_cast<long>(i);
+        }
+    }
+    return -1;
+}
+
+bool multi_flow_decoder::restored_flags(size_t slot, uint32_t& flags) const {
+    flow_slot_h sl;
+    std::memcpy(&sl, restored_.base + restored_.index + slot * sizeof(sl), sizeof(sl));
+    flags = sl.flags;
+    return sl.check == slot_check(sl);
+}
+
+// Parses the record of `slot` into flows_; nullptr (and the flow is
+// dropped) if it fails its checksum.
+multi_flow_decoder::flow_state* multi_flow_decoder::materialize(const flow_key& key,
+                                                                 size_t slot) {
+    flow_slot_h sl;
+    std::memcpy(&sl, restored_.base + restored_.index + slot * sizeof(sl), sizeof(sl));
+
+    const uint8_t* rec = restored_.base + sl.offset;
+    uint64_t check = 0;
+    bool ok = sl.offset <= restored_.bytes && sl.bytes >= 8 &&
+              sl.bytes <= restored_.bytes - sl.offset;
+    if (ok) std::memcpy(&check, rec, 8);
+    ok = ok && check == snapshot_checksum(rec + 8, sl.bytes - 8);
+
+    snapshot_cursor in(rec + 8, ok ? sl.bytes - 8 : 0);
+    flow_key stored;
+    uint32_t sizes[3] = {};
+    int32_t  uncovered = 0;
+    flow_state fs(num_hops_);
+    ok = ok && get_key(in, stored) && stored == key && in.get(sizes, 3) &&
+         in.get(&uncovered) && sizes[0] == sl.flags &&
+         sizes[2] <= static_cast<uint32_t>(num_hops_) &&
+         in.get(fs.ready.covered.w, HOP_MASK_WORDS);
+    if (ok) {
+        fs.log.resize(sizes[1]);
+        fs.switch_ids.resize(sizes[2]);
+        for (auto& eq : fs.log) ok = ok && in.get(&eq.pktid);
+        for (auto& eq : fs.log) ok = ok && in.get(&eq.pint);
+        for (auto& eq : fs.log) ok = ok && in.get(eq.xor_set.w, HOP_MASK_WORDS);
+        ok = ok && in.get(fs.switch_ids.data(), fs.switch_ids.size()) &&
+             fs.dec.load(in) && fs.dedup.load(in) && in.done();
+    }
+    drop_restored(slot);   // may unmap; rec is not used below
+
+    fs.decoded         = sizes[0] & FLOW_DECODED;
+    fs.provisional     = sizes[0] & FLOW_PROVISIONAL;
+    fs.assisted        = sizes[0] & FLOW_ASSISTED;
+    fs.assist_refused  = sizes[0] & FLOW_ASSIST_REFUSED;
+    fs.suspect         = sizes[0] & FLOW_SUSPECT;
+    fs.ready.uncovered = uncovered;
+    fs.sweep           = sweep_;
+    if (!ok || (fs.provisional && (!fs.decoded || !fs.assisted))) {
+        std::cerr << "[decoder] snapshot record of a flow is corrupt, dropping it\n";
+        return nullptr;
+    }
+    if (fs.provisional) {
+        fs.own = std::make_unique<partial_path_decoder>(num_hops_);
+        for (const auto& eq : fs.log) fs.own->add_equation(eq);
+    }
+
+    flow_state& live = flows_.emplace(key, std::move(fs)).first->second;
+    if (!live.decoded) {
+        // A prefix learned since the snapshot applies now
+        source_group& grp = groups_[key.src_addr];
+        grp.pending.push_back(key);
+        if (grp.prefix_known && !live.assisted) {
+            substitute_prefix(live, grp);
+            if (live.dec.consistent()) try_finish(key, live);
+        }
+    }
+    return &live;
+}
+
+void multi_flow_decoder::drop_restored(size_t slot) {
+    flow_slot_h sl;
+    std::memcpy(&sl, restored_.base + restored_.index + slot * sizeof(sl), sizeof(sl));
+    restored_.taken[slot] = 1;
+    if (sl.flags & FLOW_PROVISIONAL) --restored_.provisional;
+    if (--restored_.left == 0) restored_ = restored_index{};   // unmap
+}
+
+// A full idle period after load(): untouched undecoded flows go, silent
+// provisional ones are read in and made final.
+void multi_flow_decoder::evict_restored(std::vector<flow_key>& evicted) {
+    for (size_t i = 0; restored_.left > 0 && i < restored_.slots; ++i) {
+        flow_slot_h sl;
+        if (restored_.taken[i]) continue;
+        std::memcpy(&sl, restored_.base + restored_.index + i * sizeof(sl), sizeof(sl));
+        if (sl.bytes == 0 || sl.check != slot_check(sl)) continue;
+        flow_key key;
+        key.src_addr = sl.key[0];
+        key.dst_addr = sl.key[1];
+        key.protocol = static_cast<uint8_t>(sl.key[2]);
+        if (sl.flags & FLOW_PROVISIONAL) {
+            if (flow_state* fs = materialize(key, i)) finalize(*fs);
+        } else if (!(sl.flags & FLOW_DECODED)) {
+            drop_restored(i);
+            evicted.push_back(key);
+            ++idle_evicted_;
+        }
+    }
+}
@@ -0,0 +1,85 @@
+// src/partial_path.cpp
+#include "partial_path.hpp"
+
+partial_path_decoder::partial_path_decoder(int num_hops)
+    : num_hops_(num_hops),
+      rows_(static_cast<size_t>(num_hops)),
+      rhs_(static_cast<size_t>(num_hops), 0) {
+    resolved_.reserve(static_cast<size_t>(num_hops));
+}
+
+void partial_path_decoder::reset() {
+    rank_         = 0;
+    inconsistent_ = false;
+    equations_    = 0;
+    pivots_       = hop_mask{};
+    known_        = hop_mask{};
+    resolved_.clear();
+}
+
+void partial_path_decoder::settle(int col, clock::time_point at) {
+    known_.set(col);
+    resolved_.push_back(resolved_hop{col, rhs_[static_cast<size_t>(col)],
+                                     static_cast<uint32_t>(equations_), at});
+}
+
+int partial_path_decoder::add_equation(const hop_mask& xor_set, uint16_t pint, clock::time_point at) {
+    ++equations_;
+    hop_mask row = xor_set;
+    uint16_t rhs = pint;
+
+    // Basis rows hold no other pivot column, so one XOR per pivot column
+    // of the incoming row clears them all.
+    for (int k = 0; k < HOP_MASK_WORDS; ++k) {
+        for (uint64_t w = row.w[k] & pivots_.w[k]; w; w &= w - 1) {
+            size_t col = static_cast<size_t>(k * 64 + __builtin_ctzll(w));
+            row ^= rows_[col];
+            rhs ^= rhs_[col];
+        }
+    }
+
+    int p = row.lowest();
+    if (p < 0 || p >= num_hops_) {
+        if (rhs != 0) inconsistent_ = true;
+        return 0;
+    }
+
+    // New pivot p: clear it from the other rows to stay reduced. Rows of
+    // known hops never hold a free column, so they are left alone.
+    size_t before = resolved_.size();
+    for (int k = 0; k < HOP_MASK_WORDS; ++k) {
+        for (uint64_t w = pivots_.w[k] & ~known_.w[k]; w; w &= w - 1) {
+            int col = k * 64 + __builtin_ctzll(w);
+            hop_mask& r = rows_[static_cast<size_t>(col)];
+            if (!r.test(p)) continue;
+            r ^= row;
+            rhs_[static_cast<size_t>(col)] ^= rhs;
+            if (r.count() == 1) settle(col, at);
+        }
+    }
+
+    rows_[static_cast<size_t>(p)] = row;
+    rhs_[static_cast<size_t>(p)]  = rhs;
+    pivots_.set(p);
+    ++rank_;
+    if (row.count() == 1) settle(p, at);
+    return static_cast<int>(resolved_.size() - before);
+}
+
+int partial_path_decoder::known_prefix() const {
+    int n = 0;
+    while (n < num_hops_ && known_.test(n)) ++n;
+    return n;
+}
+
+int partial_path_decoder::known_suffix() const {
+    int n = 0;
+    while (n < num_hops_ && known_.test(num_hops_ - 1 - n)) ++n;
+    return n;
+}
+
+bool partial_path_decoder::solve(std::vector<uint16_t>& switch_ids) const {
+    if (!solved() || inconsistent_) return false;
+    switch_ids.assign(rhs_.begin(), rhs_.begin() + num_hops_);
+    return true;
+}
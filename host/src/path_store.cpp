@@ -0,0 +1,284 @@
+// src/path_store.cpp
+#include "path_store.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+path_store::flow_shard* path_store::flow_shard::make(uint32_t count) {
+    uint32_t cap = 4;
+    while (cap < 2 * count) cap <<= 1;   // load <= 1/2
+    void* mem = ::operator new(sizeof(flow_shard) + cap * sizeof(flow_entry));
+    flow_shard* s = new (mem) flow_shard{0, cap - 1};
+    for (uint32_t i = 0; i < cap; ++i) s->slots()[i].path = nullptr;
+    return s;
+}
+
+void path_store::flow_shard::destroy(const flow_shard* s) {
+    ::operator delete(const_cast<flow_shard*>(s));
+}
+
+path_store::path_store()
+    : root_(new flow_root),
+      path_chunks_(new std::atomic<std::vector<uint16_t>*>[PATH_MAX_CHUNKS]) {
+    for (size_t i = 0; i < PATH_MAX_CHUNKS; ++i) path_chunks_[i] = nullptr;
+}
+
+path_store::~path_store() {
+    flow_root* root = root_.load();
+    for (const flow_shard* s : root->shards) {
+        if (s) flow_shard::destroy(s);
+    }
+    delete root;
+    for (size_t i = 0; i < PATH_MAX_CHUNKS; ++i) delete[] path_chunks_[i].load();
+}
+
+uint64_t path_store::path_fingerprint(const std::vector<uint16_t>& path) {
+    uint64_t h = 0x9E3779B97F4A7C15ull ^ path.size();
+    for (uint16_t id : path) {
+        h = (h ^ id) * 0x100000001B3ull;
+        h ^= h >> 29;
+    }
+    return h;
+}
+
+// Caller holds mu_.
+uint32_t path_store::intern(const std::vector<uint16_t>& path) {
+    std::vector<uint32_t>& ids = by_fp_[path_fingerprint(path)];
+    for (uint32_t id : ids) {
+        if (stored_path(id) == path) return id;
+    }
+
+    uint32_t id = num_paths_.load(std::memory_order_relaxed);
+    size_t chunk = id / PATH_CHUNK_SIZE;
+    if (!path_chunks_[chunk].load(std::memory_order_relaxed)) {
+        path_chunks_[chunk].store(new std::vector<uint16_t>[PATH_CHUNK_SIZE],
+                                  std::memory_order_release);
+    }
+    path_chunks_[chunk].load(std::memory_order_relaxed)[id % PATH_CHUNK_SIZE] = path;
+    // Publish the id only after its path is in place
+    num_paths_.store(id + 1, std::memory_order_release);
+
+    flows_by_path_.emplace_back();
+    ids.push_back(id);
+    for (size_t hop = 0; hop < path.size(); ++hop) {
+        index_[index_key(path[hop], static_cast<int>(hop))].add(id);
+    }
+    return id;
+}
+
+uint32_t path_store::publish(const flow_key& key, const std::vector<uint16_t>& path) {
+    publish_batch({update{key, path}});
+    uint32_t id = 0;
+    path_id(key, id);
+    return id;
+}
+
+void path_store::publish_batch(const std::vector<update>& updates) {
+    if (updates.empty()) return;
+    std::lock_guard<std::mutex> lock(mu_);
+
+    // Group by shard so each touched shard is copied once
+    struct pending {
+        size_t shard;
+        size_t order;
+        const flow_key* key;
+        uint32_t id;
+    };
+    std::vector<pending> todo;
+    todo.reserve(updates.size());
+    for (const auto& u : updates) {
+        todo.push_back(pending{shard_of(u.first), todo.size(), &u.first, intern(u.second)});
+    }
+    // Keep batch order within a shard: a later update of a flow wins
+    std::sort(todo.begin(), todo.end(), [](const pending& a, const pending& b) {
+        return a.shard != b.shard ? a.shard < b.shard : a.order < b.order;
+    });
+
+    flow_root* old_root = root_.load(std::memory_order_relaxed);
+    flow_root* new_root = new flow_root(*old_root);
+    std::vector<const flow_shard*> replaced;
+    size_t added = 0;
+
+    for (size_t i = 0; i < todo.size();) {
+        size_t s = todo[i].shard;
+        size_t n = 0;
+        while (i + n < todo.size() && todo[i + n].shard == s) ++n;
+
+        const flow_shard* old_shard = old_root->shards[s];
+        uint32_t old_count = old_shard ? old_shard->count : 0;
+        flow_shard* shard = flow_shard::make(old_count + static_cast<uint32_t>(n));
+        if (old_shard && old_shard->mask == shard->mask) {
+            // Same geometry: a flat copy keeps every probe sequence intact
+            std::memcpy(shard->slots(), old_shard->slots(),
+                        (shard->mask + 1) * sizeof(flow_entry));
+            shard->count = old_count;
+        } else if (old_shard) {
+            for (uint32_t j = 0; j <= old_shard->mask; ++j) {
+                const flow_entry& e = old_shard->slots()[j];
+                if (e.path) *probe(shard, e.key) = e;
+            }
+            shard->count = old_count;
+        }
+
+        for (size_t end = i + n; i < end; ++i) {
+            const pending& p = todo[i];
+            flow_entry* e = probe(shard, *p.key);
+            if (e->path) {
+                if (e->path_id == p.id) continue;
+                // Path changed: unlink the flow from its old path. Old
+                // paths stay interned so ids remain stable for readers.
+                std::vector<flow_key>& old = flows_by_path_[e->path_id];
+                auto f = std::find(old.begin(), old.end(), *p.key);
+                if (f != old.end()) {
+                    *f = old.back();
+                    old.pop_back();
+                }
+            } else {
+                e->key = *p.key;
+                ++shard->count;
+                ++added;
+            }
+            e->path_id = p.id;
+            e->path    = &stored_path(p.id);
+            flows_by_path_[p.id].push_back(*p.key);
+        }
+
+        new_root->shards[s] = shard;
+        if (old_shard) replaced.push_back(old_shard);
+    }
+
+    root_.store(new_root, std::memory_order_release);
+    num_flows_.fetch_add(added, std::memory_order_relaxed);
+
+    epoch_.retire([old_root, replaced] {
+        for (const flow_shard* s : replaced) flow_shard::destroy(s);
+        delete old_root;
+    });
+    epoch_.reclaim();
+}
+
+path_store::flow_entry* path_store::probe(flow_shard* shard, const flow_key& key) {
+    for (uint32_t i = slot_of(key);; ++i) {
+        flow_entry& e = shard->slots()[i & shard->mask];
+        if (!e.path || e.key == key) return &e;
+    }
+}
+
+const path_store::flow_entry* path_store::find_entry(const flow_shard* shard,
+                                                     const flow_key& key) {
+    if (!shard) return nullptr;
+    for (uint32_t i = slot_of(key);; ++i) {
+        const flow_entry& e = shard->slots()[i & shard->mask];
+        if (!e.path) return nullptr;
+        if (e.key == key) return &e;
+    }
+}
+
+bool path_store::lookup(const flow_key& key, std::vector<uint16_t>& path) const {
+    epoch_domain::guard g(epoch_);
+    const flow_root* root = root_.load(std::memory_order_acquire);
+    const flow_entry* e = find_entry(root->shards[shard_of(key)], key);
+    if (!e) return false;
+    path = *e->path;
+    return true;
+}
+
+bool path_store::path_id(const flow_key& key, uint32_t& id) const {
+    epoch_domain::guard g(epoch_);
+    const flow_root* root = root_.load(std::memory_order_acquire);
+    const flow_entry* e = find_entry(root->shards[shard_of(key)], key);
+    if (!e) return false;
+    id = e->path_id;
+    return true;
+}
+
+const std::vector<uint16_t>* path_store::find(const flow_key& key) const {
+    epoch_domain::guard g(epoch_);
+    const flow_root* root = root_.load(std::memory_order_acquire);
+    const flow_entry* e = find_entry(root->shards[shard_of(key)], key);
+    return e ? e->path : nullptr;
+}
+
+std::vector<uint16_t> path_store::path(uint32_t id) const {
+    if (id >= num_paths()) return {};
+    return stored_path(id);
+}
+
+compressed_bitmap path_store::paths_through(uint16_t switch_id, int hop) const {
+    std::lock_guard<std::mutex> lock(mu_);
+    auto it = index_.find(index_key(switch_id, hop));
+    return it == index_.end() ? compressed_bitmap{} : it->second;
+}
+
+void path_store::append_flows(const compressed_bitmap& ids,
+                              std::vector<flow_key>& out) const {
+    ids.for_each([&](uint32_t id) {
+        const std::vector<flow_key>& flows = flows_by_path_[id];
+        out.insert(out.end(), flows.begin(), flows.end());
+    });
+}
+
+void path_store::flows_through(uint16_t switch_id, int hop,
+                               std::vector<flow_key>& out) const {
+    std::lock_guard<std::mutex> lock(mu_);
+    auto it = index_.find(index_key(switch_id, hop));
+    if (it != index_.end()) append_flows(it->second, out);
+}
+
+void path_store::flows_through_all(const std::vector<std::pair<uint16_t, int>>& hops,
+                                   std::vector<flow_key>& out) const {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (hops.empty()) return;
+
+    // Intersect smallest-first so intermediate results stay small
+    std::vector<const compressed_bitmap*> sets;
+    for (const auto& h : hops) {
+        auto it = index_.find(index_key(h.first, h.second));
+        if (it == index_.end()) return;
+        sets.push_back(&it->second);
+    }
+    std::sort(sets.begin(), sets.end(),
+              [](const compressed_bitmap* x, const compressed_bitmap* y) {
+                  return x->cardinality() < y->cardinality();
+              });
+    if (sets.size() == 1) {
+        append_flows(*sets[0], out);
+        return;
+    }
+
+    compressed_bitmap acc = compressed_bitmap::intersect(*sets[0], *sets[1]);
+    for (size_t i = 2; i < sets.size() && !acc.empty(); ++i) {
+        acc = compressed_bitmap::intersect(acc, *sets[i]);
+    }
+    append_flows(acc, out);
+}
+
+// A walk of the current root, lock-free like the lookups, so it also
+// works in a forked child whatever the parent's writers held
+void path_store::all_flows(std::vector<std::pair<flow_key, uint32_t>>& out) const {
+    epoch_domain::guard g(epoch_);
+    const flow_root* root = root_.load(std::memory_order_acquire);
+    for (const flow_shard* s : root->shards) {
+        if (!s) continue;
+        for (uint32_t i = 0; i <= s->mask; ++i) {
+            const flow_entry& e = s->slots()[i];
+            if (e.path) out.emplace_back(e.key, e.path_id);
+        }
+    }
+}
+
+bool path_store::path_by_fingerprint(uint64_t fp, uint32_t& id) const {
+    std::lock_guard<std::mutex> lock(mu_);
+    auto it = by_fp_.find(fp);
+    if (it == by_fp_.end() || it->second.empty()) return false;
+    id = it->second.front();
+    return true;
+}
+
+size_t path_store::index_bytes() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    size_t n = 0;
+    for (const auto& kv : index_) n += sizeof(kv) + kv.second.memory_bytes();
+    return n;
+}
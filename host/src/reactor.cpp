@@ -0,0 +1,144 @@
+// src/reactor.cpp
+#include "reactor.hpp"
+
+#ifndef __linux__
+#error "reactor.cpp requires Linux (epoll)."
+#endif
+
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+
+reactor::reactor(int inline_ops) : inline_limit_(inline_ops) {
+    epfd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd_ < 0) perror("[reactor] epoll_create1");
+}
+
+reactor::~reactor() {
+    if (epfd_ >= 0) close(epfd_);
+}
+
+void reactor::spawn(task t) {
+    std::coroutine_handle<task::promise_type> h = std::exchange(t.h_, {});
+    resume(h);
+}
+
+void reactor::wait(int fd, bool for_write, io_waiter* w) {
+    auto it = fds_.find(fd);
+    if (it == fds_.end()) {
+        // Both directions, edge-triggered, once per socket
+        struct epoll_event ev{};
+        ev.events  = EPOLLIN | EPOLLOUT | EPOLLET;
+        ev.data.fd = fd;
+        if (epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &ev) < 0) perror("[reactor] epoll_ctl");
+        it = fds_.emplace(fd, fd_waiters{}).first;
+    }
+    (for_write ? it->second.writer : it->second.reader) = w;
+    ++io_waiting_;
+}
+
+// Counts as waiting, so run() keeps going
+void reactor::defer(int fd, bool for_write, io_waiter* w) {
+    ready_.push_back(deferred{fd, for_write, w});
+    ++io_waiting_;
+}
+
+void reactor::forget(int fd) {
+    for (auto it = ready_.begin(); it != ready_.end();) {
+        if (it->fd != fd) {
+            ++it;
+            continue;
+        }
+        it = ready_.erase(it);
+        --io_waiting_;
+    }
+    auto it = fds_.find(fd);
+    if (it == fds_.end()) return;
+    io_waiting_ -= (it->second.reader != nullptr) + (it->second.writer != nullptr);
+    fds_.erase(it);
+    epoll_ctl(epfd_, EPOLL_CTL_DEL, fd, nullptr);
+}
+
+void reactor::add_timer(clock::time_point t, std::coroutine_handle<> h) {
+    timers_.push(timer{t, timer_seq_++, h});
+}
+
+// Resuming may register other sockets (rehashing fds_), so no
+// reference into fds_ is held across a resume
+void reactor::dispatch(int fd, uint32_t events) {
+    for (bool for_write : {false, true}) {
+        uint32_t mask = for_write ? EPOLLOUT : EPOLLIN;
+        auto it = fds_.find(fd);
+        if (it == fds_.end() || !(events & (mask | EPOLLERR | EPOLLHUP))) continue;
+        io_waiter*& slot = for_write ? it->second.writer : it->second.reader;
+        io_waiter* w = slot;
+        if (!w || !w->attempt()) continue;
+        slot = nullptr;
+        --io_waiting_;
+        resume(w->waiter);
+    }
+}
+
+void reactor::fire_timers() {
+    clock::time_point now = clock::now();
+    while (!stopped_ && !timers_.empty() && timers_.top().when <= now) {
+        std::coroutine_handle<> h = timers_.top().h;
+        timers_.pop();
+        resume(h);
+    }
+}
+
+// Deferred awaitables retry their syscall; still EAGAIN means a wait on
+// the socket like any other. Entries deferred meanwhile go next round.
+void reactor::run_ready() {
+    for (size_t n = ready_.size(); n > 0 && !stopped_ && !ready_.empty(); --n) {
+        deferred d = ready_.front();
+        ready_.pop_front();
+        --io_waiting_;
+        if (d.w->attempt()) resume(d.w->waiter);
+        else                wait(d.fd, d.for_write, d.w);
+    }
+}
+
+void reactor::run() {
+    struct epoll_event events[64];
+    while (!stopped_ && (io_waiting_ > 0 || !timers_.empty())) {
+        int timeout = -1;
+        if (!ready_.empty()) {
+            timeout = 0;
+        } else if (!timers_.empty()) {
+            auto wait = timers_.top().when - clock::now();
+            // Round up so a timer is never polled for before it is due
+            auto ms = std::chrono::ceil<std::chrono::milliseconds>(wait).count();
+            timeout = ms < 0 ? 0 : static_cast<int>(ms);
+        }
+        int n = epoll_wait(epfd_, events, 64, timeout);
+        if (n < 0 && errno != EINTR) {
+            perror("[reactor] epoll_wait");
+            return;
+        }
+        for (int i = 0; i < n && !stopped_; ++i) dispatch(events[i].data.fd, events[i].events);
+        fire_timers();
+        run_ready();
+    }
+}
+
+// -------------------------------------------------------------------
+// Socket awaitables
+// -------------------------------------------------------------------
+
+bool async_recv::attempt() {
+    ssize_t n = recv(fd_, buf_, len_, MSG_DONTWAIT);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return false;
+    result_ = n < 0 ? -errno : n;
+    return true;
+}
+
+bool async_sendto::attempt() {
+    ssize_t n = sendto(fd_, buf_, len_, MSG_DONTWAIT, addr_, addrlen_);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return false;
+    result_ = n < 0 ? -errno : n;
+    return true;
+}
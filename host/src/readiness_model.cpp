@@ -0,0 +1,153 @@
+// src/readiness_model.cpp
+#include "readiness_model.hpp"
+
+#include "snapshot.hpp"
+#include "xor_codebook.hpp"
+
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <random>
+
+// Cells seen fewer times than this use the rank-only mean
+constexpr long READINESS_MIN_SAMPLES = 8;
+
+bool readiness_model::build(const apa_t& apa, int num_hops, int trials,
+                            long max_packets, uint32_t seed) {
+    num_hops_    = num_hops;
+    fingerprint_ = apa_fingerprint(apa, num_hops);
+    size_t cells = static_cast<size_t>(num_hops + 1) * (num_hops + 1);
+    std::vector<double> rank_sum(static_cast<size_t>(num_hops + 1), 0.0);
+    std::vector<long>   rank_cnt(static_cast<size_t>(num_hops + 1), 0);
+    std::vector<double> cell_sum(cells, 0.0);
+    std::vector<long>   cell_cnt(cells, 0);
+
+    std::mt19937 rng(seed);
+    std::vector<uint16_t> ids(static_cast<size_t>(num_hops), 0);
+    std::vector<std::pair<int, int>> trace;
+    int decoded = 0;
+
+    for (int t = 0; t < trials; ++t) {
+        // Rank only depends on the xor_sets, so switch IDs can stay 0.
+        uint32_t salt = static_cast<uint32_t>(rng());
+        rank_monitor mon(num_hops);
+        readiness_tracker tr(num_hops);
+        trace.clear();
+
+        long n = 0;
+        while (!mon.solved() && n < max_packets) {
+            trace.emplace_back(mon.rank(), tr.uncovered);
+            ++n;
+            packet_equation eq = encode_packet(
+                apa, mix32(salt ^ mix32(static_cast<uint32_t>(n))), ids);
+            mon.add_equation(eq);
+            tr.observe(eq.xor_set);
+        }
+        if (!mon.solved()) continue;
+        ++decoded;
+
+        // trace[i] is the state before packet i+1; n - i packets remained
+        for (size_t i = 0; i < trace.size(); ++i) {
+            double remaining = static_cast<double>(n - static_cast<long>(i));
+            rank_sum[trace[i].first] += remaining;
+            ++rank_cnt[trace[i].first];
+            size_t c = cell(trace[i].first, trace[i].second);
+            cell_sum[c] += remaining;
+            ++cell_cnt[c];
+        }
+    }
+
+    by_rank_.assign(static_cast<size_t>(num_hops + 1), 0.0);
+    by_cell_.assign(cells, -1.0);
+    for (int r = 0; r < num_hops; ++r) {
+        by_rank_[r] = rank_cnt[r] ? rank_sum[r] / rank_cnt[r] : 0.0;
+    }
+    // Ranks never observed (skipped in one step) inherit the next one
+    for (int r = num_hops - 1; r >= 0; --r) {
+        if (rank_cnt[r] == 0 && r + 1 < num_hops) by_rank_[r] = by_rank_[r + 1];
+    }
+    for (size_t c = 0; c < cells; ++c) {
+        if (cell_cnt[c] >= READINESS_MIN_SAMPLES) by_cell_[c] = cell_sum[c] / cell_cnt[c];
+    }
+    return decoded > 0;
+}
+
+double readiness_model::expected_remaining(int rank) const {
+    if (rank >= num_hops_) return 0.0;
+    return by_rank_[rank];
+}
+
+double readiness_model::expected_remaining(int rank, int uncovered) const {
+    if (rank >= num_hops_) return 0.0;
+    double v = by_cell_[cell(rank, uncovered)];
+    return v >= 0.0 ? v : by_rank_[rank];
+}
+
+// Section layout: fingerprint, num_hops, then by_rank_ and by_cell_ as
+// raw doubles.
+bool readiness_model::save(const std::string& path) const {
+    if (by_rank_.empty()) return false;
+    snapshot_writer w;
+    std::vector<uint8_t>& out = w.section(SNAP_READINESS);
+    uint64_t hops = static_cast<uint64_t>(num_hops_);
+    snapshot_put(out, &fingerprint_);
+    snapshot_put(out, &hops);
+    // doubles go out as their bit patterns (snapshot_put wants integers)
+    std::vector<uint64_t> bits(by_rank_.size() + by_cell_.size());
+    std::memcpy(bits.data(), by_rank_.data(), by_rank_.size() * sizeof(double));
+    std::memcpy(bits.data() + by_rank_.size(), by_cell_.data(),
+                by_cell_.size() * sizeof(double));
+    snapshot_put(out, bits.data(), bits.size());
+    return w.commit(path, 0);
+}
+
+bool readiness_model::load(const std::string& path, const apa_t& apa, int num_hops) {
+    snapshot_reader r;
+    snapshot_cursor cur;
+    if (!r.open(path) || !r.find(SNAP_READINESS, cur)) return false;
+
+    uint64_t fp = 0, hops = 0;
+    if (!cur.get(&fp) || !cur.get(&hops)) return false;
+    if (hops != static_cast<uint64_t>(num_hops) || fp != apa_fingerprint(apa, num_hops)) {
+        std::cerr << "[readiness] " << path << " was built for another APA, ignoring it\n";
+        return false;
+    }
+    size_t rows = static_cast<size_t>(num_hops) + 1;
+    std::vector<double> by_rank(rows), by_cell(rows * rows);
+    if (!cur.get(by_rank.data(), by_rank.size()) ||
+        !cur.get(by_cell.data(), by_cell.size()) || !cur.done()) {
+        std::cerr << "[readiness] " << path << " is corrupt\n";
+        return false;
+    }
+    num_hops_    = num_hops;
+    fingerprint_ = fp;
+    by_rank_     = std::move(by_rank);
+    by_cell_     = std::move(by_cell);
+    return true;
+}
+
+std::shared_ptr<const readiness_model> readiness_model::shared(const apa_t& apa, int num_hops,
+                                                               const std::string& table) {
+    static std::mutex mu;
+    static std::map<uint64_t, std::shared_ptr<const readiness_model>> models;
+
+    // Same key as the codebook: the fingerprint covers num_hops
+    uint64_t fp = apa_fingerprint(apa, num_hops);
+    std::lock_guard<std::mutex> lock(mu);
+    auto it = models.find(fp);
+    if (it != models.end()) return it->second;
+
+    auto model = std::make_shared<readiness_model>();
+    if (table.empty() || !model->load(table, apa, num_hops)) {
+        if (!model->build(apa, num_hops, READINESS_TRIALS, READINESS_MAX_PACKETS,
+                          READINESS_SEED)) {
+            return nullptr;
+        }
+        if (!table.empty() && !model->save(table)) {
+            std::cerr << "[readiness] Cannot save " << table << "\n";
+        }
+    }
+    models.emplace(fp, model);
+    return model;
+}
@@ -0,0 +1,225 @@
+// src/recipe_decoder.cpp
+#include "recipe_decoder.hpp"
+#include "apa_image.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// recipe_hash.csv row r, column h (what the fixed-hash controller loads
+// into find_hash) is recipe_hash_v4(r + 1, h)
+static_assert(recipe_hash_v4(1, 0)      == 1202584767u);
+static_assert(recipe_hash_v4(1, 1)      == 1062183199u);
+static_assert(recipe_hash_v4(1, 255)    == 529544452u);
+static_assert(recipe_hash_v4(2, 0)      == 3360623454u);
+static_assert(recipe_hash_v4(1000, 128) == 139498016u);
+static_assert(recipe_hash_v4(2000, 255) == 1257863069u);
+
+bool load_apa(const std::string& path, apa_t& apa, int max_degree) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << "[decoder] Cannot open APA file " << path << "\n";
+        return false;
+    }
+
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.find_first_not_of(" \t\r\n") == std::string::npos) continue;
+        lines.push_back(line);
+    }
+
+    apa.max_hops   = static_cast<int>(lines.size());
+    apa.max_degree = max_degree;
+    apa.add_thresh.assign(static_cast<size_t>(apa.max_hops) * max_degree, 0);
+    apa.replace_thresh.assign(static_cast<size_t>(apa.max_hops) * max_degree, 0);
+    apa.image = nullptr;
+
+    for (int hop = 0; hop < apa.max_hops; ++hop) {
+        std::vector<double> parts;
+        std::stringstream ss(lines[hop]);
+        std::string cell;
+        while (std::getline(ss, cell, ',')) {
+            if (cell.find_first_not_of(" \t\r\n") == std::string::npos) continue;
+            parts.push_back(std::stod(cell));
+        }
+        if (parts.size() % 2 != 0) {
+            std::cerr << "[decoder] Line " << hop << " in " << path
+                      << " has odd number of columns: " << parts.size() << "\n";
+            return false;
+        }
+        int num_degrees = static_cast<int>(parts.size() / 2);
+        if (num_degrees > max_degree) {
+            std::cerr << "[decoder] Line " << hop << " has " << num_degrees
+                      << " degrees, but max_degree=" << max_degree << "\n";
+            return false;
+        }
+        for (int d = 0; d < num_degrees; ++d) {
+            size_t idx = static_cast<size_t>(hop) * max_degree + d;
+            // Scale probabilities to 32-bit threshold space (mod 2^32,
+            // as in decoding_murmur.py)
+            apa.add_thresh[idx] = static_cast<uint32_t>(
+                static_cast<uint64_t>(parts[2 * d] * 4294967296.0));
+            apa.replace_thresh[idx] = static_cast<uint32_t>(
+                static_cast<uint64_t>(parts[2 * d + 1] * 4294967296.0));
+        }
+    }
+    apa.image = find_apa_image(apa);
+    return true;
+}
+
+hop_mask reconstruct_xor_set(const apa_t& apa, int num_hops, uint32_t pktid) {
+    if (apa.image && num_hops <= apa.image->hops) return apa.image->replay_v4(num_hops, pktid);
+    return replay_xor_set(apa, num_hops, [pktid](int hop) {
+        return recipe_hash_v4(pktid, static_cast<uint32_t>(hop));
+    });
+}
+
+packet_equation encode_packet(const apa_t& apa, uint32_t pktid,
+                              const std::vector<uint16_t>& switch_ids) {
+    packet_equation eq;
+    eq.pktid   = pktid;
+    eq.xor_set = reconstruct_xor_set(apa, static_cast<int>(switch_ids.size()), pktid);
+    for (int hop = eq.xor_set.lowest(); hop >= 0 && hop < static_cast<int>(switch_ids.size()); ++hop) {
+        if (eq.xor_set.test(hop)) eq.pint ^= switch_ids[hop];
+    }
+    return eq;
+}
+
+// -------------------------------------------------------------------
+// online_decoder
+// -------------------------------------------------------------------
+
+online_decoder::online_decoder(int num_hops)
+    : num_hops_(num_hops),
+      rows_(static_cast<size_t>(num_hops)),
+      rhs_(static_cast<size_t>(num_hops), 0) {}
+
+void online_decoder::reset() {
+    rank_         = 0;
+    inconsistent_ = false;
+    pivots_       = hop_mask{};
+}
+
+bool online_decoder::add_equation(const hop_mask& xor_set, uint16_t pint) {
+    hop_mask row = xor_set;
+    uint16_t rhs = pint;
+
+    // Reduce against existing pivots in increasing column order; each
+    // basis row only has bits at or above its pivot, so one pass suffices.
+    for (int col = row.lowest(); col >= 0; col = row.lowest()) {
+        if (col >= num_hops_) break;
+        if (!pivots_.test(col)) {
+            rows_[col] = row;
+            rhs_[col]  = rhs;
+            pivots_.set(col);
+            ++rank_;
+            return true;
+        }
+        row ^= rows_[col];
+        rhs ^= rhs_[col];
+    }
+
+    if (row.empty() && rhs != 0) inconsistent_ = true;
+    return false;
+}
+
+bool online_decoder::solve(std::vector<uint16_t>& switch_ids) const {
+    if (!solved() || inconsistent_) return false;
+
+    switch_ids.assign(static_cast<size_t>(num_hops_), 0);
+    // Rows are upper triangular (pivot = lowest bit), so resolve from the
+    // last hop backwards.
+    for (int col = num_hops_ - 1; col >= 0; --col) {
+        uint16_t v = rhs_[col];
+        const hop_mask& row = rows_[col];
+        for (int j = col + 1; j < num_hops_; ++j) {
+            if (row.test(j)) v ^= switch_ids[j];
+        }
+        switch_ids[col] = v;
+    }
+    return true;
+}
+
+void online_decoder::save(std::vector<uint8_t>& out) const {
+    int32_t  head[2] = {num_hops_, rank_};
+    uint32_t bad     = inconsistent_ ? 1 : 0;
+    snapshot_put(out, head, 2);
+    snapshot_put(out, &bad);
+    snapshot_put(out, &pivots_);
+    for (int col = 0; col < num_hops_; ++col) {
+        if (!pivots_.test(col)) continue;
+        snapshot_put(out, &rows_[col]);
+        snapshot_put(out, &rhs_[col]);
+    }
+}
+
+bool online_decoder::load(snapshot_cursor& in) {
+    int32_t  head[2];
+    uint32_t bad;
+    hop_mask pivots;
+    if (!in.get(head, 2) || !in.get(&bad) || !in.get(&pivots)) return false;
+    if (head[0] != num_hops_ || head[1] != pivots.count()) return false;
+
+    for (int col = 0; col < num_hops_; ++col) {
+        if (!pivots.test(col)) continue;
+        if (!in.get(&rows_[col]) || !in.get(&rhs_[col])) return false;
+    }
+    pivots_       = pivots;
+    rank_         = head[1];
+    inconsistent_ = bad != 0;
+    return true;
+}
+
+// -------------------------------------------------------------------
+// rank_monitor
+// -------------------------------------------------------------------
+
+rank_monitor::rank_monitor(int num_hops)
+    : num_hops_(num_hops), rows_(static_cast<size_t>(num_hops)) {
+    basis_eqs_.reserve(static_cast<size_t>(num_hops));
+}
+
+void rank_monitor::reset() {
+    pivots_ = hop_mask{};
+    basis_eqs_.clear();
+}
+
+bool rank_monitor::add_equation(const packet_equation& eq) {
+    // Nothing left to learn once decodable; no consistency checks here.
+    if (solved()) return false;
+
+    hop_mask row = eq.xor_set;
+    for (int col = row.lowest(); col >= 0; col = row.lowest()) {
+        if (col >= num_hops_) break;
+        if (!pivots_.test(col)) {
+            rows_[col] = row;
+            pivots_.set(col);
+            basis_eqs_.push_back(eq);
+            return true;
+        }
+        row ^= rows_[col];
+    }
+    return false;
+}
+
+bool rank_monitor::solve(std::vector<uint16_t>& switch_ids) const {
+    if (!solved()) return false;
+    online_decoder dec(num_hops_);
+    for (const auto& eq : basis_eqs_) dec.add_equation(eq);
+    return dec.solve(switch_ids);
+}
+
+bool solve_switch_ids(const std::vector<packet_equation>& eqs, int num_hops,
+                      std::vector<uint16_t>& switch_ids) {
+    online_decoder dec(num_hops);
+    for (const auto& eq : eqs) {
+        dec.add_equation(eq);
+        if (dec.solved()) break;
+    }
+    if (!dec.consistent()) {
+        std::cerr << "[decoder] System inconsistent, no solution.\n";
+        return false;
+    }
+    return dec.solve(switch_ids);
+}
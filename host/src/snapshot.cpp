@@ -0,0 +1,192 @@
+// src/snapshot.cpp
+#include "snapshot.hpp"
+
+#ifndef __linux__
+#error "snapshot.cpp requires Linux (mmap)."
+#endif
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <iostream>
+
+static size_t align8(size_t n) { return (n + 7) & ~static_cast<size_t>(7); }
+
+// Word-wise, then bytewise for the tail.
+uint64_t snapshot_checksum(const uint8_t* p, size_t n) {
+    uint64_t h = 0xCBF29CE484222325ull;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t w;
+        std::memcpy(&w, p + i, 8);
+        h = (h ^ w) * 0x100000001B3ull;
+        h ^= h >> 29;
+    }
+    for (; i < n; ++i) h = (h ^ p[i]) * 0x100000001B3ull;
+    return h;
+}
+
+static bool sync_parent_dir(const std::string& path) {
+    size_t slash = path.rfind('/');
+    std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0) {
+        perror("[snapshot] open dir");
+        return false;
+    }
+    bool ok = fsync(fd) == 0;
+    if (!ok) perror("[snapshot] fsync dir");
+    ::close(fd);
+    return ok;
+}
+
+// -------------------------------------------------------------------
+// snapshot_writer
+// -------------------------------------------------------------------
+
+std::vector<uint8_t>& snapshot_writer::section(uint32_t id) {
+    sections_.emplace_back(id, std::vector<uint8_t>());
+    return sections_.back().second;
+}
+
+bool snapshot_writer::commit(const std::string& path, uint64_t generation) {
+    size_t table = sizeof(snapshot_h) + sections_.size() * sizeof(snapshot_section_h);
+    size_t total = align8(table);
+    for (const auto& s : sections_) total += align8(s.second.size());
+
+    std::string tmp = path + ".tmp";
+    int fd = ::open(tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror("[snapshot] open");
+        return false;
+    }
+    if (ftruncate(fd, static_cast<off_t>(total)) < 0) {
+        perror("[snapshot] ftruncate");
+        ::close(fd);
+        return false;
+    }
+    void* mem = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mem == MAP_FAILED) {
+        perror("[snapshot] mmap");
+        ::close(fd);
+        return false;
+    }
+
+    // ftruncate zero-fills, so alignment padding is already 0
+    uint8_t* base = static_cast<uint8_t*>(mem);
+    auto* sec = reinterpret_cast<snapshot_section_h*>(base + sizeof(snapshot_h));
+    size_t off = align8(table);
+    for (size_t i = 0; i < sections_.size(); ++i) {
+        const std::vector<uint8_t>& data = sections_[i].second;
+        snapshot_section_h sh{sections_[i].first, 0, off, data.size(),
+                              snapshot_checksum(data.data(), data.size())};
+        std::memcpy(&sec[i], &sh, sizeof(sh));
+        if (!data.empty()) std::memcpy(base + off, data.data(), data.size());
+        off += align8(data.size());
+    }
+
+    snapshot_h hdr{};
+    hdr.magic        = SNAPSHOT_MAGIC;
+    hdr.version      = SNAPSHOT_VERSION;
+    hdr.num_sections = static_cast<uint32_t>(sections_.size());
+    hdr.generation   = generation;
+    hdr.bytes        = total;
+    hdr.checksum     = snapshot_checksum(base + sizeof(hdr), table - sizeof(hdr));
+    std::memcpy(base, &hdr, sizeof(hdr));
+
+    bool ok = msync(mem, total, MS_SYNC) == 0;
+    if (!ok) perror("[snapshot] msync");
+    munmap(mem, total);
+    ::close(fd);
+    sections_.clear();
+
+    if (ok && rename(tmp.c_str(), path.c_str()) < 0) {
+        perror("[snapshot] rename");
+        ok = false;
+    }
+    if (!ok) {
+        unlink(tmp.c_str());
+        return false;
+    }
+    // The rename itself is only durable once the directory is synced
+    return sync_parent_dir(path);
+}
+
+// -------------------------------------------------------------------
+// snapshot_reader
+// -------------------------------------------------------------------
+
+bool snapshot_reader::open(const std::string& path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;   // no snapshot yet
+
+    struct stat st{};
+    if (fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) < sizeof(snapshot_h)) {
+        ::close(fd);
+        std::cerr << "[snapshot] " << path << " is truncated, ignoring\n";
+        return false;
+    }
+    size_t n  = static_cast<size_t>(st.st_size);
+    void* mem = mmap(nullptr, n, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mem == MAP_FAILED) {
+        perror("[snapshot] mmap");
+        return false;
+    }
+    // Sections are read on demand, some of them sparsely
+    base_  = static_cast<const uint8_t*>(mem);
+    bytes_ = n;
+
+    snapshot_h hdr;
+    std::memcpy(&hdr, base_, sizeof(hdr));
+    size_t table = sizeof(hdr) + static_cast<size_t>(hdr.num_sections) *
+                                     sizeof(snapshot_section_h);
+    bool ok = hdr.magic == SNAPSHOT_MAGIC && hdr.version == SNAPSHOT_VERSION &&
+              hdr.bytes == n && table <= n &&
+              hdr.checksum == snapshot_checksum(base_ + sizeof(hdr), table - sizeof(hdr));
+    for (uint32_t i = 0; ok && i < hdr.num_sections; ++i) {
+        snapshot_section_h sh;
+        std::memcpy(&sh, base_ + sizeof(hdr) + i * sizeof(sh), sizeof(sh));
+        ok = sh.offset <= n && sh.bytes <= n - sh.offset;
+    }
+    if (!ok) {
+        std::cerr << "[snapshot] " << path << " is corrupt, ignoring\n";
+        close();
+    }
+    return ok;
+}
+
+void snapshot_reader::close() {
+    if (base_) munmap(const_cast<uint8_t*>(base_), bytes_);
+    base_  = nullptr;
+    bytes_ = 0;
+}
+
+bool snapshot_reader::find(uint32_t id, snapshot_cursor& cur, bool verify) const {
+    if (!base_) return false;
+    snapshot_h hdr;
+    std::memcpy(&hdr, base_, sizeof(hdr));
+    for (uint32_t i = 0; i < hdr.num_sections; ++i) {
+        snapshot_section_h sh;
+        std::memcpy(&sh, base_ + sizeof(hdr) + i * sizeof(sh), sizeof(sh));
+        if (sh.id != id) continue;
+        if (verify && sh.checksum != snapshot_checksum(base_ + sh.offset, sh.bytes)) {
+            std::cerr << "[snapshot] section " << id << " is corrupt, ignoring\n";
+            return false;
+        }
+        cur = snapshot_cursor(base_ + sh.offset, sh.bytes);
+        return true;
+    }
+    return false;
+}
+
+uint64_t snapshot_reader::generation() const {
+    if (!base_) return 0;
+    snapshot_h hdr;
+    std::memcpy(&hdr, base_, sizeof(hdr));
+    return hdr.generation;
+}
@@ -9,15 +9,18 @@
 #include <linux/if_packet.h>
 #include <net/ethernet.h>
 #include <net/if.h>
+#include <poll.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <cerrno>
 #include <cstring>
 #include <iostream>
 
-int open_raw_socket(const std::string& ifname, int& ifindex_out) {
-    int sockfd = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+int open_raw_socket(const std::string& ifname, int& ifindex_out, uint16_t protocol) {
+    int sockfd = socket(AF_PACKET, SOCK_RAW, htons(protocol));
     if (sockfd < 0) {
         perror("socket");
         return -1;
@@ -36,7 +39,7 @@ int open_raw_socket(const std::string& ifname, int& ifindex_out) {
 
     struct sockaddr_ll addr{};
     addr.sll_family   = AF_PACKET;
-    addr.sll_protocol = htons(ETH_P_ALL);
+    addr.sll_protocol = htons(protocol);
     addr.sll_ifindex  = ifindex_out;
 
     if (bind(sockfd, reinterpret_cast<struct sockaddr*>(&addr),
@@ -78,4 +81,151 @@ bool recv_frame(int sockfd, std::vector<uint8_t>& buffer) {
     }
     buffer.resize(static_cast<size_t>(n));
     return true;
-}
\ No newline at end of file
+}
+
+// -------------------------------------------------------------------
+// socket and mmsg transports
+// -------------------------------------------------------------------
+
+// Waits for the socket to become readable; false on timeout or error
+static bool wait_readable(int sockfd, int timeout_ms) {
+    struct pollfd pfd{sockfd, POLLIN, 0};
+    int n = poll(&pfd, 1, timeout_ms);
+    if (n < 0 && errno != EINTR) perror("poll");
+    return n > 0;
+}
+
+// The frame carries its own Ethernet header, so the address only
+// names the interface
+static struct sockaddr_ll interface_addr(int ifindex) {
+    struct sockaddr_ll addr{};
+    addr.sll_family  = AF_PACKET;
+    addr.sll_ifindex = ifindex;
+    addr.sll_halen   = ETH_ALEN;
+    return addr;
+}
+
+class socket_transport : public frame_transport {
+public:
+    socket_transport(int sockfd, int ifindex, const transport_options& opt)
+        : sockfd_(sockfd), addr_(interface_addr(ifindex)), frame_size_(opt.frame_size),
+          bufs_(opt.frames * opt.frame_size) {}
+
+    int recv_batch(std::vector<frame_view>& out, size_t max, int timeout_ms) override {
+        if (max > bufs_.size() / frame_size_) max = bufs_.size() / frame_size_;
+        int got = 0;
+        for (size_t i = 0; i < max; ++i) {
+            uint8_t* buf = bufs_.data() + i * frame_size_;
+            ssize_t n = recv(sockfd_, buf, frame_size_, MSG_DONTWAIT);
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && got == 0 &&
+                timeout_ms != 0 && wait_readable(sockfd_, timeout_ms)) {
+                n = recv(sockfd_, buf, frame_size_, MSG_DONTWAIT);
+            }
+            if (n < 0) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    perror("recv");
+                    return got > 0 ? got : -1;
+                }
+                break;
+            }
+            out.push_back(frame_view{buf, static_cast<size_t>(n)});
+            ++got;
+        }
+        return got;
+    }
+
+    int send_batch(const std::vector<frame_view>& frames) override {
+        int sent = 0;
+        for (const auto& f : frames) {
+            if (sendto(sockfd_, f.data, f.len, 0, reinterpret_cast<struct sockaddr*>(&addr_),
+                       sizeof(addr_)) < 0) {
+                perror("sendto");
+                break;
+            }
+            ++sent;
+        }
+        return sent;
+    }
+
+    const char* name() const override { return "socket"; }
+
+private:
+    int sockfd_;
+    struct sockaddr_ll addr_;
+    size_t frame_size_;
+    std::vector<uint8_t> bufs_;
+};
+
+class mmsg_transport : public frame_transport {
+public:
+    mmsg_transport(int sockfd, int ifindex, const transport_options& opt)
+        : sockfd_(sockfd), addr_(interface_addr(ifindex)), frame_size_(opt.frame_size),
+          bufs_(opt.frames * opt.frame_size), iov_(opt.frames), msgs_(opt.frames) {}
+
+    int recv_batch(std::vector<frame_view>& out, size_t max, int timeout_ms) override {
+        if (max > msgs_.size()) max = msgs_.size();
+        for (size_t i = 0; i < max; ++i) {
+            iov_[i] = {bufs_.data() + i * frame_size_, frame_size_};
+            msgs_[i] = {};
+            msgs_[i].msg_hdr.msg_iov    = &iov_[i];
+            msgs_[i].msg_hdr.msg_iovlen = 1;
+        }
+        int n = recvmmsg(sockfd_, msgs_.data(), static_cast<unsigned>(max), MSG_DONTWAIT,
+                         nullptr);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && timeout_ms != 0 &&
+            wait_readable(sockfd_, timeout_ms)) {
+            n = recvmmsg(sockfd_, msgs_.data(), static_cast<unsigned>(max), MSG_DONTWAIT,
+                         nullptr);
+        }
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+            perror("recvmmsg");
+            return -1;
+        }
+        for (int i = 0; i < n; ++i) {
+            out.push_back(frame_view{static_cast<uint8_t*>(iov_[i].iov_base), msgs_[i].msg_len});
+        }
+        return n;
+    }
+
+    int send_batch(const std::vector<frame_view>& frames) override {
+        int sent = 0;
+        while (static_cast<size_t>(sent) < frames.size()) {
+            size_t n = std::min(frames.size() - sent, msgs_.size());
+            for (size_t i = 0; i < n; ++i) {
+                iov_[i]  = {frames[sent + i].data, frames[sent + i].len};
+                msgs_[i] = {};
+                msgs_[i].msg_hdr.msg_name    = &addr_;
+                msgs_[i].msg_hdr.msg_namelen = sizeof(addr_);
+                msgs_[i].msg_hdr.msg_iov     = &iov_[i];
+                msgs_[i].msg_hdr.msg_iovlen  = 1;
+            }
+            int k = sendmmsg(sockfd_, msgs_.data(), static_cast<unsigned>(n), 0);
+            if (k <= 0) {
+                perror("sendmmsg");
+                break;
+            }
+            sent += k;
+        }
+        return sent;
+    }
+
+    const char* name() const override { return "mmsg"; }
+
+private:
+    int sockfd_;
+    struct sockaddr_ll addr_;
+    size_t frame_size_;
+    std::vector<uint8_t> bufs_;
+    std::vector<struct iovec> iov_;
+    std::vector<struct mmsghdr> msgs_;
+};
+
+std::unique_ptr<frame_transport> make_transport(const std::string& kind, int sockfd,
+                                                int ifindex, const transport_options& opt) {
+    if (kind == "socket") return std::make_unique<socket_transport>(sockfd, ifindex, opt);
+    if (kind == "mmsg")   return std::make_unique<mmsg_transport>(sockfd, ifindex, opt);
+    if (kind == "uring")  return make_uring_transport(sockfd, ifindex, opt);
+    std::cerr << "[transport] Unknown backend " << kind << " (socket, mmsg, uring)\n";
+    return nullptr;
+}
@@ -0,0 +1,354 @@
+// src/uring_transport.cpp
+//
+// io_uring frame_transport, driven through the raw syscalls and the ring
+// layout of <linux/io_uring.h> (no liburing). Needs Linux 6.0+ for
+// multishot recv with provided-buffer rings.
+#include "socket_utils.hpp"
+
+#ifndef __linux__
+#error "uring_transport.cpp requires Linux (io_uring)."
+#endif
+
+#include <linux/io_uring.h>
+#include <linux/time_types.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+
+static int uring_setup(unsigned entries, struct io_uring_params* p) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, p));
+}
+
+static int uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags,
+                       const void* arg, size_t argsz) {
+    return static_cast<int>(
+        syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, argsz));
+}
+
+static int uring_register(int fd, unsigned op, const void* arg, unsigned nr) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, op, arg, nr));
+}
+
+// Ring indices are shared with the kernel
+template <typename T>
+static T load_acquire(T* p) {
+    return std::atomic_ref<T>(*p).load(std::memory_order_acquire);
+}
+
+template <typename T>
+static void store_release(T* p, T v) {
+    std::atomic_ref<T>(*p).store(v, std::memory_order_release);
+}
+
+constexpr uint64_t RECV_TAG   = 1;
+constexpr uint64_t SEND_TAG   = 2;
+constexpr uint16_t BUF_GROUP  = 0;
+constexpr unsigned SQ_ENTRIES = 256;
+
+class uring_transport : public frame_transport {
+public:
+    ~uring_transport() override;
+
+    bool init(int sockfd, const transport_options& opt);
+
+    int recv_batch(std::vector<frame_view>& out, size_t max, int timeout_ms) override;
+    int send_batch(const std::vector<frame_view>& frames) override;
+    const char* name() const override { return sqpoll_ ? "uring+sqpoll" : "uring"; }
+
+private:
+    struct io_uring_sqe* get_sqe();
+    int enter(unsigned wait_nr, int timeout_ms);
+    void arm_recv();
+    void recycle();
+    void reap();
+
+    int sockfd_ = -1;
+    int ring_fd_ = -1;
+    bool sqpoll_ = false;
+
+    // Submission and completion rings (mmap'ed from ring_fd_)
+    void* sq_ptr_ = MAP_FAILED;
+    void* cq_ptr_ = MAP_FAILED;
+    size_t sq_size_ = 0, cq_size_ = 0, sqes_size_ = 0;
+    struct io_uring_sqe* sqes_ = static_cast<struct io_uring_sqe*>(MAP_FAILED);
+    unsigned *sq_head_ = nullptr, *sq_tail_ = nullptr, *sq_mask_ = nullptr;
+    unsigned *sq_array_ = nullptr, *sq_flags_ = nullptr;
+    unsigned sq_entries_ = 0, sq_local_tail_ = 0, to_submit_ = 0;
+    unsigned *cq_head_ = nullptr, *cq_tail_ = nullptr, *cq_mask_ = nullptr;
+    struct io_uring_cqe* cqes_ = nullptr;
+
+    // Provided receive buffers: the kernel picks one per frame
+    struct io_uring_buf_ring* br_ = static_cast<struct io_uring_buf_ring*>(MAP_FAILED);
+    size_t br_size_ = 0;
+    unsigned nbufs_ = 0;
+    uint16_t br_tail_ = 0;
+    size_t frame_size_ = 0;
+    std::vector<uint8_t> bufs_;
+    std::vector<frame_view> ready_;   // received, not yet handed out
+    std::vector<uint16_t> ready_bid_;
+    size_t ready_pos_ = 0;
+    std::vector<uint16_t> lent_;      // handed out by the last recv_batch
+
+    bool armed_ = false;              // multishot recv outstanding
+    size_t sends_inflight_ = 0;
+    size_t send_errors_ = 0;
+};
+
+uring_transport::~uring_transport() {
+    if (br_ != MAP_FAILED) munmap(br_, br_size_);
+    if (sqes_ != MAP_FAILED) munmap(sqes_, sqes_size_);
+    if (cq_ptr_ != MAP_FAILED && cq_ptr_ != sq_ptr_) munmap(cq_ptr_, cq_size_);
+    if (sq_ptr_ != MAP_FAILED) munmap(sq_ptr_, sq_size_);
+    if (ring_fd_ >= 0) close(ring_fd_);
+}
+
+bool uring_transport::init(int sockfd, const transport_options& opt) {
+    sockfd_     = sockfd;
+    sqpoll_     = opt.sqpoll;
+    frame_size_ = opt.frame_size;
+    nbufs_      = 1;
+    while (nbufs_ < opt.frames && nbufs_ < 32768) nbufs_ <<= 1;
+
+    struct io_uring_params p{};
+    // Multishot recv can post a CQE per buffer before we reap
+    p.flags      = IORING_SETUP_CQSIZE;
+    p.cq_entries = 2 * nbufs_ > 2 * SQ_ENTRIES ? 2 * nbufs_ : 2 * SQ_ENTRIES;
+    if (sqpoll_) {
+        p.flags |= IORING_SETUP_SQPOLL;
+        p.sq_thread_idle = 100;   // ms before the poller sleeps
+    }
+    ring_fd_ = uring_setup(SQ_ENTRIES, &p);
+    if (ring_fd_ < 0) {
+        perror("[uring] io_uring_setup");
+        return false;
+    }
+    if (!(p.features & IORING_FEAT_EXT_ARG)) {
+        std::cerr << "[uring] Kernel lacks IORING_FEAT_EXT_ARG\n";
+        return false;
+    }
+
+    sq_size_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cq_size_ = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    bool single = p.features & IORING_FEAT_SINGLE_MMAP;
+    if (single) sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+    sq_ptr_ = mmap(nullptr, sq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   ring_fd_, IORING_OFF_SQ_RING);
+    if (sq_ptr_ == MAP_FAILED) {
+        perror("[uring] mmap sq");
+        return false;
+    }
+    cq_ptr_ = single ? sq_ptr_
+                     : mmap(nullptr, cq_size_, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+    sqes_size_ = p.sq_entries * sizeof(struct io_uring_sqe);
+    sqes_ = static_cast<struct io_uring_sqe*>(
+        mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+             ring_fd_, IORING_OFF_SQES));
+    if (cq_ptr_ == MAP_FAILED || sqes_ == MAP_FAILED) {
+        perror("[uring] mmap cq/sqes");
+        return false;
+    }
+
+    auto* sq = static_cast<uint8_t*>(sq_ptr_);
+    auto* cq = static_cast<uint8_t*>(cq_ptr_);
+    sq_head_    = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+    sq_tail_    = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+    sq_mask_    = reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+    sq_array_   = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+    sq_flags_   = reinterpret_cast<unsigned*>(sq + p.sq_off.flags);
+    sq_entries_ = p.sq_entries;
+    sq_local_tail_ = *sq_tail_;
+    cq_head_ = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+    cq_mask_ = reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+    cqes_    = reinterpret_cast<struct io_uring_cqe*>(cq + p.cq_off.cqes);
+
+    // Buffer ring: page-aligned, registered as group BUF_GROUP
+    br_size_ = nbufs_ * sizeof(struct io_uring_buf);
+    br_ = static_cast<struct io_uring_buf_ring*>(
+        mmap(nullptr, br_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (br_ == MAP_FAILED) {
+        perror("[uring] mmap buffer ring");
+        return false;
+    }
+    struct io_uring_buf_reg reg{};
+    reg.ring_addr    = reinterpret_cast<uint64_t>(br_);
+    reg.ring_entries = nbufs_;
+    reg.bgid         = BUF_GROUP;
+    if (uring_register(ring_fd_, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        perror("[uring] register buffer ring");
+        return false;
+    }
+    bufs_.resize(nbufs_ * frame_size_);
+    for (unsigned i = 0; i < nbufs_; ++i) lent_.push_back(static_cast<uint16_t>(i));
+    recycle();
+    return true;
+}
+
+struct io_uring_sqe* uring_transport::get_sqe() {
+    if (sq_local_tail_ - load_acquire(sq_head_) >= sq_entries_) return nullptr;
+    unsigned idx = sq_local_tail_ & *sq_mask_;
+    sq_array_[idx] = idx;
+    struct io_uring_sqe* sqe = &sqes_[idx];
+    std::memset(sqe, 0, sizeof(*sqe));
+    ++sq_local_tail_;
+    ++to_submit_;
+    return sqe;
+}
+
+// Publishes queued SQEs and waits for wait_nr CQEs (timeout_ms < 0:
+// no limit). Returns -1 on error.
+int uring_transport::enter(unsigned wait_nr, int timeout_ms) {
+    store_release(sq_tail_, sq_local_tail_);
+    unsigned flags = 0;
+    if (sqpoll_) {
+        // The poller thread submits; wake it if it went to sleep
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (to_submit_ > 0 && (load_acquire(sq_flags_) & IORING_SQ_NEED_WAKEUP)) {
+            flags |= IORING_ENTER_SQ_WAKEUP;
+        }
+        to_submit_ = 0;
+        if (wait_nr == 0 && flags == 0) return 0;
+    }
+    if (wait_nr > 0) flags |= IORING_ENTER_GETEVENTS;
+
+    struct __kernel_timespec ts{};
+    struct io_uring_getevents_arg arg{};
+    const void* argp = nullptr;
+    size_t argsz = 0;
+    if (wait_nr > 0 && timeout_ms >= 0) {
+        ts.tv_sec  = timeout_ms / 1000;
+        ts.tv_nsec = (timeout_ms % 1000) * 1000000L;
+        arg.sigmask_sz = _NSIG / 8;
+        arg.ts    = reinterpret_cast<uint64_t>(&ts);
+        flags    |= IORING_ENTER_EXT_ARG;
+        argp      = &arg;
+        argsz     = sizeof(arg);
+    }
+    int ret = uring_enter(ring_fd_, to_submit_, wait_nr, flags, argp, argsz);
+    if (ret >= 0 && !sqpoll_) to_submit_ -= static_cast<unsigned>(ret);
+    if (ret < 0 && errno != ETIME && errno != EINTR && errno != EBUSY) {
+        perror("[uring] io_uring_enter");
+        return -1;
+    }
+    return 0;
+}
+
+void uring_transport::arm_recv() {
+    struct io_uring_sqe* sqe = get_sqe();
+    if (!sqe) return;   // retried on the next recv_batch
+    sqe->opcode    = IORING_OP_RECV;
+    sqe->fd        = sockfd_;
+    sqe->ioprio    = IORING_RECV_MULTISHOT;
+    sqe->flags     = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = BUF_GROUP;
+    sqe->user_data = RECV_TAG;
+    armed_ = true;
+}
+
+// Gives the buffers of the frames handed out last time back to the kernel
+void uring_transport::recycle() {
+    if (lent_.empty()) return;
+    unsigned mask = nbufs_ - 1;
+    // Not br_->bufs: in C++ the header's flexible-array wrapper adds an
+    // empty struct in front of it, shifting the entries by 8 bytes
+    auto* ring = reinterpret_cast<struct io_uring_buf*>(br_);
+    for (uint16_t bid : lent_) {
+        struct io_uring_buf* b = &ring[br_tail_ & mask];
+        b->addr = reinterpret_cast<uint64_t>(bufs_.data() + bid * frame_size_);
+        b->len  = static_cast<uint32_t>(frame_size_);
+        b->bid  = bid;
+        ++br_tail_;
+    }
+    store_release(&br_->tail, br_tail_);
+    lent_.clear();
+}
+
+void uring_transport::reap() {
+    unsigned head = *cq_head_;
+    unsigned tail = load_acquire(cq_tail_);
+    for (; head != tail; ++head) {
+        const struct io_uring_cqe& cqe = cqes_[head & *cq_mask_];
+        if (cqe.user_data == SEND_TAG) {
+            --sends_inflight_;
+            send_errors_ += cqe.res < 0;
+            continue;
+        }
+        if (!(cqe.flags & IORING_CQE_F_MORE)) armed_ = false;
+        if (cqe.flags & IORING_CQE_F_BUFFER) {
+            uint16_t bid = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+            if (cqe.res > 0) {
+                ready_.push_back(frame_view{bufs_.data() + bid * frame_size_,
+                                            static_cast<size_t>(cqe.res)});
+                ready_bid_.push_back(bid);
+            } else {
+                lent_.push_back(bid);
+            }
+        } else if (cqe.res < 0 && cqe.res != -ENOBUFS) {
+            // ENOBUFS: every buffer is queued or lent; re-armed after recycle()
+            std::cerr << "[uring] recv: " << std::strerror(-cqe.res) << "\n";
+        }
+    }
+    store_release(cq_head_, head);
+}
+
+int uring_transport::recv_batch(std::vector<frame_view>& out, size_t max, int timeout_ms) {
+    recycle();
+    if (ready_pos_ == ready_.size()) {
+        ready_.clear();
+        ready_bid_.clear();
+        ready_pos_ = 0;
+        if (!armed_) arm_recv();
+        if (enter(0, 0) < 0) return -1;
+        reap();
+        if (ready_.empty() && timeout_ms != 0) {
+            if (enter(1, timeout_ms) < 0) return -1;
+            reap();
+        }
+    }
+    int got = 0;
+    for (; ready_pos_ < ready_.size() && static_cast<size_t>(got) < max; ++ready_pos_, ++got) {
+        out.push_back(ready_[ready_pos_]);
+        lent_.push_back(ready_bid_[ready_pos_]);
+    }
+    return got;
+}
+
+int uring_transport::send_batch(const std::vector<frame_view>& frames) {
+    size_t errors_before = send_errors_;
+    for (const auto& f : frames) {
+        struct io_uring_sqe* sqe;
+        while (!(sqe = get_sqe())) {
+            // SQ full: push what is queued and let some sends finish
+            if (enter(1, -1) < 0) return 0;
+            reap();
+        }
+        sqe->opcode    = IORING_OP_SEND;
+        sqe->fd        = sockfd_;
+        sqe->addr      = reinterpret_cast<uint64_t>(f.data);
+        sqe->len       = static_cast<uint32_t>(f.len);
+        sqe->user_data = SEND_TAG;
+        ++sends_inflight_;
+    }
+    // The frames may be reused once we return
+    while (sends_inflight_ > 0) {
+        if (enter(static_cast<unsigned>(sends_inflight_), -1) < 0) return 0;
+        reap();
+    }
+    return static_cast<int>(frames.size() - (send_errors_ - errors_before));
+}
+
+std::unique_ptr<frame_transport> make_uring_transport(int sockfd, int /*ifindex*/,
+                                                      const transport_options& opt) {
+    // The socket is bound to its interface, so sends need no address
+    auto t = std::make_unique<uring_transport>();
+    if (!t->init(sockfd, opt)) return nullptr;
+    return t;
+}
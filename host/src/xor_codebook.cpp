@@ -0,0 +1,134 @@
+// src/xor_codebook.cpp
+#include "xor_codebook.hpp"
+
+#ifndef __linux__
+#error "xor_codebook.cpp requires Linux (mmap)."
+#endif
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+static_assert(sizeof(codebook_h) % 8 == 0, "masks must stay 8-byte aligned");
+
+uint64_t apa_fingerprint(const apa_t& apa, int num_hops) {
+    uint64_t h = 0xCBF29CE484222325ull ^ static_cast<uint64_t>(num_hops);
+    size_t n = static_cast<size_t>(num_hops) * apa.max_degree;
+    for (size_t i = 0; i < n && i < apa.add_thresh.size(); ++i) {
+        h = (h ^ apa.add_thresh[i]) * 0x100000001B3ull;
+        h = (h ^ apa.replace_thresh[i]) * 0x100000001B3ull;
+    }
+    return h;
+}
+
+bool xor_codebook::build(const apa_t& apa, int num_hops, uint32_t first_pktid,
+                         uint32_t count) {
+    close();
+    if (num_hops <= 0 || num_hops > MAX_HOPS || num_hops > apa.max_hops) {
+        std::cerr << "[codebook] Bad path length " << num_hops << "\n";
+        return false;
+    }
+    uint32_t words = static_cast<uint32_t>((num_hops + 63) / 64);
+    owned_.assign(static_cast<size_t>(count) * words, 0);
+    for (uint32_t i = 0; i < count; ++i) {
+        hop_mask m = reconstruct_xor_set(apa, num_hops, first_pktid + i);
+        std::memcpy(&owned_[static_cast<size_t>(i) * words], m.w, words * sizeof(uint64_t));
+    }
+
+    hdr_.magic           = CODEBOOK_MAGIC;
+    hdr_.version         = CODEBOOK_VERSION;
+    hdr_.num_hops        = static_cast<uint32_t>(num_hops);
+    hdr_.words           = words;
+    hdr_.first_pktid     = first_pktid;
+    hdr_.count           = count;
+    hdr_.apa_fingerprint = apa_fingerprint(apa, num_hops);
+    hdr_.bytes           = sizeof(codebook_h) + owned_.size() * sizeof(uint64_t);
+    masks_ = owned_.data();
+    return true;
+}
+
+bool xor_codebook::save(const std::string& path) const {
+    if (!masks_) return false;
+    std::string tmp = path + ".tmp";
+    FILE* f = std::fopen(tmp.c_str(), "wb");
+    if (!f) {
+        perror("[codebook] fopen");
+        return false;
+    }
+    size_t n = static_cast<size_t>(hdr_.count) * hdr_.words;
+    bool ok = std::fwrite(&hdr_, sizeof(hdr_), 1, f) == 1 &&
+              std::fwrite(masks_, sizeof(uint64_t), n, f) == n;
+    ok = std::fclose(f) == 0 && ok;
+    if (ok && rename(tmp.c_str(), path.c_str()) < 0) {
+        perror("[codebook] rename");
+        ok = false;
+    }
+    if (!ok) unlink(tmp.c_str());
+    return ok;
+}
+
+bool xor_codebook::open(const std::string& path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "[codebook] Cannot open " << path << "\n";
+        return false;
+    }
+    struct stat st{};
+    if (fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) < sizeof(codebook_h)) {
+        ::close(fd);
+        std::cerr << "[codebook] " << path << " is truncated\n";
+        return false;
+    }
+    size_t n = static_cast<size_t>(st.st_size);
+    // Shared, read-only: one copy in the page cache for every process
+    void* mem = mmap(nullptr, n, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mem == MAP_FAILED) {
+        perror("[codebook] mmap");
+        return false;
+    }
+
+    codebook_h hdr;
+    std::memcpy(&hdr, mem, sizeof(hdr));
+    bool ok = hdr.magic == CODEBOOK_MAGIC && hdr.version == CODEBOOK_VERSION &&
+              hdr.num_hops > 0 && hdr.num_hops <= MAX_HOPS &&
+              hdr.words == (hdr.num_hops + 63) / 64 && hdr.bytes == n &&
+              n == sizeof(hdr) + static_cast<uint64_t>(hdr.count) * hdr.words * sizeof(uint64_t);
+    if (!ok) {
+        munmap(mem, n);
+        std::cerr << "[codebook] " << path << " is corrupt\n";
+        return false;
+    }
+    hdr_       = hdr;
+    map_       = mem;
+    map_bytes_ = n;
+    masks_     = reinterpret_cast<const uint64_t*>(static_cast<const uint8_t*>(mem) + sizeof(hdr));
+    return true;
+}
+
+void xor_codebook::close() {
+    if (map_) munmap(map_, map_bytes_);
+    map_       = nullptr;
+    map_bytes_ = 0;
+    masks_     = nullptr;
+    owned_.clear();
+    owned_.shrink_to_fit();
+    hdr_ = codebook_h{};
+}
+
+packet_equation encode_packet(const xor_codebook& book, uint32_t pktid,
+                              const std::vector<uint16_t>& switch_ids) {
+    packet_equation eq;
+    eq.pktid = pktid;
+    book.lookup(pktid, eq.xor_set);
+    for (int hop = eq.xor_set.lowest(); hop >= 0 && hop < static_cast<int>(switch_ids.size()); ++hop) {
+        if (eq.xor_set.test(hop)) eq.pint ^= switch_ids[hop];
+    }
+    return eq;
+}